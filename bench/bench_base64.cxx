@@ -0,0 +1,300 @@
+/*
+ * bench_base64.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../src/base64.h"
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/* random inputs checked against the old codec */
+#define SV_BENCH_B64_CHECKS 200000
+
+/* size of the big buffer, and how many short quick notes */
+#define SV_BENCH_B64_BIG (1 << 20)
+#define SV_BENCH_B64_NOTES 100000
+
+/* runs, the best one is reported */
+#define SV_BENCH_B64_RUNS 5
+
+/* the old codec's alphabet */
+static const std::string m_oldBase64Chars =
+             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+             "abcdefghijklmnopqrstuvwxyz"
+             "0123456789+/";
+
+
+/*  base64 (old codec)  */
+static inline bool svBenchOldBase64Type (unsigned char c)
+{
+  return (isalnum(c) || (c == '+') || (c == '/'));
+}
+
+
+/*  base64 (old codec, as base64.cxx had it before it went table-driven)  */
+static std::string svBenchOldDecode (std::string const& encoded_string)
+{
+  size_t in_len = encoded_string.size();
+  size_t i = 0;
+
+  int in_ = 0;
+  unsigned char char_array_4[4], char_array_3[3];
+  std::string ret;
+
+  while (in_len-- && ( encoded_string[in_] != '=') && svBenchOldBase64Type(encoded_string[in_]))
+  {
+    char_array_4[i ++] = encoded_string[in_]; in_ ++;
+
+    if (i ==4)
+    {
+      for (i = 0; i < 4; i ++)
+        char_array_4[i] = static_cast<unsigned char>(m_oldBase64Chars.find(char_array_4[i]));
+
+      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+      for (i = 0; (i < 3); i ++)
+        ret += char_array_3[i];
+
+      i = 0;
+    }
+  }
+
+  if (i != 0)
+  {
+    for (int j = i; j <4; j ++)
+      char_array_4[j] = 0;
+
+    for (int j = 0; j <4; j ++)
+      char_array_4[j] = static_cast<unsigned char>(m_oldBase64Chars.find(char_array_4[j]));
+
+    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+    for (size_t j = 0; (j < i - 1); j ++)
+      ret += char_array_3[j];
+  }
+
+  return ret;
+}
+
+
+/*  base64 (old codec, as base64.cxx had it before it went table-driven)  */
+static std::string svBenchOldEncode (unsigned char const * bytes_to_encode, unsigned int in_len)
+{
+  std::string ret;
+  int i = 0;
+
+  unsigned char char_array_3[3];
+  unsigned char char_array_4[4];
+
+  while (in_len--)
+  {
+    char_array_3[i ++] = *(bytes_to_encode ++);
+
+    if (i == 3)
+    {
+      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+      char_array_4[3] = char_array_3[2] & 0x3f;
+
+      for (i = 0; (i < 4) ; i ++)
+        ret += m_oldBase64Chars[char_array_4[i]];
+
+      i = 0;
+    }
+  }
+
+  if (i != 0)
+  {
+    for (int j = i; j < 3; j ++)
+      char_array_3[j] = '\0';
+
+    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+    char_array_4[3] = char_array_3[2] & 0x3f;
+
+    for (int j = 0; (j < i + 1); j ++)
+      ret += m_oldBase64Chars[char_array_4[j]];
+
+    while (i ++ < 3)
+      ret += '=';
+  }
+
+  return ret;
+}
+
+
+/*
+  run fn SV_BENCH_B64_RUNS times, returning the best time in ms
+  (nBytes adds up the output, so nothing is optimized away)
+*/
+template <typename Fn>
+static double svBenchBest (Fn fn, size_t& nBytes)
+{
+  double fBestMs = 0;
+
+  for (int nRun = 0; nRun < SV_BENCH_B64_RUNS; nRun ++)
+  {
+    std::chrono::steady_clock::time_point tpStart = std::chrono::steady_clock::now();
+
+    nBytes += fn();
+
+    double fMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tpStart).count();
+
+    if (nRun == 0 || fMs < fBestMs)
+      fBestMs = fMs;
+  }
+
+  return fBestMs;
+}
+
+
+static std::string m_big;
+static std::string m_bigEncoded;
+static std::vector<std::string> m_notesEncoded;
+
+
+static size_t svBenchNewEncodeBig ()
+{
+  return base64Encode(reinterpret_cast<const unsigned char *>(m_big.data()), m_big.size()).size();
+}
+
+
+static size_t svBenchOldEncodeBig ()
+{
+  return svBenchOldEncode(reinterpret_cast<const unsigned char *>(m_big.data()), m_big.size()).size();
+}
+
+
+static size_t svBenchNewDecodeBig ()
+{
+  return base64Decode(m_bigEncoded).size();
+}
+
+
+static size_t svBenchOldDecodeBig ()
+{
+  return svBenchOldDecode(m_bigEncoded).size();
+}
+
+
+static size_t svBenchNewDecodeNotes ()
+{
+  size_t nBytes = 0;
+
+  for (const std::string& strNote : m_notesEncoded)
+    nBytes += base64Decode(strNote).size();
+
+  return nBytes;
+}
+
+
+static size_t svBenchOldDecodeNotes ()
+{
+  size_t nBytes = 0;
+
+  for (const std::string& strNote : m_notesEncoded)
+    nBytes += svBenchOldDecode(strNote).size();
+
+  return nBytes;
+}
+
+
+/*
+  checks base64Encode and base64Decode against the old codec on random
+  input (including junk that isn't base64), then times both on a big
+  buffer and on many short quick notes
+*/
+int main ()
+{
+  std::mt19937 rng(1);
+  const char * strJunk = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=!\n ";
+  size_t nMismatches = 0;
+
+  for (int i = 0; i < SV_BENCH_B64_CHECKS; i ++)
+  {
+    std::string strIn;
+    std::string strJunkIn;
+
+    for (unsigned int n = rng() % 40; n > 0; n --)
+      strIn += static_cast<char>(rng() % 256);
+
+    for (unsigned int n = rng() % 20; n > 0; n --)
+      strJunkIn += strJunk[rng() % 68];
+
+    const unsigned char * bytes = reinterpret_cast<const unsigned char *>(strIn.data());
+    std::string strEncoded = base64Encode(bytes, strIn.size());
+
+    if (strEncoded != svBenchOldEncode(bytes, strIn.size()) || base64Decode(strEncoded) != strIn ||
+      base64Decode(strJunkIn) != svBenchOldDecode(strJunkIn))
+      nMismatches ++;
+  }
+
+  std::printf("checked %d random inputs against the old codec, %zu mismatches\n", SV_BENCH_B64_CHECKS,
+    nMismatches);
+
+  if (nMismatches > 0)
+    return 1;
+
+  for (int i = 0; i < SV_BENCH_B64_BIG; i ++)
+    m_big += static_cast<char>(rng() % 256);
+
+  m_bigEncoded = base64Encode(reinterpret_cast<const unsigned char *>(m_big.data()), m_big.size());
+
+  for (int i = 0; i < SV_BENCH_B64_NOTES; i ++)
+  {
+    std::string strNote = "quick note for host " + std::to_string(i) + ", nothing in particular";
+
+    m_notesEncoded.push_back(base64Encode(reinterpret_cast<const unsigned char *>(strNote.data()),
+      strNote.size()));
+  }
+
+  size_t nBytes = 0;
+
+  std::printf("encode %d KiB:     new %.2f ms, old %.2f ms\n", SV_BENCH_B64_BIG / 1024,
+    svBenchBest(svBenchNewEncodeBig, nBytes), svBenchBest(svBenchOldEncodeBig, nBytes));
+  std::printf("decode %d KiB:     new %.2f ms, old %.2f ms\n", SV_BENCH_B64_BIG / 1024,
+    svBenchBest(svBenchNewDecodeBig, nBytes), svBenchBest(svBenchOldDecodeBig, nBytes));
+  std::printf("decode %d notes: new %.2f ms, old %.2f ms\n", SV_BENCH_B64_NOTES,
+    svBenchBest(svBenchNewDecodeNotes, nBytes), svBenchBest(svBenchOldDecodeNotes, nBytes));
+
+  return nBytes > 0 ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+/*
+ * bench_config.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../src/app.h"
+#include <chrono>
+#include <cstdio>
+
+AppVars * app = new AppVars();
+
+/* number of host entries in the generated config */
+#define SV_BENCH_CONFIG_HOSTS 65000
+
+/* parse runs, the best one is reported */
+#define SV_BENCH_CONFIG_RUNS 5
+
+
+/*
+  times svConfigParseHosts on a generated config file of
+  SV_BENCH_CONFIG_HOSTS hosts written the same way svConfigWrite does
+*/
+int main ()
+{
+  std::string strConfig;
+
+  for (int i = 0; i < SV_BENCH_CONFIG_HOSTS; i ++)
+  {
+    HostItem itm;
+
+    itm.name = "host-" + std::to_string(i);
+    itm.group = "group-" + std::to_string(i / 100);
+    itm.hostAddress = "10." + std::to_string((i >> 16) & 255) + "." + std::to_string((i >> 8) & 255) +
+      "." + std::to_string(i & 255);
+    itm.vncPort = "5900";
+    itm.sshPort = "22";
+    itm.hostType = (i % 4 == 0) ? 's' : 'v';
+    itm.sshUser = "user";
+    itm.scaling = 'f';
+    itm.quickNote = "note for host " + std::to_string(i);
+
+    strConfig += svConfigHostBlock(&itm);
+  }
+
+  std::printf("config: %d hosts, %zu bytes\n", SV_BENCH_CONFIG_HOSTS, strConfig.size());
+
+  double fBestMs = 0;
+
+  for (int nRun = 0; nRun < SV_BENCH_CONFIG_RUNS; nRun ++)
+  {
+    // svConfigParseHosts splits lines in place, so parse a copy
+    std::string strText = strConfig;
+    std::vector<HostItem *> hosts;
+
+    std::chrono::steady_clock::time_point tpStart = std::chrono::steady_clock::now();
+
+    svConfigParseHosts(strText, hosts);
+
+    double fMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tpStart).count();
+
+    if (nRun == 0 || fMs < fBestMs)
+      fBestMs = fMs;
+
+    if (hosts.size() != SV_BENCH_CONFIG_HOSTS)
+    {
+      std::printf("ERROR - parsed %zu hosts, expected %d\n", hosts.size(), SV_BENCH_CONFIG_HOSTS);
+      return 1;
+    }
+
+    for (HostItem * itm : hosts)
+      delete itm;
+  }
+
+  std::printf("svConfigParseHosts: best of %d runs %.1f ms (%.2f us per host)\n", SV_BENCH_CONFIG_RUNS,
+    fBestMs, fBestMs * 1000.0 / SV_BENCH_CONFIG_HOSTS);
+
+  return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ * bench_hoststate.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../src/app.h"
+#include "../src/hostitem.h"
+#include <chrono>
+#include <cstdio>
+
+AppVars * app = new AppVars();
+
+/* number of hosts */
+#define SV_BENCH_STATE_HOSTS 65000
+
+/* passes per run, and runs (the best one is reported) */
+#define SV_BENCH_STATE_PASSES 20
+#define SV_BENCH_STATE_RUNS 5
+
+/*
+  a host laid out the way HostItem was before its state moved to the
+  host state table (state, then settings, then everything else)
+*/
+class SVBenchInlineItem : public HostState, public HostConfig
+{
+public:
+  std::string sshLocalSocket;
+  std::string vncAddressAndPort;
+  std::vector<uint8_t> suspendedFrame;
+  std::string lastErrorMessage;
+  std::string configBlock;
+  std::string clipboard;
+};
+
+
+/*  fill in settings the way a loaded config does  */
+static void svBenchFillConfig (HostConfig& cfg, int i)
+{
+  cfg.name = "host-" + std::to_string(i) + "-with-a-longer-name";
+  cfg.group = "group-" + std::to_string(i / 100) + "-datacenter";
+  cfg.hostAddress = "host-" + std::to_string(i) + ".rack-" + std::to_string(i / 40) + ".example.com";
+  cfg.vncPort = "5900";
+  cfg.sshUser = "administrator";
+  cfg.quickNote = "quick note for host " + std::to_string(i) + ", nothing in particular";
+  cfg.customCommand1 = "/usr/local/bin/do-something --host " + cfg.hostAddress;
+}
+
+
+/*  fill in the connection state, with one host in every 64 connected  */
+static void svBenchFillState (HostState& state, int i)
+{
+  state.isConnected = (i % 64 == 0);
+  state.vnc = state.isConnected ? reinterpret_cast<VncObject *>(&state) : NULL;
+  state.vncNeedsCleanup = (i % 1000 == 1);
+  state.isReconnecting = (i % 500 == 2);
+  state.isConnecting = state.isReconnecting;
+}
+
+
+/*
+  what the watcher and scan look at in a host's state: cleanups
+  and reconnects underway, and connected hosts to scan
+*/
+static inline int svBenchCheck (const HostState& state)
+{
+  return (state.vncNeedsCleanup ? 1 : 0) + (state.isReconnecting && state.isConnecting ? 1 : 0) +
+    (state.isConnected && state.vnc ? 1 : 0);
+}
+
+
+/*  run fn SV_BENCH_STATE_RUNS times, returning the best time in ms  */
+template <typename Fn>
+static double svBenchBest (Fn fn, long& nFound)
+{
+  double fBestMs = 0;
+
+  for (int nRun = 0; nRun < SV_BENCH_STATE_RUNS; nRun ++)
+  {
+    std::chrono::steady_clock::time_point tpStart = std::chrono::steady_clock::now();
+
+    nFound = 0;
+
+    for (int nPass = 0; nPass < SV_BENCH_STATE_PASSES; nPass ++)
+      nFound += fn();
+
+    double fMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tpStart).count();
+
+    if (nRun == 0 || fMs < fBestMs)
+      fBestMs = fMs;
+  }
+
+  return fBestMs / SV_BENCH_STATE_PASSES;
+}
+
+
+static std::vector<SVBenchInlineItem *> m_inlineItems;
+static std::vector<HostItem *> m_items;
+static std::vector<uint32_t> m_activeIds;
+
+
+/*  go through the old inline state of every host  */
+static long svBenchInlinePass ()
+{
+  long nFound = 0;
+
+  for (const SVBenchInlineItem * itm : m_inlineItems)
+    nFound += svBenchCheck(*itm);
+
+  return nFound;
+}
+
+
+/*  go through every host's state from its item  */
+static long svBenchItemPass ()
+{
+  long nFound = 0;
+
+  for (const HostItem * itm : m_items)
+    nFound += svBenchCheck(itm->state());
+
+  return nFound;
+}
+
+
+/*  go through the host state table by id  */
+static long svBenchTablePass ()
+{
+  long nFound = 0;
+  uint32_t nEnd = svHostStateEnd();
+
+  for (uint32_t nId = 0; nId < nEnd; nId ++)
+    nFound += svBenchCheck(svHostState(nId));
+
+  return nFound;
+}
+
+
+/*  go through an active id list, the way the watchers and the scan do  */
+static long svBenchActivePass ()
+{
+  long nFound = 0;
+
+  for (uint32_t nId : m_activeIds)
+    nFound += svBenchCheck(svHostState(nId));
+
+  return nFound;
+}
+
+
+/*
+  times a watcher / scan pass over the connection state of
+  SV_BENCH_STATE_HOSTS hosts, with the state inside each item
+  as it used to be and in the host state table
+*/
+int main ()
+{
+  // allocated interleaved, the way loading a config leaves them
+  for (int i = 0; i < SV_BENCH_STATE_HOSTS; i ++)
+  {
+    SVBenchInlineItem * itmInline = new SVBenchInlineItem();
+    HostItem * itm = new HostItem();
+
+    svBenchFillConfig(*itmInline, i);
+    svBenchFillConfig(*itm, i);
+    svBenchFillState(*itmInline, i);
+    svBenchFillState(itm->state(), i);
+
+    m_inlineItems.push_back(itmInline);
+    m_items.push_back(itm);
+    m_activeIds.push_back(itm->stateId);
+  }
+
+  std::printf("hosts: %d, item %zu bytes, state %zu bytes\n", SV_BENCH_STATE_HOSTS, sizeof(HostItem),
+    sizeof(HostState));
+
+  long nInline = 0;
+  long nItem = 0;
+  long nTable = 0;
+  long nActive = 0;
+
+  double fInlineMs = svBenchBest(svBenchInlinePass, nInline);
+  double fItemMs = svBenchBest(svBenchItemPass, nItem);
+  double fTableMs = svBenchBest(svBenchTablePass, nTable);
+  double fActiveMs = svBenchBest(svBenchActivePass, nActive);
+
+  if (nInline != nItem || nInline != nTable || nInline != nActive)
+  {
+    std::printf("ERROR - passes disagree (%ld, %ld, %ld, %ld)\n", nInline, nItem, nTable, nActive);
+    return 1;
+  }
+
+  std::printf("state inside each item:   %.3f ms per pass\n", fInlineMs);
+  std::printf("state table, from items:  %.3f ms per pass\n", fItemMs);
+  std::printf("state table, by id:       %.3f ms per pass\n", fTableMs);
+  std::printf("state table, active ids:  %.3f ms per pass\n", fActiveMs);
+
+  return 0;
+}
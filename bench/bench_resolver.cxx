@@ -0,0 +1,158 @@
+/*
+ * bench_resolver.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../src/app.h"
+#include "../src/resolver.h"
+#include <chrono>
+#include <cstdio>
+#include <netinet/in.h>
+
+AppVars * app = new AppVars();
+
+/* cached lookups timed */
+#define SV_BENCH_RESOLVER_LOOKUPS 100000
+
+/* stub clock and how many times the stub resolver was asked */
+static time_t m_benchNow = 1000000;
+static int m_nBenchResolves = 0;
+
+/* checks that failed */
+static int m_nBenchFailed = 0;
+
+
+/*  stub clock for the resolver cache  */
+static time_t svBenchClock (time_t * t)
+{
+  if (t)
+    *t = m_benchNow;
+
+  return m_benchNow;
+}
+
+
+/*  stub resolver, only names starting with "good" resolve (to 127.0.0.1)  */
+static bool svBenchResolve (const std::string& strHost, std::vector<SVResolvedAddress>& addrs)
+{
+  m_nBenchResolves ++;
+
+  if (strHost.compare(0, 4, "good") != 0)
+    return false;
+
+  SVResolvedAddress resolved;
+  struct sockaddr_in * sin = reinterpret_cast<struct sockaddr_in *>(&resolved.addr);
+
+  memset(&resolved, 0, sizeof(resolved));
+  sin->sin_family = AF_INET;
+  sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  resolved.addrLen = sizeof(struct sockaddr_in);
+  resolved.family = AF_INET;
+
+  addrs.push_back(resolved);
+
+  return true;
+}
+
+
+/*
+  look strHost up, then check the result and how many times the stub
+  resolver has been asked so far
+*/
+static void svBenchCheck (const char * strWhat, const std::string& strHost, bool shouldResolve,
+  int nResolves)
+{
+  std::vector<SVResolvedAddress> addrs;
+  bool resolvedOkay = svResolverLookup(strHost, addrs);
+  bool passed = (resolvedOkay == shouldResolve && m_nBenchResolves == nResolves);
+
+  std::printf("%-44s %s\n", strWhat, passed ? "ok" : "FAILED");
+
+  if (!passed)
+    m_nBenchFailed ++;
+}
+
+
+/*
+  checks the resolver cache's lifetimes and svResolverForget with a stub
+  resolver and clock, then times cached lookups
+*/
+int main ()
+{
+  svResolverSetFunction(svBenchResolve);
+  svResolverSetClock(svBenchClock);
+
+  // positive results last SV_RESOLVER_TTL_SECS
+  svBenchCheck("good host resolves", "good.example", true, 1);
+  svBenchCheck("good host is cached", "good.example", true, 1);
+
+  m_benchNow += SV_RESOLVER_TTL_SECS - 1;
+  svBenchCheck("still cached just before the ttl", "good.example", true, 1);
+
+  m_benchNow += 1;
+  svBenchCheck("resolved again at the ttl", "good.example", true, 2);
+
+  // failures last SV_RESOLVER_NEGATIVE_TTL_SECS
+  svBenchCheck("bad host fails", "bad.example", false, 3);
+  svBenchCheck("bad host failure is cached", "bad.example", false, 3);
+
+  m_benchNow += SV_RESOLVER_NEGATIVE_TTL_SECS - 1;
+  svBenchCheck("failure cached just before the negative ttl", "bad.example", false, 3);
+
+  m_benchNow += 1;
+  svBenchCheck("tried again at the negative ttl", "bad.example", false, 4);
+
+  // forgetting drops a fresh entry
+  svBenchCheck("good host is cached again", "good.example", true, 4);
+
+  svResolverForget("good.example");
+  svBenchCheck("resolved again after svResolverForget", "good.example", true, 5);
+
+  if (m_nBenchFailed > 0)
+  {
+    std::printf("ERROR - %d checks failed\n", m_nBenchFailed);
+    return 1;
+  }
+
+  std::vector<SVResolvedAddress> addrs;
+  std::chrono::steady_clock::time_point tpStart = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < SV_BENCH_RESOLVER_LOOKUPS; i ++)
+    svResolverLookup("good.example", addrs);
+
+  double fMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tpStart).count();
+
+  std::printf("%d cached lookups: %.1f ms (%.3f us each)\n", SV_BENCH_RESOLVER_LOOKUPS, fMs,
+    fMs * 1000.0 / SV_BENCH_RESOLVER_LOOKUPS);
+
+  return 0;
+}
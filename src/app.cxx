@@ -33,6 +33,13 @@
 
 
 #include "app.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#endif
 
 /* unordered maps for child windows and their children */
 std::unordered_map<std::string, void *> m_appOptions;
@@ -40,6 +47,146 @@ std::unordered_map<std::string, void *> m_f8Actions;
 std::unordered_map<std::string, void *> m_itmSettings;
 std::unordered_map<std::string, void *> m_quickNoteEdit;
 
+/* host that was asked for a full frame ahead of the next scan step */
+static HostItem * m_scanPrefetchItm = NULL;
+
+/* host list rows the search box is showing, in row order */
+static std::vector<int> m_searchShownRows;
+static bool m_searchActive = false;
+
+
+/*
+  add a row to the end of the host list
+  (instance method)
+*/
+void SVHostList::add (const char * strText, void * data)
+{
+  Fl_Hold_Browser::add(strText, data);
+
+  rowItems.push_back(data);
+
+  if (data)
+    itemRows[data] = static_cast<int>(rowItems.size()) - 1;
+}
+
+
+/*
+  insert a row before nRow, moving later rows down
+  (instance method)
+*/
+void SVHostList::insert (int nRow, const char * strText, void * data)
+{
+  if (nRow < 1)
+    nRow = 1;
+
+  if (nRow >= static_cast<int>(rowItems.size()))
+  {
+    add(strText, data);
+    return;
+  }
+
+  Fl_Hold_Browser::insert(nRow, strText, data);
+
+  rowItems.insert(rowItems.begin() + nRow, data);
+  reindexFrom(nRow);
+}
+
+
+/*
+  remove row nRow, moving later rows up
+  (instance method)
+*/
+void SVHostList::remove (int nRow)
+{
+  if (nRow < 1 || nRow >= static_cast<int>(rowItems.size()))
+    return;
+
+  Fl_Hold_Browser::remove(nRow);
+
+  if (rowItems[nRow])
+    itemRows.erase(rowItems[nRow]);
+
+  rowItems.erase(rowItems.begin() + nRow);
+  reindexFrom(nRow);
+}
+
+
+/*
+  remove every row
+  (instance method)
+*/
+void SVHostList::clear ()
+{
+  Fl_Hold_Browser::clear();
+
+  rowItems.assign(1, static_cast<void *>(NULL));
+  itemRows.clear();
+}
+
+
+/*
+  swap two rows
+  (instance method)
+*/
+void SVHostList::swap (int nRowA, int nRowB)
+{
+  int nRows = static_cast<int>(rowItems.size());
+
+  if (nRowA < 1 || nRowB < 1 || nRowA >= nRows || nRowB >= nRows)
+    return;
+
+  Fl_Hold_Browser::swap(nRowA, nRowB);
+
+  std::swap(rowItems[nRowA], rowItems[nRowB]);
+
+  if (rowItems[nRowA])
+    itemRows[rowItems[nRowA]] = nRowA;
+
+  if (rowItems[nRowB])
+    itemRows[rowItems[nRowB]] = nRowB;
+}
+
+
+/*
+  return the item stored with row nRow, or NULL
+  (instance method)
+*/
+void * SVHostList::data (int nRow) const
+{
+  if (nRow < 1 || nRow >= static_cast<int>(rowItems.size()))
+    return NULL;
+
+  return rowItems[nRow];
+}
+
+
+/*
+  return the row holding data, or 0 if it isn't in the list
+  (instance method)
+*/
+int SVHostList::itemRow (const void * data) const
+{
+  std::unordered_map<const void *, int>::const_iterator it = itemRows.find(data);
+
+  if (it == itemRows.end())
+    return 0;
+
+  return it->second;
+}
+
+
+/*
+  update the item -> row index for rows from nRow on,
+  after rows were inserted or removed
+  (instance method)
+*/
+void SVHostList::reindexFrom (int nRow)
+{
+  for (int i = nRow; i < static_cast<int>(rowItems.size()); i ++)
+    if (rowItems[i])
+      itemRows[rowItems[i]] = i;
+}
+
 
 /*
   resize override method for SVMainWindow
@@ -239,6 +386,9 @@ void svCloseDeleteFinalizeChildWindow (Fl_Window * win)
   app->childWindowVisible = false;
   app->childWindowBeingDisplayed = NULL;
 
+  // config reloads held back for a host being edited can go ahead now
+  svConfigWatchSetEditing(NULL);
+
   if (app->mainWin)
     app->mainWin->redraw();
 }
@@ -277,436 +427,1041 @@ void svConfigCreateNewDir ()
   }
 }
 
-void svLoadHostList ()
+
+/* every property the config file can hold */
+enum SVConfigKey
 {
-  std::ifstream ifs;
-  char strP[SV_MAX_PROP_LINE_LEN] = {0};
-  std::string strLastGroup;
-  std::string strProp;
-  std::string strVal;
-  HostItem * itm = NULL;
-  bool addSep = false;
-  uint16_t numOfEntries = 0;
+  SV_CFG_UNKNOWN,
 
-  app->hostList->clear();
+  // app options
+  SV_CFG_APPFONTSIZE,
+  SV_CFG_BUTTONSONTOP,
+  SV_CFG_COLORBLINDICONS,
+  SV_CFG_DEBUGMODE,
+  SV_CFG_DECODEINTHREAD,
+  SV_CFG_HOSTLISTWIDTH,
+  SV_CFG_IDLESUSPENDMINS,
+  SV_CFG_LISTFONT,
+  SV_CFG_LISTFONTSIZE,
+  SV_CFG_LOCALPORTRANGE,
+  SV_CFG_LOGTOFILE,
+  SV_CFG_MAXIMIZED,
+  SV_CFG_MAXRECONNECTS,
+  SV_CFG_MSGLOOPSPEED,
+  SV_CFG_PROBEINTERVAL,
+  SV_CFG_RIGHTCLICKTOCLOSE,
+  SV_CFG_SAVEDH,
+  SV_CFG_SAVEDW,
+  SV_CFG_SAVEDX,
+  SV_CFG_SAVEDY,
+  SV_CFG_SCANTIMEOUT,
+  SV_CFG_SHOWREVERSECONNECT,
+  SV_CFG_SHOWTOOLTIPS,
+  SV_CFG_SSHCOMMAND,
+  SV_CFG_SSHCONTROLMASTER,
+  SV_CFG_SSHUNIXSOCKETS,
+  SV_CFG_STARTINGLOCALPORT,
+
+  // per-connection options (SV_CFG_HOST must stay first)
+  SV_CFG_HOST,
+  SV_CFG_GROUP,
+  SV_CFG_HOSTADDRESS,
+  SV_CFG_VNCPORT,
+  SV_CFG_SSHPORT,
+  SV_CFG_SSHKEYPRIVATE,
+  SV_CFG_SSHUSER,
+  SV_CFG_VNCPASS,
+  SV_CFG_VNCLOGINUSER,
+  SV_CFG_VNCLOGINPASS,
+  SV_CFG_TYPE,
+  SV_CFG_F12MACRO,
+  SV_CFG_SCALE,
+  SV_CFG_SCALEFAST,
+  SV_CFG_SHOWREMOTECURSOR,
+  SV_CFG_COMPRESSION,
+  SV_CFG_QUALITY,
+  SV_CFG_KEYDELAY,
+  SV_CFG_TCPNODELAY,
+  SV_CFG_TCPBUFFERSIZE,
+  SV_CFG_TCPKEEPALIVE,
+  SV_CFG_AUTORECONNECT,
+  SV_CFG_KEEPALIVEIDLE,
+  SV_CFG_KEEPALIVEINTERVAL,
+  SV_CFG_COLORDEPTH,
+  SV_CFG_QUICKNOTE,
+  SV_CFG_LASTCONNECTTIME,
+  SV_CFG_VIEWONLY,
+  SV_CFG_CUSTOMCOMMAND1ENABLED,
+  SV_CFG_CUSTOMCOMMAND1LABEL,
+  SV_CFG_CUSTOMCOMMAND1,
+  SV_CFG_CUSTOMCOMMAND2ENABLED,
+  SV_CFG_CUSTOMCOMMAND2LABEL,
+  SV_CFG_CUSTOMCOMMAND2,
+  SV_CFG_CUSTOMCOMMAND3ENABLED,
+  SV_CFG_CUSTOMCOMMAND3LABEL,
+  SV_CFG_CUSTOMCOMMAND3
+};
+
+/* one config file property name */
+struct SVConfigKeyName
+{
+  const char * strName;
+  SVConfigKey key;
+};
+
+/* property names, sorted so svConfigLookupKey can binary search them */
+static const SVConfigKeyName m_configKeys[] = {
+  {"appfontsize",            SV_CFG_APPFONTSIZE},
+  {"autoreconnect",          SV_CFG_AUTORECONNECT},
+  {"buttonsontop",           SV_CFG_BUTTONSONTOP},
+  {"colorblindicons",        SV_CFG_COLORBLINDICONS},
+  {"colordepth",             SV_CFG_COLORDEPTH},
+  {"compression",            SV_CFG_COMPRESSION},
+  {"customcommand1",         SV_CFG_CUSTOMCOMMAND1},
+  {"customcommand1enabled",  SV_CFG_CUSTOMCOMMAND1ENABLED},
+  {"customcommand1label",    SV_CFG_CUSTOMCOMMAND1LABEL},
+  {"customcommand2",         SV_CFG_CUSTOMCOMMAND2},
+  {"customcommand2enabled",  SV_CFG_CUSTOMCOMMAND2ENABLED},
+  {"customcommand2label",    SV_CFG_CUSTOMCOMMAND2LABEL},
+  {"customcommand3",         SV_CFG_CUSTOMCOMMAND3},
+  {"customcommand3enabled",  SV_CFG_CUSTOMCOMMAND3ENABLED},
+  {"customcommand3label",    SV_CFG_CUSTOMCOMMAND3LABEL},
+  {"debugmode",              SV_CFG_DEBUGMODE},
+  {"decodeinthread",         SV_CFG_DECODEINTHREAD},
+  {"f12macro",               SV_CFG_F12MACRO},
+  {"group",                  SV_CFG_GROUP},
+  {"host",                   SV_CFG_HOST},
+  {"hostaddress",            SV_CFG_HOSTADDRESS},
+  {"hostlistwidth",          SV_CFG_HOSTLISTWIDTH},
+  {"idlesuspendmins",        SV_CFG_IDLESUSPENDMINS},
+  {"keepaliveidle",          SV_CFG_KEEPALIVEIDLE},
+  {"keepaliveinterval",      SV_CFG_KEEPALIVEINTERVAL},
+  {"keydelay",               SV_CFG_KEYDELAY},
+  {"lastconnecttime",        SV_CFG_LASTCONNECTTIME},
+  {"listfont",               SV_CFG_LISTFONT},
+  {"listfontsize",           SV_CFG_LISTFONTSIZE},
+  {"localportrange",         SV_CFG_LOCALPORTRANGE},
+  {"logtofile",              SV_CFG_LOGTOFILE},
+  {"maximized",              SV_CFG_MAXIMIZED},
+  {"maxreconnects",          SV_CFG_MAXRECONNECTS},
+  {"msgloopspeed",           SV_CFG_MSGLOOPSPEED},
+  {"probeinterval",          SV_CFG_PROBEINTERVAL},
+  {"quality",                SV_CFG_QUALITY},
+  {"quicknote",              SV_CFG_QUICKNOTE},
+  {"rightclicktoclose",      SV_CFG_RIGHTCLICKTOCLOSE},
+  {"savedh",                 SV_CFG_SAVEDH},
+  {"savedw",                 SV_CFG_SAVEDW},
+  {"savedx",                 SV_CFG_SAVEDX},
+  {"savedy",                 SV_CFG_SAVEDY},
+  {"scale",                  SV_CFG_SCALE},
+  {"scalefast",              SV_CFG_SCALEFAST},
+  {"scantimeout",            SV_CFG_SCANTIMEOUT},
+  {"showremotecursor",       SV_CFG_SHOWREMOTECURSOR},
+  {"showreverseconnect",     SV_CFG_SHOWREVERSECONNECT},
+  {"showtooltips",           SV_CFG_SHOWTOOLTIPS},
+  {"sshcommand",             SV_CFG_SSHCOMMAND},
+  {"sshcontrolmaster",       SV_CFG_SSHCONTROLMASTER},
+  {"sshkeyprivate",          SV_CFG_SSHKEYPRIVATE},
+  {"sshport",                SV_CFG_SSHPORT},
+  {"sshunixsockets",         SV_CFG_SSHUNIXSOCKETS},
+  {"sshuser",                SV_CFG_SSHUSER},
+  {"startinglocalport",      SV_CFG_STARTINGLOCALPORT},
+  {"tcpbuffersize",          SV_CFG_TCPBUFFERSIZE},
+  {"tcpkeepalive",           SV_CFG_TCPKEEPALIVE},
+  {"tcpnodelay",             SV_CFG_TCPNODELAY},
+  {"type",                   SV_CFG_TYPE},
+  {"viewonly",               SV_CFG_VIEWONLY},
+  {"vncloginpass",           SV_CFG_VNCLOGINPASS},
+  {"vncloginuser",           SV_CFG_VNCLOGINUSER},
+  {"vncpass",                SV_CFG_VNCPASS},
+  {"vncport",                SV_CFG_VNCPORT}
+};
+
+/* hosts read by svConfigRead, waiting for svLoadHostList to list them */
+static std::vector<HostItem *> m_configHosts;
+
+
+/*  return the config key for a property name, or SV_CFG_UNKNOWN  */
+static SVConfigKey svConfigLookupKey (const char * strProp)
+{
+  size_t nLow = 0;
+  size_t nHigh = sizeof(m_configKeys) / sizeof(m_configKeys[0]);
 
-  // try to open config file
-  ifs.open(app->configPathAndFile.c_str(), std::ifstream::in);
+  while (nLow < nHigh)
+  {
+    size_t nMid = (nLow + nHigh) / 2;
+    int nCmp = strcmp(strProp, m_configKeys[nMid].strName);
 
-  // oops, can't open config file
-  if (ifs.fail())
-    return;
+    if (nCmp == 0)
+      return m_configKeys[nMid].key;
+
+    if (nCmp < 0)
+      nHigh = nMid;
+    else
+      nLow = nMid + 1;
+  }
 
-  // process hosts part of config file
-  while (!app->shuttingDown)
+  return SV_CFG_UNKNOWN;
+}
+
+
+/*
+  convert a config value to boolean
+  (same rules as svConvertStringToBoolean, without building a string)
+*/
+static bool svConfigBool (const char * strVal)
+{
+  static const char * strTrue[] = {"true", "yes", "on", "1"};
+
+  for (const char * strWord : strTrue)
   {
-    ifs.getline(strP, SV_MAX_PROP_LINE_LEN);
+    const char * p = strVal;
+    const char * w = strWord;
 
-    if (ifs.good())
+    while (*p && *w && std::tolower(static_cast<unsigned char>(*p)) == *w)
     {
-      strProp = svGetConfigProperty(strP);
-      strVal = svGetConfigValue(strP);
+      p ++;
+      w ++;
+    }
 
-      if (strP[0] != '\0' && strP[0] != '#')
-      {
-        // #############################################################################
-        // ######## per-connection options #############################################
-        // #############################################################################
+    if (*p == '\0' && *w == '\0')
+      return true;
+  }
 
-        // new host entry
-        if (strProp == "host")
-        {
-          // add last host entry to host list
-          if (itm && numOfEntries < SV_MAX_HOSTLIST_ENTRIES)
-          {
-            numOfEntries ++;
-            app->hostList->add(itm->name.c_str(), static_cast<void *>(itm));
-          }
+  return false;
+}
 
-          itm = new HostItem();
 
-          itm->name = strVal;
-        }
+/*  set one app option from the config file  */
+static void svConfigApplyAppOption (SVConfigKey key, const char * strVal)
+{
+  int w = 0;
 
-        // host address
-        if (strProp == "hostaddress")
-          itm->hostAddress = strVal;
+  switch (key)
+  {
+    // hostlist width
+    // NOTE: setting this too low may hide
+    // one or more of the buttons at the bottom of the hostlist
+    // such as 'options', 'help', 'listen'...
+    case SV_CFG_HOSTLISTWIDTH:
+      app->requestedListWidth = atoi(strVal);
+
+      if (app->requestedListWidth < 100)
+        app->requestedListWidth = 100;
+      break;
 
-        // group
-        if (strProp == "group")
-        {
-          itm->group = strVal;
+    // use colorblind icons?
+    case SV_CFG_COLORBLINDICONS:
+      app->colorBlindIcons = svConfigBool(strVal);
+      break;
 
-          if (strLastGroup != itm->group)
-          {
-            if (addSep)
-              // add a separator
-              // color 16 (@C16) is supposed to be gray colour
-              app->hostList->add("@C16@.· · ·");
-            else
-            {
-              // add empty row at top of list
-              app->hostList->add(" ");
-              addSep = true;
-            }
-          }
+    // scan timeout in seconds
+    case SV_CFG_SCANTIMEOUT:
+      w = atoi(strVal);
 
-          strLastGroup = itm->group;
-        }
+      if (w < 1)
+        w = 1;
 
-        // vnc port
-        if (strProp == "vncport")
-          itm->vncPort = strVal;
+      app->nScanTimeout = w;
+      break;
 
-        // ssh port
-        if (strProp == "sshport")
-          itm->sshPort = strVal;
+    // ssh command
+    case SV_CFG_SSHCOMMAND:
+      app->sshCommand = strVal;
 
-        // ssh key private file path
-        if (strProp == "sshkeyprivate")
-          itm->sshKeyPrivate = strVal;
+      if (app->sshCommand.empty())
+        app->sshCommand = "ssh";
+      break;
 
-        // ssh user
-        if (strProp == "sshuser")
-          itm->sshUser = strVal;
+    // starting local port number for ssh
+    case SV_CFG_STARTINGLOCALPORT:
+      w = atoi(strVal);
 
-        //// ssh password
-        //if (strProp == "sshpass")
-          //itm->sshPass = strVal;
+      if (w < 1)
+        w = 15000;
 
-        // vnc password (password authentication)
-        if (strProp == "vncpass")
-          itm->vncPassword = strVal;
+      app->nStartingLocalPort = w;
+      break;
 
-        // vnc login user (credential authentication)
-        if (strProp == "vncloginuser")
-          itm->vncLoginUser = strVal;
+    // how many local ports ssh forwards can use
+    case SV_CFG_LOCALPORTRANGE:
+      w = atoi(strVal);
 
-        // vnc login password (credential authentication)
-        if (strProp == "vncloginpass")
-          itm->vncLoginPassword = strVal;
+      if (w < 1)
+        w = 1000;
 
-        // host type
-        if (strProp == "type")
-        {
-          if (strVal == "s")
-            itm->hostType = 's';
-        }
+      app->nLocalPortRange = w;
+      break;
 
-        // F12 macro
-        if (strProp == "f12macro")
-          itm->f12Macro = strVal;
+    // forward ssh over unix-domain sockets instead of local ports?
+    case SV_CFG_SSHUNIXSOCKETS:
+      app->sshUnixSockets = svConfigBool(strVal);
+      break;
 
-        // scaling
-        if (strProp == "scale")
-        {
-          if (strVal == "f")
-            itm->scaling = 'f';
-          else if (strVal == "z")
-            itm->scaling = 'z';
-          else if (strVal == "s")
-            itm->scaling = 's';
-        }
+    // share one ssh connection per ssh server?
+    case SV_CFG_SSHCONTROLMASTER:
+      app->sshControlMaster = svConfigBool(strVal);
+      break;
 
-        // fast scaling?
-        if (strProp == "scalefast")
-          itm->scalingFast = svConvertStringToBoolean(strVal);
+    // display tooltips?
+    case SV_CFG_SHOWTOOLTIPS:
+      app->showTooltips = svConfigBool(strVal);
+      break;
 
-        // show remote cursor?
-        if (strProp == "showremotecursor")
-          itm->showRemoteCursor = svConvertStringToBoolean(strVal);
+    // log app events to file?
+    case SV_CFG_LOGTOFILE:
+      app->enableLogToFile = svConfigBool(strVal);
+      break;
 
-        // compression level
-        if (strProp == "compression")
-        {
-          itm->compressLevel = atoi(strVal.c_str());
+    // right-click immediately closes connection
+    case SV_CFG_RIGHTCLICKTOCLOSE:
+      app->rightClickToClose = svConfigBool(strVal);
+      break;
 
-          if (itm->compressLevel > 9)
-            itm->compressLevel = 9;
-        }
+    // display debug messages?
+    case SV_CFG_DEBUGMODE:
+      app->debugMode = svConfigBool(strVal);
+      break;
 
-        // quality level
-        if (strProp == "quality")
-        {
-          itm->qualityLevel = atoi(strVal.c_str());
+    // decode screen updates in a background thread?
+    case SV_CFG_DECODEINTHREAD:
+      app->decodeInThread = svConfigBool(strVal);
+      break;
 
-          if (itm->qualityLevel > 9)
-            itm->qualityLevel = 9;
-        }
+    // maximum automatic reconnects in progress at once
+    case SV_CFG_MAXRECONNECTS:
+      w = atoi(strVal);
 
-        //// center x?
-        //if (strProp == "centerx")
-          //itm->centerX = svConvertStringToBoolean(strVal);
+      if (w < 1)
+        w = 1;
 
-        //// center y?
-        //if (strProp == "centery")
-          //itm->centerY = svConvertStringToBoolean(strVal);
+      app->nMaxReconnects = w;
+      break;
 
-        // quicknote
-        if (strProp == "quicknote")
-          itm->quickNote = base64Decode(strVal);
+    // minutes before an unused connection is suspended (0 is off)
+    case SV_CFG_IDLESUSPENDMINS:
+      w = atoi(strVal);
 
-        // last connected time
-        if (strProp == "lastconnecttime")
-          itm->lastConnectedTime = strVal;
+      if (w < 0)
+        w = 0;
 
-        // view only
-        if (strProp == "viewonly")
-          itm->viewOnly= svConvertStringToBoolean(strVal);
+      app->nIdleSuspendMins = w;
+      break;
 
-        // custom command 1 enabled?
-        if (strProp == "customcommand1enabled")
-          itm->customCommand1Enabled = svConvertStringToBoolean(strVal);
+    // seconds between host reachability probes (0 is off)
+    case SV_CFG_PROBEINTERVAL:
+      w = atoi(strVal);
 
-        // custom command 1 label
-        if (strProp == "customcommand1label")
-          itm->customCommand1Label = strVal;
+      if (w < 0)
+        w = 0;
 
-        // custom command 1
-        if (strProp == "customcommand1")
-          itm->customCommand1 = strVal;
+      app->nProbeInterval = w;
+      break;
 
-        // custom command 2 enabled?
-        if (strProp == "customcommand2enabled")
-          itm->customCommand2Enabled = svConvertStringToBoolean(strVal);
+    // app font size
+    case SV_CFG_APPFONTSIZE:
+      app->nAppFontSize = atoi(strVal);
 
-        // custom command 2 label
-        if (strProp == "customcommand2label")
-          itm->customCommand2Label = strVal;
+      // fix minimum app font size
+      if (app->nAppFontSize < SV_APP_FONT_SIZE_MIN)
+        app->nAppFontSize = SV_APP_FONT_SIZE_MIN;
 
-        // custom command 2
-        if (strProp == "customcommand2")
-          itm->customCommand2 = strVal;
+      // fix maximum app font size
+      if (app->nAppFontSize > SV_APP_FONT_SIZE_MAX)
+        app->nAppFontSize = SV_APP_FONT_SIZE_MAX;
+      break;
 
-        // custom command 3 enabled?
-        if (strProp == "customcommand3enabled")
-          itm->customCommand3Enabled = svConvertStringToBoolean(strVal);
+    // list font
+    case SV_CFG_LISTFONT:
+      if (strVal[0] != '\0')
+        app->strListFont = strVal;
+      break;
 
-        // custom command 3 label
-        if (strProp == "customcommand3label")
-          itm->customCommand3Label = strVal;
+    // list font size
+    case SV_CFG_LISTFONTSIZE:
+      app->nListFontSize = atoi(strVal);
 
-        // custom command 3
-        if (strProp == "customcommand3")
-          itm->customCommand3 = strVal;
-      }
+      // fix minimum list font size
+      if (app->nListFontSize < SV_LIST_FONT_SIZE_MIN)
+        app->nListFontSize = SV_LIST_FONT_SIZE_MIN;
+
+      // fix maximum list font size
+      if (app->nListFontSize > SV_LIST_FONT_SIZE_MAX)
+        app->nListFontSize = SV_LIST_FONT_SIZE_MAX;
+      break;
+
+    // saved x position
+    case SV_CFG_SAVEDX:
+      app->savedX = atoi(strVal);
+
+      if (app->savedX < 1)
+        app->savedX = 0;
+      break;
+
+    // saved y position
+    case SV_CFG_SAVEDY:
+      app->savedY = atoi(strVal);
+
+      if (app->savedY < 1)
+        app->savedY = 0;
+      break;
+
+    // saved width
+    case SV_CFG_SAVEDW:
+      app->savedW = atoi(strVal);
+
+      if (app->savedW < 1)
+        app->savedW = 800;
+      break;
+
+    // saved height
+    case SV_CFG_SAVEDH:
+      app->savedH = atoi(strVal);
+
+      if (app->savedH < 1)
+        app->savedH = 600;
+      break;
+
+    // display message when reverse connections connect?
+    case SV_CFG_SHOWREVERSECONNECT:
+      app->showReverseConnect = svConfigBool(strVal);
+      break;
+
+    // maximize if last window state was maximized
+    case SV_CFG_MAXIMIZED:
+      app->maximized = svConfigBool(strVal);
+      break;
+
+    // host list button position - top or bottom
+    case SV_CFG_BUTTONSONTOP:
+      app->buttonsOnTop = svConfigBool(strVal);
+      break;
+
+    // message loop wait time
+    case SV_CFG_MSGLOOPSPEED:
+      app->messageLoopSpeed = atoi(strVal);
+
+      svValidateAndSetMessageLoopSpeed();
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+/*
+  convert a keepalive time in seconds, using nDefault when it's
+  missing or below 1 and capping it where the kernel does
+*/
+static uint16_t svKeepAliveSecs (const char * strVal, uint16_t nDefault)
+{
+  int n = atoi(strVal);
+
+  if (n < 1)
+    return nDefault;
+
+  if (n > SV_TCP_KEEPALIVE_MAX_SECS)
+    n = SV_TCP_KEEPALIVE_MAX_SECS;
+
+  return static_cast<uint16_t>(n);
+}
+
+
+/*  set one per-connection option from the config file  */
+static void svConfigApplyHostProperty (HostItem * itm, SVConfigKey key, const char * strVal)
+{
+  int n = 0;
+
+  switch (key)
+  {
+    // host address
+    case SV_CFG_HOSTADDRESS:
+      itm->hostAddress = strVal;
+      break;
+
+    // group
+    case SV_CFG_GROUP:
+      itm->group = strVal;
+      break;
+
+    // vnc port
+    case SV_CFG_VNCPORT:
+      itm->vncPort = strVal;
+      break;
+
+    // ssh port
+    case SV_CFG_SSHPORT:
+      itm->sshPort = strVal;
+      break;
+
+    // ssh key private file path
+    case SV_CFG_SSHKEYPRIVATE:
+      itm->sshKeyPrivate = strVal;
+      break;
+
+    // ssh user
+    case SV_CFG_SSHUSER:
+      itm->sshUser = strVal;
+      break;
+
+    // vnc password (password authentication)
+    case SV_CFG_VNCPASS:
+      itm->vncPassword = strVal;
+      break;
+
+    // vnc login user (credential authentication)
+    case SV_CFG_VNCLOGINUSER:
+      itm->vncLoginUser = strVal;
+      break;
+
+    // vnc login password (credential authentication)
+    case SV_CFG_VNCLOGINPASS:
+      itm->vncLoginPassword = strVal;
+      break;
+
+    // host type
+    case SV_CFG_TYPE:
+      if (strcmp(strVal, "s") == 0)
+        itm->hostType = 's';
+      break;
+
+    // F12 macro
+    case SV_CFG_F12MACRO:
+      itm->f12Macro = strVal;
+      break;
+
+    // scaling
+    case SV_CFG_SCALE:
+      if (strcmp(strVal, "f") == 0)
+        itm->scaling = 'f';
+      else if (strcmp(strVal, "z") == 0)
+        itm->scaling = 'z';
+      else if (strcmp(strVal, "s") == 0)
+        itm->scaling = 's';
+      break;
+
+    // fast scaling?
+    case SV_CFG_SCALEFAST:
+      itm->scalingFast = svConfigBool(strVal);
+      break;
+
+    // show remote cursor?
+    case SV_CFG_SHOWREMOTECURSOR:
+      itm->showRemoteCursor = svConfigBool(strVal);
+      break;
+
+    // compression level
+    case SV_CFG_COMPRESSION:
+      itm->compressLevel = atoi(strVal);
+
+      if (itm->compressLevel > 9)
+        itm->compressLevel = 9;
+      break;
+
+    // quality level
+    case SV_CFG_QUALITY:
+      itm->qualityLevel = atoi(strVal);
+
+      if (itm->qualityLevel > 9)
+        itm->qualityLevel = 9;
+      break;
+
+    // delay between paced key presses (milliseconds)
+    case SV_CFG_KEYDELAY:
+      n = atoi(strVal);
+
+      if (n < 0)
+        n = 0;
+
+      if (n > 1000)
+        n = 1000;
+
+      itm->keyDelay = n;
+      break;
+
+    // tcp tuning
+    case SV_CFG_TCPNODELAY:
+      itm->tcpNoDelay = svConfigBool(strVal);
+      break;
+
+    case SV_CFG_TCPBUFFERSIZE:
+      n = atoi(strVal);
+
+      if (n < 0)
+        n = 0;
+
+      if (n > 16384)
+        n = 16384;
+
+      itm->tcpBufferSize = n;
+      break;
+
+    case SV_CFG_TCPKEEPALIVE:
+      itm->tcpKeepAlive = svConfigBool(strVal);
+      break;
+
+    // reconnect automatically after unexpected disconnects?
+    case SV_CFG_AUTORECONNECT:
+      itm->autoReconnect = svConfigBool(strVal);
+      break;
+
+    case SV_CFG_KEEPALIVEIDLE:
+      itm->keepAliveIdle = svKeepAliveSecs(strVal, 60);
+      break;
+
+    case SV_CFG_KEEPALIVEINTERVAL:
+      itm->keepAliveInterval = svKeepAliveSecs(strVal, 10);
+      break;
+
+    // colour depth (8, 16 or 24 bpp)
+    case SV_CFG_COLORDEPTH:
+      itm->colorDepth = atoi(strVal);
+
+      if (itm->colorDepth != 8 && itm->colorDepth != 16)
+        itm->colorDepth = 24;
+      break;
+
+    // quicknote (kept encoded until svQuickNote first needs it)
+    case SV_CFG_QUICKNOTE:
+      itm->quickNote = strVal;
+      itm->quickNoteEncoded = true;
+      break;
+
+    // last connected time
+    case SV_CFG_LASTCONNECTTIME:
+      itm->lastConnectedTime = strVal;
+      break;
+
+    // view only
+    case SV_CFG_VIEWONLY:
+      itm->viewOnly = svConfigBool(strVal);
+      break;
+
+    // custom command 1 enabled?
+    case SV_CFG_CUSTOMCOMMAND1ENABLED:
+      itm->customCommand1Enabled = svConfigBool(strVal);
+      break;
+
+    // custom command 1 label
+    case SV_CFG_CUSTOMCOMMAND1LABEL:
+      itm->customCommand1Label = strVal;
+      break;
+
+    // custom command 1
+    case SV_CFG_CUSTOMCOMMAND1:
+      itm->customCommand1 = strVal;
+      break;
+
+    // custom command 2 enabled?
+    case SV_CFG_CUSTOMCOMMAND2ENABLED:
+      itm->customCommand2Enabled = svConfigBool(strVal);
+      break;
+
+    // custom command 2 label
+    case SV_CFG_CUSTOMCOMMAND2LABEL:
+      itm->customCommand2Label = strVal;
+      break;
+
+    // custom command 2
+    case SV_CFG_CUSTOMCOMMAND2:
+      itm->customCommand2 = strVal;
+      break;
+
+    // custom command 3 enabled?
+    case SV_CFG_CUSTOMCOMMAND3ENABLED:
+      itm->customCommand3Enabled = svConfigBool(strVal);
+      break;
+
+    // custom command 3 label
+    case SV_CFG_CUSTOMCOMMAND3LABEL:
+      itm->customCommand3Label = strVal;
+      break;
+
+    // custom command 3
+    case SV_CFG_CUSTOMCOMMAND3:
+      itm->customCommand3 = strVal;
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+/*
+  parse the whole config file in one pass, setting app options unless
+  readAppOptions is false and collecting host entries unless readHosts is false
+  (lines are split in place, so strConfig is modified)
+*/
+static void svConfigParse (std::string& strConfig, std::vector<HostItem *>& hosts, bool readAppOptions,
+  bool readHosts)
+{
+  HostItem * itm = NULL;
+  char * p = &strConfig[0];
+  char * pEnd = p + strConfig.size();
+
+  while (p < pEnd)
+  {
+    char * strLine = p;
+    char * pNewline = static_cast<char *>(memchr(p, '\n', pEnd - p));
+
+    if (!pNewline)
+      pNewline = pEnd;
+
+    *pNewline = '\0';
+    p = pNewline + 1;
+
+    // tolerate files saved with windows line endings
+    if (pNewline > strLine && pNewline[-1] == '\r')
+      pNewline[-1] = '\0';
+
+    if (strLine[0] == '\0' || strLine[0] == '#')
+      continue;
+
+    char * strVal = strchr(strLine, '=');
+
+    if (!strVal)
+      continue;
+
+    *strVal = '\0';
+    strVal ++;
+
+    SVConfigKey key = svConfigLookupKey(strLine);
+
+    if (key == SV_CFG_UNKNOWN)
+      continue;
+
+    // new host entry
+    if (key == SV_CFG_HOST)
+    {
+      // app options all come before the first host
+      if (!readHosts || hosts.size() >= SV_MAX_HOSTLIST_ENTRIES)
+        break;
+
+      itm = svHostItemNew();
+
+      if (!itm)
+        break;
+
+      itm->name = strVal;
+
+      hosts.push_back(itm);
     }
-    else
+    else if (key < SV_CFG_HOST)
     {
-      // add last host entry to host list
-      if (itm && numOfEntries < SV_MAX_HOSTLIST_ENTRIES)
-        app->hostList->add(itm->name.c_str(), itm);
+      if (readAppOptions)
+        svConfigApplyAppOption(key, strVal);
+    }
+    else if (itm)
+      svConfigApplyHostProperty(itm, key, strVal);
+  }
+}
 
-      // add a separator
-      if (addSep)
-        // color 16 (@C16.) is supposed to be gray
-        app->hostList->add("@C16@.· · ·");
 
-      break;
-    }
+/*  read the whole config file into strConfig  */
+bool svConfigLoadFile (std::string& strConfig)
+{
+  std::ifstream ifs(app->configPathAndFile.c_str(), std::ifstream::in | std::ifstream::binary);
+
+  if (ifs.fail())
+    return false;
+
+  ifs.seekg(0, std::ifstream::end);
+  std::streamoff nSize = ifs.tellg();
+  ifs.seekg(0, std::ifstream::beg);
+
+  if (nSize < 0)
+    return false;
+
+  strConfig.resize(static_cast<size_t>(nSize));
+
+  if (nSize > 0)
+    ifs.read(&strConfig[0], nSize);
+
+  strConfig.resize(static_cast<size_t>(ifs.gcount()));
+
+  return true;
+}
+
+
+/*
+  set one per-connection option by its config file name, returning
+  false when strProp isn't a per-connection option
+*/
+bool svConfigSetHostProperty (HostItem * itm, const char * strProp, const char * strVal)
+{
+  SVConfigKey key = svConfigLookupKey(strProp);
+
+  if (key <= SV_CFG_HOST)
+    return false;
+
+  svConfigApplyHostProperty(itm, key, strVal);
+
+  return true;
+}
+
+
+/*
+  parse only the host entries of strConfig into hosts
+  (safe to call off the main thread, it doesn't touch app options)
+*/
+void svConfigParseHosts (std::string& strConfig, std::vector<HostItem *>& hosts)
+{
+  svConfigParse(strConfig, hosts, false, true);
+}
+
+
+/*
+  collect the config file's hosts into m_configHosts, from the binary
+  cache when it was made from this exact text, otherwise by parsing
+  (lines are split in place, so strConfig is modified)
+*/
+static void svConfigCollectHosts (std::string& strConfig, bool readAppOptions)
+{
+  if (svHostCacheLoad(strConfig, m_configHosts))
+  {
+    if (readAppOptions)
+      svConfigParse(strConfig, m_configHosts, true, false);
+
+    return;
   }
 
-  ifs.close();
+  // parse everything and rebuild the cache for next time
+  std::string strConfigText = strConfig;
+
+  svConfigParse(strConfig, m_configHosts, readAppOptions, true);
+  svHostCacheSave(strConfigText, m_configHosts);
 }
 
 
 /*
-  read from the config file, set app
-  options and populate host list
+  add the hosts svConfigRead collected to the host list,
+  with separators between groups
 */
-void svConfigRead ()
+void svLoadHostList ()
 {
-  std::ifstream ifs;
-  char strP[SV_MAX_PROP_LINE_LEN] = {0};
-  std::string strProp;
-  std::string strVal;
+  std::string strLastGroup;
+  bool addSep = false;
 
-  // try to open config file
-  ifs.open(app->configPathAndFile.c_str(), std::ifstream::in);
+  app->hostList->clear();
 
-  // oops, can't open config file
-  if (ifs.fail())
+  // the gui is being rebuilt, so read the hosts svConfigWrite just saved
+  if (m_configHosts.empty())
   {
-    std::cout << "SpiritVNC - Could not open config file.  Using defaults" << std::endl;
-    svConfigCreateNewDir();
-    return;
-  }
+    std::string strConfig;
 
-  svLogToFile("--- Program started up ---");
+    if (svConfigLoadFile(strConfig))
+    {
+      svConfigWatchSetText(strConfig);
+      svConfigCollectHosts(strConfig, false);
+    }
+  }
 
-  while (!app->shuttingDown)
+  for (HostItem * itm : m_configHosts)
   {
-    ifs.getline(strP, SV_MAX_PROP_LINE_LEN);
-
-    if (ifs.good())
+    if (strLastGroup != itm->group)
     {
-      strProp = svGetConfigProperty(strP);
-      strVal = svGetConfigValue(strP);
-
-      if (strP[0] != '\0' && strP[0] != '#')
+      if (addSep)
+        // add a separator
+        // color 16 (@C16) is supposed to be gray colour
+        app->hostList->add("@C16@.· · ·");
+      else
       {
-        // ########## app options ###################################
-
-        // hostlist width
-        // NOTE: setting this too low may hide
-        // one or more of the buttons at the bottom of the hostlist
-        // such as 'options', 'help', 'listen'...
-        if (strProp == "hostlistwidth")
-        {
-          app->requestedListWidth = atoi(strVal.c_str());
+        // add empty row at top of list
+        app->hostList->add(" ");
+        addSep = true;
+      }
+    }
 
-          if (app->requestedListWidth < 100)
-            app->requestedListWidth = 100;
-        }
+    strLastGroup = itm->group;
 
-        // use colorblind icons?
-        if (strProp == "colorblindicons")
-          app->colorBlindIcons = svConvertStringToBoolean(strVal);
+    app->hostList->add(itm->name.c_str(), static_cast<void *>(itm));
+  }
 
-        // scan timeout in seconds
-        if (strProp == "scantimeout")
-        {
-          int w = atoi(strVal.c_str());
+  // add a separator
+  if (addSep)
+    // color 16 (@C16.) is supposed to be gray
+    app->hostList->add("@C16@.· · ·");
 
-          if (w < 1)
-            w = 1;
+  // index the new hosts for the search box in the background
+  svSearchIndexBuild();
 
-          app->nScanTimeout = w;
-        }
+  m_searchActive = false;
+  m_searchShownRows.clear();
 
-        // ssh command
-        if (strProp == "sshcommand")
-        {
-          app->sshCommand = strVal;
+  m_configHosts.clear();
+  m_configHosts.shrink_to_fit();
 
-          if (app->sshCommand.empty())
-            app->sshCommand = "ssh";
-        }
+  // look up vnc host addresses in the background so first connects don't wait on dns
+  int nSize = app->hostList->size();
 
-        // starting local port number for ssh
-        if (strProp == "startinglocalport")
-        {
-          int w = atoi(strVal.c_str());
+  for (int i = 0; i <= nSize; i ++)
+  {
+    const HostItem * itmLookup = static_cast<HostItem *>(app->hostList->data(i));
 
-          if (w < 1)
-            w = 15000;
+    if (itmLookup && itmLookup->hostType == 'v' && !itmLookup->state().isListener)
+      svResolverPrewarm(itmLookup->hostAddress);
+  }
+}
 
-          app->nStartingLocalPort = w;
-        }
 
-        // display tooltips?
-        if (strProp == "showtooltips")
-          app->showTooltips = svConvertStringToBoolean(strVal);
+/*
+  read from the config file, set app options and
+  collect hosts for svLoadHostList
+*/
+void svConfigRead ()
+{
+  std::string strConfig;
 
-        // log app events to file?
-        if (strProp == "logtofile")
-          app->enableLogToFile = svConvertStringToBoolean(strVal);
+  // try to read config file
+  if (!svConfigLoadFile(strConfig))
+  {
+    std::cout << "SpiritVNC - Could not open config file.  Using defaults" << std::endl;
+    svConfigCreateNewDir();
+    return;
+  }
 
-        // right-click immediately closes connection
-        if (strProp == "rightclicktoclose")
-          app->rightClickToClose = svConvertStringToBoolean(strVal);
+  svLogToFile("--- Program started up ---");
 
-        // display debug messages?
-        if (strProp == "debugmode")
-          app->debugMode = svConvertStringToBoolean(strVal);
+  // so the config watcher knows this text is already loaded
+  svConfigWatchSetText(strConfig);
 
-        // app font size
-        if (strProp == "appfontsize")
-        {
-          app->nAppFontSize = atoi(strVal.c_str());
+  svConfigCollectHosts(strConfig, true);
+}
 
-          // fix minimum app font size
-          if (app->nAppFontSize < SV_APP_FONT_SIZE_MIN)
-            app->nAppFontSize = SV_APP_FONT_SIZE_MIN;
 
-          // fix maximum app font size
-          if (app->nAppFontSize > SV_APP_FONT_SIZE_MAX)
-            app->nAppFontSize = SV_APP_FONT_SIZE_MAX;
-        }
+/*
+  serialize one host's config block, reusing the cached
+  block until the host is marked dirty
+*/
+const std::string& svConfigHostBlock (HostItem * itm)
+{
+  if (!itm->configDirty && !itm->configBlock.empty())
+    return itm->configBlock;
+
+  std::ostringstream oss;
+
+  oss << "host=" << itm->name << '\n';
+  oss << "group=" << itm->group << '\n';
+  oss << "hostaddress=" << itm->hostAddress << '\n';
+  oss << "vncport=" << itm->vncPort << '\n';
+  oss << "sshport=" << itm->sshPort << '\n';
+  oss << "vncpass=" << itm->vncPassword << '\n';
+  oss << "vncloginuser=" << itm->vncLoginUser << '\n';
+  oss << "vncloginpass=" << itm->vncLoginPassword << '\n';
+  oss << "type=" << itm->hostType << '\n';
+  oss << "sshkeyprivate=" << itm->sshKeyPrivate << '\n';
+  oss << "sshuser=" << itm->sshUser << '\n';
+  //oss << "sshpass=" << itm->sshPass << '\n';
+  oss << "scale=" << itm->scaling << '\n';
+  oss << "scalefast=" << svConvertBooleanToString(itm->scalingFast) << '\n';
+  oss << "f12macro=" << itm->f12Macro << '\n';
+  oss << "keydelay=" << std::to_string(itm->keyDelay) << '\n';
+  oss << "showremotecursor=" << svConvertBooleanToString(itm->showRemoteCursor) << '\n';
+  oss << "compression=" << std::to_string(itm->compressLevel) << '\n';
+  oss << "quality=" << std::to_string(itm->qualityLevel) << '\n';
+  oss << "colordepth=" << std::to_string(itm->colorDepth) << '\n';
+  oss << "tcpnodelay=" << svConvertBooleanToString(itm->tcpNoDelay) << '\n';
+  oss << "tcpbuffersize=" << std::to_string(itm->tcpBufferSize) << '\n';
+  oss << "tcpkeepalive=" << svConvertBooleanToString(itm->tcpKeepAlive) << '\n';
+  oss << "keepaliveidle=" << std::to_string(itm->keepAliveIdle) << '\n';
+  oss << "keepaliveinterval=" << std::to_string(itm->keepAliveInterval) << '\n';
+  oss << "autoreconnect=" << svConvertBooleanToString(itm->autoReconnect) << '\n';
+  //oss << "ignoreinactive=" << svConvertBooleanToString(itm->ignoreInactive) << '\n';
+  //oss << "centerx=" << svConvertBooleanToString(itm->centerX) << '\n';
+  //oss << "centery=" << svConvertBooleanToString(itm->centerY) << '\n';
+  // a note nobody has looked at is still in its saved form
+  if (itm->quickNoteEncoded)
+    oss << "quicknote=" << itm->quickNote << '\n';
+  else
+    oss << "quicknote=" << base64Encode(reinterpret_cast<const unsigned char *>
+      (itm->quickNote.c_str()), itm->quickNote.size()) << '\n';
+  oss << "lastconnecttime=" << itm->lastConnectedTime << '\n';
+  oss << "viewonly=" << svConvertBooleanToString(itm->viewOnly) << '\n';
+  oss << "customcommand1enabled=" << svConvertBooleanToString(itm->customCommand1Enabled) << '\n';
+  oss << "customcommand1label=" << itm->customCommand1Label << '\n';
+  oss << "customcommand1=" << itm->customCommand1 << '\n';
+  oss << "customcommand2enabled=" << svConvertBooleanToString(itm->customCommand2Enabled) << '\n';
+  oss << "customcommand2label=" << itm->customCommand2Label << '\n';
+  oss << "customcommand2=" << itm->customCommand2 << '\n';
+  oss << "customcommand3enabled=" << svConvertBooleanToString(itm->customCommand3Enabled) << '\n';
+  oss << "customcommand3label=" << itm->customCommand3Label << '\n';
+  oss << "customcommand3=" << itm->customCommand3 << '\n';
+
+  oss << '\n';
+
+  itm->configBlock = oss.str();
+  itm->configDirty = false;
+
+  return itm->configBlock;
+}
 
-        // list font
-        if (strProp == "listfont")
-        {
-          if (!strVal.empty())
-            app->strListFont = strVal;
-        }
 
-        // list font size
-        if (strProp == "listfontsize")
-        {
-          app->nListFontSize = atoi(strVal.c_str());
+/*
+  write strData to the config file through a temp file that is synced
+  and renamed over it, so a crash leaves either the old or the new file
+*/
+static bool svConfigWriteFileAtomic (const std::string& strData)
+{
+  std::string strTemp = app->configPathAndFile + ".tmp";
 
-          // fix minimum list font size
-          if (app->nListFontSize < SV_LIST_FONT_SIZE_MIN)
-            app->nListFontSize = SV_LIST_FONT_SIZE_MIN;
+  #ifdef _WIN32
+  FILE * f = fopen(strTemp.c_str(), "wb");
 
-          // fix maximum list font size
-          if (app->nListFontSize > SV_LIST_FONT_SIZE_MAX)
-            app->nListFontSize = SV_LIST_FONT_SIZE_MAX;
-        }
+  if (!f)
+    return false;
 
-        // saved x position
-        if (strProp == "savedx")
-        {
-          app->savedX = atoi(strVal.c_str());
+  bool isOkay = fwrite(strData.data(), 1, strData.size(), f) == strData.size() && fflush(f) == 0 &&
+    _commit(_fileno(f)) == 0;
 
-          if (app->savedX < 1)
-            app->savedX = 0;
-        }
+  if (fclose(f) != 0)
+    isOkay = false;
 
-        // saved y position
-        if (strProp == "savedy")
-        {
-          app->savedY = atoi(strVal.c_str());
+  if (isOkay)
+    isOkay = MoveFileExA(strTemp.c_str(), app->configPathAndFile.c_str(),
+      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+  #else
+  int nFd = open(strTemp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
 
-          if (app->savedY < 1)
-            app->savedY = 0;
-        }
+  if (nFd < 0)
+    return false;
 
-        // saved width
-        if (strProp == "savedw")
-        {
-          app->savedW = atoi(strVal.c_str());
+  bool isOkay = true;
+  const char * p = strData.data();
+  size_t nLeft = strData.size();
 
-          if (app->savedW < 1)
-            app->savedW = 800;
-        }
+  while (nLeft > 0)
+  {
+    ssize_t nWritten = write(nFd, p, nLeft);
 
-        // saved height
-        if (strProp == "savedh")
-        {
-          app->savedH = atoi(strVal.c_str());
+    if (nWritten < 0)
+    {
+      if (errno == EINTR)
+        continue;
 
-          if (app->savedH < 1)
-            app->savedH = 600;
-        }
+      isOkay = false;
+      break;
+    }
 
-        // display message when reverse connections connect?
-        if (strProp == "showreverseconnect")
-          app->showReverseConnect = svConvertStringToBoolean(strVal);
+    p += nWritten;
+    nLeft -= nWritten;
+  }
 
-        // maximize if last window state was maximized
-        if (strProp == "maximized")
-          app->maximized = svConvertStringToBoolean(strVal);
+  if (isOkay && fsync(nFd) != 0)
+    isOkay = false;
 
-        // host list button position - top or bottom
-        if (strProp == "buttonsontop")
-          app->buttonsOnTop = svConvertStringToBoolean(strVal);
+  if (close(nFd) != 0)
+    isOkay = false;
 
-        // message loop wait time
-        if (strProp == "msgloopspeed")
-        {
-          app->messageLoopSpeed = atoi(strVal.c_str());
+  if (isOkay)
+    isOkay = rename(strTemp.c_str(), app->configPathAndFile.c_str()) == 0;
+  #endif
 
-          svValidateAndSetMessageLoopSpeed();
-        }
-      }
-    }
-    else
-      break;
-  }
+  if (!isOkay)
+    remove(strTemp.c_str());
 
-  ifs.close();
+  return isOkay;
 }
 
 
@@ -719,141 +1474,140 @@ void svConfigWrite ()
 
   inConfigWrite = true;
 
-  // output stream
-  std::ofstream ofs;
-
-  // open our config file
-  ofs.open(app->configPathAndFile.c_str());
-
-  // oops, can't open config file
-  if (ofs.fail())
-  {
-    std::cout << "SpiritVNC ERROR - Could not open config file for writing" << std::endl;
-    inConfigWrite = false;
-    return;
-  }
+  std::ostringstream oss;
 
   // write header
-  ofs << "# SpiritVNC-FLTK config file" <<  std::endl;
-  ofs << "# Generated by program version " SV_APP_VERSION << std::endl;
-  ofs << "#" << std::endl;
-  ofs << "# option names / properties should always be lower-case without spaces" << std::endl;
-  ofs << "# host type can be 'v' for vnc and 's' for vnc through ssh" << std::endl;
-  ofs << "# scale can be 's' for scrolled, 'z' for scale up/down and 'f' for scale"
-      " down only" << std::endl;
-  ofs << std::endl;
+  oss << "# SpiritVNC-FLTK config file" << '\n';
+  oss << "# Generated by program version " SV_APP_VERSION << '\n';
+  oss << "#" << '\n';
+  oss << "# option names / properties should always be lower-case without spaces" << '\n';
+  oss << "# host type can be 'v' for vnc and 's' for vnc through ssh" << '\n';
+  oss << "# scale can be 's' for scrolled, 'z' for scale up/down and 'f' for scale"
+      " down only" << '\n';
+  oss << '\n';
 
   // app options
-  ofs << "# program options" << std::endl;
+  oss << "# program options" << '\n';
 
   // hostlist width
-  ofs << "hostlistwidth=" << app->requestedListWidth << std::endl;
+  oss << "hostlistwidth=" << app->requestedListWidth << '\n';
 
   // colorblind icons
-  ofs << "colorblindicons=" << svConvertBooleanToString(app->colorBlindIcons) << std::endl;
+  oss << "colorblindicons=" << svConvertBooleanToString(app->colorBlindIcons) << '\n';
 
   // scan timeout in seconds
-  ofs << "scantimeout=" << app->nScanTimeout << std::endl;
+  oss << "scantimeout=" << app->nScanTimeout << '\n';
 
   // starting local port number (+99) for ssh connections
-  ofs << "startinglocalport=" << app->nStartingLocalPort << std::endl;
+  oss << "startinglocalport=" << app->nStartingLocalPort << '\n';
+
+  // how many local ports ssh forwards can use
+  oss << "localportrange=" << app->nLocalPortRange << '\n';
+
+  // forward ssh over unix-domain sockets instead of local ports
+  oss << "sshunixsockets=" << svConvertBooleanToString(app->sshUnixSockets) << '\n';
+
+  // share one ssh connection per ssh server
+  oss << "sshcontrolmaster=" << svConvertBooleanToString(app->sshControlMaster) << '\n';
 
   // ssh command
-  ofs << "sshcommand=" << app->sshCommand << std::endl;
+  oss << "sshcommand=" << app->sshCommand << '\n';
 
   // show tool tips
-  ofs << "showtooltips=" << svConvertBooleanToString(app->showTooltips) << std::endl;
+  oss << "showtooltips=" << svConvertBooleanToString(app->showTooltips) << '\n';
 
   // log app events to file
-  ofs << "logtofile=" << svConvertBooleanToString(app->enableLogToFile) << std::endl;
+  oss << "logtofile=" << svConvertBooleanToString(app->enableLogToFile) << '\n';
 
   // right-click immediately closes connection
-  ofs << "rightclicktoclose=" << svConvertBooleanToString(app->rightClickToClose) << std::endl;
+  oss << "rightclicktoclose=" << svConvertBooleanToString(app->rightClickToClose) << '\n';
 
   // show debugging messages
-  ofs << "debugmode=" << svConvertBooleanToString(app->debugMode) << std::endl;
+  oss << "debugmode=" << svConvertBooleanToString(app->debugMode) << '\n';
+
+  // decode screen updates in a background thread
+  oss << "decodeinthread=" << svConvertBooleanToString(app->decodeInThread) << '\n';
+
+  // maximum automatic reconnects in progress at once
+  oss << "maxreconnects=" << app->nMaxReconnects << '\n';
+
+  // minutes before an unused connection is suspended
+  oss << "idlesuspendmins=" << app->nIdleSuspendMins << '\n';
+
+  // seconds between host reachability probes
+  oss << "probeinterval=" << app->nProbeInterval << '\n';
 
   // show reverse-connect message
-  ofs << "showreverseconnect=" << svConvertBooleanToString(app->showReverseConnect) << std::endl;
+  oss << "showreverseconnect=" << svConvertBooleanToString(app->showReverseConnect) << '\n';
 
   // app font size
-  ofs << "appfontsize=" << app->nAppFontSize << std::endl;
+  oss << "appfontsize=" << app->nAppFontSize << '\n';
 
   // list font
-  ofs << "listfont=" << app->strListFont << std::endl;
-  ofs << "listfontsize=" << app->nListFontSize << std::endl;
+  oss << "listfont=" << app->strListFont << '\n';
+  oss << "listfontsize=" << app->nListFontSize << '\n';
 
   // saved position and size
-  ofs << "savedx=" << app->savedX << std::endl;
-  ofs << "savedy=" << app->savedY << std::endl;
-  ofs << "savedw=" << app->savedW << std::endl;
-  ofs << "savedh=" << app->savedH << std::endl;
+  oss << "savedx=" << app->savedX << '\n';
+  oss << "savedy=" << app->savedY << '\n';
+  oss << "savedw=" << app->savedW << '\n';
+  oss << "savedh=" << app->savedH << '\n';
 
-  ofs << "maximized=" << app->maximized << std::endl;
+  oss << "maximized=" << app->maximized << '\n';
 
   // buttons on top or bottom
-  ofs << "buttonsontop=" << svConvertBooleanToString(app->buttonsOnTop) << std::endl;
+  oss << "buttonsontop=" << svConvertBooleanToString(app->buttonsOnTop) << '\n';
 
   // vnc message loop wait time
-  ofs << "msgloopspeed=" << app->messageLoopSpeed << std::endl;
+  oss << "msgloopspeed=" << app->messageLoopSpeed << '\n';
 
   // blank line
-  ofs << std::endl;
+  oss << '\n';
 
   // host list entries
-  ofs << "# host-list entries" << std::endl;
+  oss << "# host-list entries" << '\n';
 
-  uint16_t nSize = app->hostList->size();
+  int nSize = app->hostList->size();
+  std::vector<HostItem *> hosts;
+
+  hosts.reserve(nSize);
 
-  for (uint16_t i = 0; i <= nSize; i ++)
+  // hosts that haven't changed since the last write reuse their cached block
+  for (int i = 0; i <= nSize; i ++)
   {
     HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
 
-    if (!itm || itm->isListener)
+    if (!itm || itm->state().isListener)
       continue;
 
-    ofs << "host=" << itm->name << std::endl;
-    ofs << "group=" << itm->group << std::endl;
-    ofs << "hostaddress=" << itm->hostAddress << std::endl;
-    ofs << "vncport=" << itm->vncPort << std::endl;
-    ofs << "sshport=" << itm->sshPort << std::endl;
-    ofs << "vncpass=" << itm->vncPassword << std::endl;
-    ofs << "vncloginuser=" << itm->vncLoginUser << std::endl;
-    ofs << "vncloginpass=" << itm->vncLoginPassword << std::endl;
-    ofs << "type=" << itm->hostType << std::endl;
-    ofs << "sshkeyprivate=" << itm->sshKeyPrivate << std::endl;
-    ofs << "sshuser=" << itm->sshUser << std::endl;
-    //ofs << "sshpass=" << itm->sshPass << std::endl;
-    ofs << "scale=" << itm->scaling << std::endl;
-    ofs << "scalefast=" << svConvertBooleanToString(itm->scalingFast) << std::endl;
-    ofs << "f12macro=" << itm->f12Macro << std::endl;
-    ofs << "showremotecursor=" << svConvertBooleanToString(itm->showRemoteCursor) << std::endl;
-    ofs << "compression=" << std::to_string(itm->compressLevel) << std::endl;
-    ofs << "quality=" << std::to_string(itm->qualityLevel) << std::endl;
-    //ofs << "ignoreinactive=" << svConvertBooleanToString(itm->ignoreInactive) << std::endl;
-    //ofs << "centerx=" << svConvertBooleanToString(itm->centerX) << std::endl;
-    //ofs << "centery=" << svConvertBooleanToString(itm->centerY) << std::endl;
-    ofs << "quicknote=" << base64Encode(reinterpret_cast<const unsigned char *>
-      (itm->quickNote.c_str()), itm->quickNote.size()) << std::endl;
-    ofs << "lastconnecttime=" << itm->lastConnectedTime << std::endl;
-    ofs << "viewonly=" << svConvertBooleanToString(itm->viewOnly) << std::endl;
-    ofs << "customcommand1enabled=" << svConvertBooleanToString(itm->customCommand1Enabled) << std::endl;
-    ofs << "customcommand1label=" << itm->customCommand1Label << std::endl;
-    ofs << "customcommand1=" << itm->customCommand1 << std::endl;
-    ofs << "customcommand2enabled=" << svConvertBooleanToString(itm->customCommand2Enabled) << std::endl;
-    ofs << "customcommand2label=" << itm->customCommand2Label << std::endl;
-    ofs << "customcommand2=" << itm->customCommand2 << std::endl;
-    ofs << "customcommand3enabled=" << svConvertBooleanToString(itm->customCommand3Enabled) << std::endl;
-    ofs << "customcommand3label=" << itm->customCommand3Label << std::endl;
-    ofs << "customcommand3=" << itm->customCommand3 << std::endl;
-
-    ofs << std::endl;
-  }
-
-  ofs << std::endl;
-
-  // close file
-  ofs.close();
+    // a connected host the config was changed under keeps its new settings
+    HostItem * itmReloaded = NULL;
+
+    if (svConfigWatchPending(itm, &itmReloaded))
+    {
+      if (!itmReloaded)
+        continue;
+
+      itm = itmReloaded;
+    }
+
+    oss << svConfigHostBlock(itm);
+    hosts.push_back(itm);
+  }
+
+  oss << '\n';
+
+  std::string strConfig = oss.str();
+
+  // don't let the config watcher reload our own write
+  svConfigWatchSetText(strConfig);
+
+  // oops, can't write config file
+  if (!svConfigWriteFileAtomic(strConfig))
+    std::cout << "SpiritVNC ERROR - Could not write config file" << std::endl;
+  else
+    // keep the binary host cache in step with what was just written
+    svHostCacheSave(strConfig, hosts);
 
   inConfigWrite = false;
 }
@@ -871,34 +1625,51 @@ void svConnectionWatcher (void *)
   {
     svDebugLog("svConnectionWatcher - At least one itm ready for processing");
 
-    uint16_t nSize = app->hostList->size();
+    // only items with a viewer can need anything, and cleanup
+    // takes them out of the active set, so go through a copy
+    std::vector<uint32_t> active = app->activeIds;
 
-    // iterate through hostlist items
-    for (uint16_t i = 0; i <= nSize; i ++)
+    for (uint32_t nId : active)
     {
-      HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
-      if (!itm)
-        continue;
+      HostState & state = svHostState(nId);
 
-      const VncObject * vnc = itm->vnc;
-      if (!vnc)
+      if (!state.vnc)
         continue;
 
       // if ssh connection faltered, shut down the vnc viewer
-      if (itm->isConnected && (itm->hostType == 's' && !itm->sshReady))
+      if (state.isConnected && !state.sshReady && state.itm->hostType == 's')
       {
         app->nViewersWaiting --;
         svDebugLog("svConnectionWatcher - SSH problem during connection, ending");
 
-        itm->vnc->endViewer();
+        state.vnc->endViewer();
       }
 
       // cleanup vnc client structure and delete vnc object
-      if (itm->vncNeedsCleanup)
-        VncObject::cleanupVNCObject(itm);
+      if (state.vncNeedsCleanup)
+        VncObject::cleanupVNCObject(state.itm);
     }
   }
 
+  // refresh the selected item's connection stats
+  if (app->createdObjects > 0)
+    svQuickInfoUpdateStats();
+
+  // start any automatic reconnects that are due
+  svReconnectWatcher();
+
+  // give back framebuffers of hosts that didn't reconnect
+  svFrameBufferTick();
+
+  // apply reloaded config to hosts whose connections have since closed
+  svConfigWatchTick();
+
+  // check which idle hosts are reachable, if it's time to
+  svProberTick();
+
+  // suspend connections nobody is using
+  svIdleWatcher();
+
   // set timer to call this function again in 1 second
   // (do NOT change this interval as connection timeout
   // values rely on this being at or near 1 second)
@@ -906,6 +1677,109 @@ void svConnectionWatcher (void *)
 }
 
 
+/*
+  suspend connections that haven't been shown or used for a while, and
+  drop cached frames once their host is showing live updates again
+  (called by svConnectionWatcher)
+*/
+void svIdleWatcher ()
+{
+  if (app->shuttingDown || !app->hostList || !app->vncViewer)
+    return;
+
+  // the displayed host has sent a fresh frame, so stop showing the cached one
+  if (app->vncViewer->suspendedItm && !app->vncViewer->suspendedItm->state().isSuspended)
+    app->vncViewer->clearSuspendedFrame();
+
+  time_t now = time(NULL);
+  const HostItem * itmShown = app->vncViewer->vnc ? app->vncViewer->vnc->itm : NULL;
+
+  // suspending cleans items up, taking them out of the active set, so go through a copy
+  std::vector<uint32_t> active = app->activeIds;
+
+  for (uint32_t nId : active)
+  {
+    HostState & state = svHostState(nId);
+
+    if (!state.isSuspended && state.hasSuspendedFrame)
+    {
+      state.itm->suspendedFrame.clear();
+      state.itm->suspendedFrame.shrink_to_fit();
+      state.hasSuspendedFrame = false;
+    }
+
+    if (app->nIdleSuspendMins <= 0 || !state.isConnected || !state.vnc || state.isListener || state.itm == itmShown)
+      continue;
+
+    if (now - state.lastActivityTime >= app->nIdleSuspendMins * 60)
+    {
+      state.vnc->suspendViewer();
+
+      // free the client and framebuffer now rather than on the next connect
+      if (state.vncNeedsCleanup)
+        VncObject::cleanupVNCObject(state.itm);
+    }
+  }
+}
+
+
+/*
+  start automatic reconnects that are due, without going over
+  the maximum number of reconnects in progress at once
+  (called by svConnectionWatcher)
+*/
+void svReconnectWatcher ()
+{
+  if (app->shuttingDown || !app->hostList)
+    return;
+
+  if (app->reconnectQueue.empty())
+    return;
+
+  time_t now = time(NULL);
+  int nInProgress = 0;
+
+  // count reconnects still underway
+  for (uint32_t nId : app->activeIds)
+    if (svHostState(nId).isReconnecting && svHostState(nId).isConnecting)
+      nInProgress ++;
+
+  // start due reconnects (items over the limit wait for a later tick)
+  std::vector<HostItem *> waiting;
+  std::vector<HostItem *> due;
+
+  for (HostItem * itm : app->reconnectQueue)
+  {
+    // a manual connect already replaced this reconnect
+    if (itm->state().reconnectTime == 0)
+      continue;
+
+    if (itm->state().reconnectTime > now || nInProgress + static_cast<int>(due.size()) >= app->nMaxReconnects)
+      waiting.push_back(itm);
+    else
+      due.push_back(itm);
+  }
+
+  app->reconnectQueue.swap(waiting);
+
+  for (HostItem * itm : due)
+  {
+    itm->state().reconnectTime = 0;
+
+    // someone already connected this host
+    if (itm->state().isConnected || itm->state().isConnecting)
+      continue;
+
+    itm->state().isReconnecting = true;
+
+    svLogToFile("Automatically reconnecting to '" + itm->name + "' - " + itm->hostAddress +
+      " (attempt " + std::to_string(itm->state().reconnectAttempts) + ")");
+
+    VncObject::createVNCObject(itm);
+  }
+}
+
+
 /*  convert boolean to string  */
 std::string svConvertBooleanToString (bool boolIn)
 {
@@ -971,7 +1845,7 @@ void svCreateAppIcons (const bool fromAppOptions)
   if (!fromAppOptions)
   {
     // set initial icons on hostlist items
-    for (uint16_t i = 0; i <= app->hostList->size(); i ++)
+    for (int i = 0; i <= app->hostList->size(); i ++)
     {
       if (app->hostList->data(i))
         app->hostList->icon(i, app->iconDisconnected);
@@ -1063,8 +1937,15 @@ void svCreateGUI ()
   if (app->buttonsOnTop)
     createHostListButtons();
 
+  // host list search box
+  app->searchBox = new SVInput(0, 0, 0, 0);
+  app->searchBox->textsize(app->nListFontSize);
+  app->searchBox->when(FL_WHEN_CHANGED);
+  app->searchBox->callback(svHandleSearchBox);
+  app->flexLeftSide->fixed(app->searchBox, app->nListFontSize + 12);
+
   // create host list
-  app->hostList = new Fl_Hold_Browser(0, 0, 0, 0); //0, 0, 163, 548);
+  app->hostList = new SVHostList(0, 0, 0, 0); //0, 0, 163, 548);
   app->hostList->clear_visible_focus();
   app->hostList->callback(svHandleHostListEvents, NULL);
   app->hostList->box(FL_THIN_DOWN_BOX);
@@ -1107,6 +1988,14 @@ void svCreateGUI ()
 
   app->quickInfoPack->fixed(app->lastConnected, 18);
 
+  // connection stats (round-trip time, retransmits)
+  app->connStats = new Fl_Box(0, 0, 0, 0);
+  app->connStats->labelsize(app->nAppFontSize - 2);
+  app->connStats->align(FL_ALIGN_CENTER | FL_ALIGN_INSIDE | FL_ALIGN_TOP);
+  app->connStats->labelcolor(fl_rgb_color(SV_QUICK_INFO_FG_COLOR));
+
+  app->quickInfoPack->fixed(app->connStats, 18);
+
   // last error message
   app->lastErrorBox = new Fl_Multiline_Output(0, 0, 0, 0);
   app->lastErrorBox->textsize(app->nAppFontSize - 2);
@@ -1182,7 +2071,7 @@ void svDeleteItem (const int nItem)
   else
     inDeleteItem = true;
 
-  const HostItem * itm = static_cast<HostItem *>(app->hostList->data(nItem));
+  HostItem * itm = static_cast<HostItem *>(app->hostList->data(nItem));
   if (!itm)
   {
     fl_beep(FL_BEEP_DEFAULT);
@@ -1191,7 +2080,7 @@ void svDeleteItem (const int nItem)
   }
 
   // listening connection doesn't need delete confirmation
-  if (itm->isListener)
+  if (itm->state().isListener)
     okayToDelete = true;
   else
   {
@@ -1213,10 +2102,16 @@ void svDeleteItem (const int nItem)
   // delete itm if everything is okay
   if (okayToDelete)
   {
-    delete itm;
+    svRemoveHostItem(nItem);
     itm = NULL;
-    app->hostList->remove(nItem);
     app->hostList->redraw();
+
+    // rows below the deleted one moved up
+    svSearchFilterHostList(true);
+
+    // don't leave the deleted itm in the scan order
+    if (app->scanIsRunning)
+      svScanBuildOrder();
     svQuickInfoSetToEmpty();
   }
 
@@ -1224,6 +2119,35 @@ void svDeleteItem (const int nItem)
 }
 
 
+/*
+  free host list row nItem's itm and remove the row
+  (no confirmation, callers redraw and refilter)
+*/
+void svRemoveHostItem (const int nItem)
+{
+  HostItem * itm = static_cast<HostItem *>(app->hostList->data(nItem));
+  if (!itm)
+    return;
+
+  if (app->vncViewer->suspendedItm == itm)
+    app->vncViewer->clearSuspendedFrame();
+
+  // deleting the 'Listening' item stops reverse connections
+  if (svListenerIsItem(itm))
+    svListenerStop();
+
+  svReleaseSSHForward(itm);
+  svFrameBufferRelease(itm);
+  svSearchIndexRemove(itm);
+  svConfigWatchForget(itm);
+  svActiveRemove(itm);
+  app->reconnectQueue.erase(std::remove(app->reconnectQueue.begin(), app->reconnectQueue.end(), itm),
+    app->reconnectQueue.end());
+  delete itm;
+  app->hostList->remove(nItem);
+}
+
+
 /*  sets all host list items to deselected  */
 void svDeselectAllItems ()
 {
@@ -1243,87 +2167,6 @@ void svEnableDisableTooltips ()
 }
 
 
-/*  find unused TCP port in a range  */
-int svFindFreeTcpPort ()
-{
-  struct sockaddr_in structSockAddress;
-
-  structSockAddress.sin_family = AF_INET;
-  structSockAddress.sin_addr.s_addr = htonl(INADDR_ANY);
-
-  int nSock = socket(AF_INET, SOCK_STREAM, 0);
-  if (nSock < 0)
-  {
-    svLogToFile("ERROR - Cannot create socket for svFindFreeTCPPort");
-    return 0;
-  }
-
-  // go through a range of startingLocalPort to + 99 to see if we can use for ssh forwarding
-  for (uint16_t nPort = app->nStartingLocalPort; nPort < (app->nStartingLocalPort + 99); nPort ++)
-  {
-    structSockAddress.sin_port = htons((unsigned short)nPort);
-
-    // don't clobber the listening port
-    if (nPort == 5500)
-      continue;
-
-    // if nothing is on this port and it's not the reverse vnc port, return the port number
-    if (bind(nSock, reinterpret_cast<sockaddr *>(&structSockAddress),
-      sizeof(structSockAddress)) == 0)
-    {
-      close(nSock);
-      return nPort;
-    }
-  }
-
-  close(nSock);
-
-  return 0;
-}
-
-
-/*  return config property from input  */
-std::string svGetConfigProperty (const char * strIn)
-{
-  if (!strIn)
-    return "";
-
-  // assign to temp std::string
-  std::string strTemp = strIn;
-
-  // find the equals sign
-  std::string::size_type pos = strTemp.find("=");
-
-  // if found, return the part before the equals sign
-  if (pos != std::string::npos)
-    return strTemp.substr(0, pos);
-
-  // not found, return empty string
-  return "";
-}
-
-
-/*  return config value from input  */
-std::string svGetConfigValue (const char * strIn)
-{
-  if (!strIn)
-    return "";
-
-  // assign to temp std::string
-  std::string strTemp = strIn;
-
-  // find the equals sign
-  std::string::size_type pos = strTemp.find("=");
-
-  // if found, return the part after the equals sign
-  if (pos != std::string::npos)
-    return strTemp.substr(pos + 1);
-
-  // not found, return empty string
-  return "";
-}
-
-
 /* validate vnc message loop speed */
 void svValidateAndSetMessageLoopSpeed ()
 {
@@ -1410,6 +2253,23 @@ void svHandleAppOptionsButtons (Fl_Widget * widget, void *)
     // local ssh start port number spinner
     app->nStartingLocalPort = static_cast<Fl_Spinner *>(m_appOptions["spinLocalSSHPort"])->value();
 
+    // local ssh port range spinner
+    app->nLocalPortRange = static_cast<Fl_Spinner *>(m_appOptions["spinLocalPortRange"])->value();
+
+    #ifndef _WIN32
+    // forward ssh over unix-domain sockets
+    if (static_cast<Fl_Check_Button *>(m_appOptions["chkSSHUnixSockets"])->value() == 1)
+      app->sshUnixSockets = true;
+    else
+      app->sshUnixSockets = false;
+
+    // share one ssh connection per ssh server
+    if (static_cast<Fl_Check_Button *>(m_appOptions["chkSSHControlMaster"])->value() == 1)
+      app->sshControlMaster = true;
+    else
+      app->sshControlMaster = false;
+    #endif
+
     // ssh command input
     app->sshCommand = static_cast<SVInput *>(m_appOptions["inSSHCommand"])->value();
 
@@ -1492,6 +2352,21 @@ void svHandleAppOptionsButtons (Fl_Widget * widget, void *)
     else
       app->rightClickToClose = false;
 
+    // decode screen updates in a background thread
+    if (static_cast<Fl_Check_Button *>(m_appOptions["chkDecodeInThread"])->value() == 1)
+      app->decodeInThread = true;
+    else
+      app->decodeInThread = false;
+
+    // maximum simultaneous reconnects spinner
+    app->nMaxReconnects = static_cast<Fl_Spinner *>(m_appOptions["spinMaxReconnects"])->value();
+
+    // idle connection suspend time spinner
+    app->nIdleSuspendMins = static_cast<Fl_Spinner *>(m_appOptions["spinIdleSuspendMins"])->value();
+
+    // host reachability probe interval spinner
+    app->nProbeInterval = static_cast<Fl_Spinner *>(m_appOptions["spinProbeInterval"])->value();
+
     svCloseDeleteFinalizeChildWindow(childWindow);
 
     svConfigWrite();
@@ -1525,17 +2400,24 @@ void svHandleAppOptionsButtons (Fl_Widget * widget, void *)
       // ***######### RESTART SEQUENCE ################***
       VncObject::endAllViewers();
 
-      // destroy all connection itms
-      for (uint16_t i = 0; i <= app->hostList->size(); i ++)
-      {
-        HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
-        if (itm)
-          delete itm;
-      }
+      // the scan order points at itms that are about to go away
+      app->scanOrder.clear();
+      svConfigWatchClearPending();
+
+      // dropped all at once rather than host by host below
+      svSearchIndexClear();
+
+      // destroy all connection itms the same way deleting them one by one
+      // does, so the listener, ssh forwards and indexes let go of them too
+      // (from the bottom up, so rows don't shift)
+      for (int i = app->hostList->size(); i >= 1; i --)
+        svRemoveHostItem(i);
 
       // delete various widgets
       delete app->hostList;
       app->hostList = NULL;
+      delete app->searchBox;
+      app->searchBox = NULL;
       if (app->vncViewer)
         delete app->vncViewer;
       delete app->scroller;
@@ -1566,6 +2448,7 @@ void svHandleAppOptionsButtons (Fl_Widget * widget, void *)
       app->quickNotePack = NULL;
       delete app->quickInfoPack;
       app->quickInfoPack = NULL;
+      app->connStats = NULL;
 
       // destroy main parent flex container along with children
       delete app->flexParent;
@@ -1607,58 +2490,60 @@ void svHandleF8Buttons (Fl_Widget * widget, void *)
     return;
   }
 
-  const VncObject * vnc = app->vncViewer->vnc;
+  VncObject * vnc = app->vncViewer->vnc;
   if (vnc)
   {
     // ctrl + alt + delete button clicked
     if (btn == m_f8Actions["btnCAD"])
     {
-      SendKeyEvent(vnc->vncClient, XK_Control_L, true);
-      SendKeyEvent(vnc->vncClient, XK_Alt_L, true);
-      SendKeyEvent(vnc->vncClient, XK_Delete, true);
+      vnc->addKeyToBatch(XK_Control_L, true);
+      vnc->addKeyToBatch(XK_Alt_L, true);
+      vnc->addKeyToBatch(XK_Delete, true);
 
-      SendKeyEvent(vnc->vncClient, XK_Control_L, false);
-      SendKeyEvent(vnc->vncClient, XK_Alt_L, false);
-      SendKeyEvent(vnc->vncClient, XK_Delete, false);
+      vnc->addKeyToBatch(XK_Control_L, false);
+      vnc->addKeyToBatch(XK_Alt_L, false);
+      vnc->addKeyToBatch(XK_Delete, false);
     }
 
     // ctrl + shift + esc button clicked
     if (btn == m_f8Actions["btnCSE"])
     {
-      SendKeyEvent(vnc->vncClient, XK_Control_L, true);
-      SendKeyEvent(vnc->vncClient, XK_Shift_L, true);
-      SendKeyEvent(vnc->vncClient, XK_Escape, true);
+      vnc->addKeyToBatch(XK_Control_L, true);
+      vnc->addKeyToBatch(XK_Shift_L, true);
+      vnc->addKeyToBatch(XK_Escape, true);
 
-      SendKeyEvent(vnc->vncClient, XK_Control_L, false);
-      SendKeyEvent(vnc->vncClient, XK_Shift_L, false);
-      SendKeyEvent(vnc->vncClient, XK_Escape, false);
+      vnc->addKeyToBatch(XK_Control_L, false);
+      vnc->addKeyToBatch(XK_Shift_L, false);
+      vnc->addKeyToBatch(XK_Escape, false);
     }
 
     // ask server for a screen refresh
     if (btn == m_f8Actions["btnRefresh"])
-      SendFramebufferUpdateRequest(vnc->vncClient, 0, 0,
-        vnc->vncClient->width, vnc->vncClient->height, false);
+      vnc->sendFullUpdateRequest();
 
     // send F8 key
     if (btn == m_f8Actions["btnSendF8"])
     {
-      SendKeyEvent(vnc->vncClient, XK_F8, true);
-      SendKeyEvent(vnc->vncClient, XK_F8, false);
+      vnc->addKeyToBatch(XK_F8, true);
+      vnc->addKeyToBatch(XK_F8, false);
     }
 
     // send F11 key
     if (btn == m_f8Actions["btnSendF11"])
     {
-      SendKeyEvent(vnc->vncClient, XK_F11, true);
-      SendKeyEvent(vnc->vncClient, XK_F11, false);
+      vnc->addKeyToBatch(XK_F11, true);
+      vnc->addKeyToBatch(XK_F11, false);
     }
 
     // send F12 key
     if (btn == m_f8Actions["btnSendF12"])
     {
-      SendKeyEvent(vnc->vncClient, XK_F12, true);
-      SendKeyEvent(vnc->vncClient, XK_F12, false);
+      vnc->addKeyToBatch(XK_F12, true);
+      vnc->addKeyToBatch(XK_F12, false);
     }
+
+    // send any key sequence built above in one go
+    vnc->sendKeyBatch();
   }
 
   svCloseDeleteFinalizeChildWindow(childWindow);
@@ -1686,7 +2571,24 @@ void svHandleHostListButtons (Fl_Widget * button, void *)
 
   // add new item button
   if (btn == app->btnListAdd)
-    svShowConnectionEditor(NULL);
+  {
+    // right-click offers importing a whole inventory
+    if (Fl::event_button() == FL_RIGHT_MOUSE)
+    {
+      // text,shortcut,callback,user_data,flags,labeltype,labelfont,labelsize
+      const Fl_Menu_Item miImport[] = {
+        {"Import from CSV / JSON lines file...", 0, 0, 0, 0, 0, FL_HELVETICA, app->nMenuFontSize},
+        {0}
+      };
+
+      const Fl_Menu_Item * miRes = miImport->popup(Fl::event_x() + 14, Fl::event_y() - 10);
+
+      if (miRes && miRes->text)
+        svImportHostsFromFile();
+    }
+    else
+      svShowConnectionEditor(NULL);
+  }
 
   // delete current item button
   if (btn == app->btnListDelete && !isSeparator)
@@ -1713,6 +2615,8 @@ void svHandleHostListButtons (Fl_Widget * button, void *)
       app->hostList->swap(nListVal, nListVal - 1);
       app->hostList->select(nListVal - 1);
       app->hostList->redraw();
+
+      svSearchFilterHostList(true);
     }
   }
 
@@ -1724,6 +2628,8 @@ void svHandleHostListButtons (Fl_Widget * button, void *)
       app->hostList->swap(nListVal, nListVal + 1);
       app->hostList->select(nListVal + 1);
       app->hostList->redraw();
+
+      svSearchFilterHostList(true);
     }
   }
 
@@ -1745,6 +2651,7 @@ void svHandleHostListButtons (Fl_Widget * button, void *)
     app->btnListScan->image(new Fl_Pixmap(pmListScanScanning));
     app->nCurrentScanItem = app->hostList->value();
     app->scanIsRunning = true;
+    svScanBuildOrder();
     svDeselectAllItems();
     svScanTimer(NULL);
   }
@@ -1752,23 +2659,32 @@ void svHandleHostListButtons (Fl_Widget * button, void *)
   // create a listening vnc object
   if (btn == app->btnListListen)
   {
-    uint16_t nSize = app->hostList->size();
+    // the accept loop takes any number of reverse connections itself
+    if (svListenerIsRunning())
+    {
+      svMessageWindow("Only one active listening viewer is allowed");
+      return;
+    }
+
+    #ifdef _WIN32
+    int nSize = app->hostList->size();
 
     // check the host list for other listening viewers
-    for (uint16_t i = 0; i <= nSize; i ++)
+    for (int i = 0; i <= nSize; i ++)
     {
       const HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
       if (itm)
       {
-        const VncObject * vnc = itm->vnc;
+        const VncObject * vnc = itm->state().vnc;
 
-        if (vnc && itm->isListener)
+        if (vnc && itm->state().isListener)
         {
           svMessageWindow("Only one active listening viewer is allowed");
           return;
         }
       }
     }
+    #endif
 
     VncObject::createVNCListener();
   }
@@ -1793,7 +2709,7 @@ void svHandleHostListEvents (Fl_Widget *, void *)
     return;
   }
 
-  VncObject * vnc = itm->vnc;
+  VncObject * vnc = itm->state().vnc;
 
   static bool menuUp = false;
 
@@ -1813,7 +2729,7 @@ void svHandleHostListEvents (Fl_Widget *, void *)
         return;
 
       // start new connection
-      if (!itm->isConnected && !itm->isConnecting && !itm->isListener)
+      if (!itm->state().isConnected && !itm->state().isConnecting && !itm->state().isListener)
       {
         VncObject::hideMainViewer();
         app->lastErrorBox->value("");
@@ -1832,8 +2748,14 @@ void svHandleHostListEvents (Fl_Widget *, void *)
       VncObject::hideMainViewer();
 
       // show single-clicked viewer (if connected)
-      if (itm->isConnected)
+      if (itm->state().isConnected)
         vnc->setObjectVisible();
+      // or show a suspended host's last frame and reconnect it
+      else if (itm->state().isSuspended && !itm->state().isConnecting)
+      {
+        app->vncViewer->showSuspendedFrame(itm);
+        VncObject::createVNCObject(itm);
+      }
 
       return;
     }
@@ -1855,13 +2777,13 @@ void svHandleHostListEvents (Fl_Widget *, void *)
 
     // disconnect connection if close-on-right-click is enabled
     if (
-      (itm->isConnected || itm->isConnecting) &&
-      !itm->hasDisconnectRequest &&
-      !itm->isListener &&
+      (itm->state().isConnected || itm->state().isConnecting) &&
+      !itm->state().hasDisconnectRequest &&
+      !itm->state().isListener &&
       app->rightClickToClose
     )
     {
-      itm->hasDisconnectRequest = true;
+      itm->state().hasDisconnectRequest = true;
 
       vnc->endViewer();
 
@@ -1892,22 +2814,22 @@ void svHandleHostListEvents (Fl_Widget *, void *)
     // *** the menu below only displays if 'rightClickToClose' is false ***
 
     // show pop-up menu if not a listening connection
-    if (!itm->hasDisconnectRequest
-        && !itm->isListener
+    if (!itm->state().hasDisconnectRequest
+        && !itm->state().isListener
         && !menuUp)
     {
       // set default text as 'connecting'
       char strConnectDisconnect[20] = "Connecting...";
 
       // enable/disable connect/disconnect as needed
-      if (itm->isConnected)
+      if (itm->state().isConnected)
       {
         strncpy(strConnectDisconnect, "Disconnect", 19);
         nConnectDisconnectFlag = 0;
       }
       else
       {
-        if (!itm->isConnecting)
+        if (!itm->state().isConnecting)
         {
           strncpy(strConnectDisconnect, "Connect", 19);
           nConnectDisconnectFlag = 0;
@@ -1950,7 +2872,7 @@ void svHandleHostListEvents (Fl_Widget *, void *)
           // disconnect
           if (strcmp(strRes, "Disconnect") == 0)
           {
-            itm->hasDisconnectRequest = true;
+            itm->state().hasDisconnectRequest = true;
 
             vnc->endViewer();
           }
@@ -1971,7 +2893,10 @@ void svHandleHostListEvents (Fl_Widget *, void *)
 
           // view only
           if (strcmp(strRes, "View only") == 0)
+          {
             itm->viewOnly = !itm->viewOnly;
+            itm->configDirty = true;
+          }
 
           // copy itm's clipboard to ours
           if (strcmp(strRes, "Copy this connection's clipboard") == 0)
@@ -1999,13 +2924,13 @@ void svHandleHostListEvents (Fl_Widget *, void *)
     }
 
     // show pop-up menu for reverse / listening connections
-    if (itm->isListener && !menuUp)
+    if (itm->state().isListener && !menuUp)
     {
       // prevent re-entry (FLTK menu bug)
       menuUp = true;
 
       // listener is not connected
-      if (!itm->isConnected && !itm->isWaitingForShow)
+      if (!itm->state().isConnected && !itm->state().isWaitingForShow)
       {
         // create context menu
         // text,shortcut,callback,user_data,flags,labeltype,labelfont,labelsize
@@ -2084,12 +3009,16 @@ void svHandleHostListEvents (Fl_Widget *, void *)
             if (strcmp(strRes, "Put F12 macro") == 0)
             {
               itm->f12Macro = app->strF12ClipVar;
+              itm->configDirty = true;
               app->strF12ClipVar = "";
             }
 
             // clear F12 macro variable of listening item
             if (strcmp(strRes, "Clear F12 macro") == 0)
+            {
               itm->f12Macro = "";
+              itm->configDirty = true;
+            }
           }
         }
 
@@ -2138,6 +3067,9 @@ void svHandleConnEditButtons (Fl_Widget * widget, void *)
   // save button clicked
   if (btn == static_cast<Fl_Button *>(m_itmSettings["btnSave"]))
   {
+    // what's saved here replaces any config reload waiting for this host
+    svConfigWatchForget(itm);
+
     // #### vnc tab ########################################
 
     // connection name text input
@@ -2152,6 +3084,17 @@ void svHandleConnEditButtons (Fl_Widget * widget, void *)
     // f12 macro text input
     itm->f12Macro = static_cast<SVInput *>(m_itmSettings["inF12Macro"])->value();
 
+    // key delay text input
+    int nKeyDelay = atoi(static_cast<SVIntInput *>(m_itmSettings["inKeyDelay"])->value());
+
+    if (nKeyDelay < 0)
+      nKeyDelay = 0;
+
+    if (nKeyDelay > 1000)
+      nKeyDelay = 1000;
+
+    itm->keyDelay = nKeyDelay;
+
     // vnc connection radio button
     if (static_cast<Fl_Radio_Round_Button *>(m_itmSettings["rbVNC"])->value() == 1)
       itm->hostType = 'v';
@@ -2187,6 +3130,20 @@ void svHandleConnEditButtons (Fl_Widget * widget, void *)
     if (itm->qualityLevel > 9)
       itm->qualityLevel = 9;
 
+    // colour depth choice
+    switch (static_cast<Fl_Choice *>(m_itmSettings["chColorDepth"])->value())
+    {
+      case 0:
+        itm->colorDepth = 8;
+        break;
+      case 1:
+        itm->colorDepth = 16;
+        break;
+      default:
+        itm->colorDepth = 24;
+        break;
+    }
+
     // scroll only / no scaling radio button
     if (static_cast<Fl_Radio_Round_Button *>(m_itmSettings["rbScaleOff"])->value() == 1)
       itm->scaling = 's';
@@ -2222,6 +3179,42 @@ void svHandleConnEditButtons (Fl_Widget * widget, void *)
     // ssh private key
     itm->sshKeyPrivate = static_cast<SVInput *>(m_itmSettings["inSSHPrvKey"])->value();
 
+    // #### network tab #######################################
+
+    // tcp nodelay checkbutton
+    if (static_cast<Fl_Check_Button *>(m_itmSettings["chkTcpNoDelay"])->value() == 1)
+      itm->tcpNoDelay = true;
+    else
+      itm->tcpNoDelay = false;
+
+    // tcp socket buffer size
+    int nTcpBufferSize = atoi(static_cast<SVIntInput *>(m_itmSettings["inTcpBufferSize"])->value());
+
+    if (nTcpBufferSize < 0)
+      nTcpBufferSize = 0;
+
+    if (nTcpBufferSize > 16384)
+      nTcpBufferSize = 16384;
+
+    itm->tcpBufferSize = nTcpBufferSize;
+
+    // tcp keepalive checkbutton
+    if (static_cast<Fl_Check_Button *>(m_itmSettings["chkTcpKeepAlive"])->value() == 1)
+      itm->tcpKeepAlive = true;
+    else
+      itm->tcpKeepAlive = false;
+
+    // automatic reconnect checkbutton
+    if (static_cast<Fl_Check_Button *>(m_itmSettings["chkAutoReconnect"])->value() == 1)
+      itm->autoReconnect = true;
+    else
+      itm->autoReconnect = false;
+
+    // keepalive idle and interval times
+    itm->keepAliveIdle = svKeepAliveSecs(static_cast<SVIntInput *>(m_itmSettings["inKeepAliveIdle"])->value(), 60);
+    itm->keepAliveInterval = svKeepAliveSecs(static_cast<SVIntInput *>(m_itmSettings["inKeepAliveInterval"])->value(),
+      10);
+
     // #### custom commands ####################################
     // custom command 1
     if (static_cast<Fl_Check_Button *>(m_itmSettings["chkCommand1Enabled"])->value() == 1)
@@ -2276,12 +3269,21 @@ void svHandleConnEditButtons (Fl_Widget * widget, void *)
     svCloseDeleteFinalizeChildWindow(childWindow);
 
     // refresh any visual changes if connected
-    if (itm->isConnected && itm->vnc)
+    if (itm->state().isConnected && itm->state().vnc)
     {
-      SetFormatAndEncodings(itm->vnc->vncClient);
-      itm->vnc->setObjectVisible();
+      itm->state().vnc->sendFormatAndEncodings();
+      itm->state().vnc->setObjectVisible();
     }
 
+    // address may have changed, so get it looked up ahead of the next connect
+    if (itm->hostType == 'v')
+      svResolverPrewarm(itm->hostAddress);
+
+    itm->configDirty = true;
+
+    svSearchIndexUpdate(itm);
+    svSearchFilterHostList(true);
+
     svConfigWrite();
   }
 }
@@ -2323,7 +3325,10 @@ void svHandleMainWindowEvents (Fl_Widget * window, void *)
   {
     app->shuttingDown = true;
 
+    svListenerStop();
+    svConfigWatchStop();
     VncObject::endAllViewers();
+    svSSHRemoveSocketDir();
 
     svLogToFile("--- Program shutting down ---");
 
@@ -2406,7 +3411,7 @@ void svQuickInfoSetLabelAndText (HostItem * itm)
   // set last connected text, if any
   if (!itm->lastConnectedTime.empty())
   {
-    if (!itm->isListener)
+    if (!itm->state().isListener)
       app->lastConnectedLabel->copy_label("Last connected");
     else
       app->lastConnectedLabel->copy_label("Connected");
@@ -2419,17 +3424,22 @@ void svQuickInfoSetLabelAndText (HostItem * itm)
     app->lastConnected->copy_label("");
   }
 
+  // set connection stats, if connected
+  app->connStats->copy_label(svGetSocketStats(itm).c_str());
+
   // set last error text, if any
   app->lastErrorBox->value(itm->lastErrorMessage.c_str());
 
+  const std::string& strNote = svQuickNote(itm);
+
   // set appropriate text style and quick note text
-  if (itm->quickNote.empty())
+  if (strNote.empty())
   {
     app->quickNoteBox->textfont(FL_HELVETICA_ITALIC);
 
     // listening connections don't save any data, so
     // best to call the item 'Temporary Note'
-    if (itm->isListener)
+    if (itm->state().isListener)
       app->quickNoteBox->value("(no Temporary Note)");
     else
       app->quickNoteBox->value("(no Quick Note)");
@@ -2437,8 +3447,24 @@ void svQuickInfoSetLabelAndText (HostItem * itm)
   else
   {
     app->quickNoteBox->textfont(FL_HELVETICA);
-    app->quickNoteBox->value(itm->quickNote.c_str());
+    app->quickNoteBox->value(strNote.c_str());
+  }
+}
+
+
+/*
+  return itm's quick note, decoding it from its saved
+  form the first time it's needed
+*/
+const std::string& svQuickNote (HostItem * itm)
+{
+  if (itm->quickNoteEncoded)
+  {
+    itm->quickNote = base64Decode(itm->quickNote);
+    itm->quickNoteEncoded = false;
   }
+
+  return itm->quickNote;
 }
 
 
@@ -2449,12 +3475,32 @@ void svQuickInfoSetToEmpty ()
   app->quickInfoLabel->copy_label("-");
   app->lastConnectedLabel->copy_label("");
   app->lastConnected->copy_label("");
+  app->connStats->copy_label("");
   app->lastErrorBox->value("");
   app->quickNoteBox->textfont(FL_HELVETICA_ITALIC);
   app->quickNoteBox->value("-");
 }
 
 
+/*  refresh the connection stats of the selected item  */
+void svQuickInfoUpdateStats ()
+{
+  if (!app->connStats || !app->hostList)
+    return;
+
+  const HostItem * itm = static_cast<HostItem *>(app->hostList->data(app->hostList->value()));
+
+  std::string strStats;
+
+  if (itm)
+    strStats = svGetSocketStats(itm);
+
+  // only relabel when the text actually changes
+  if (!app->connStats->label() || strStats != app->connStats->label())
+    app->connStats->copy_label(strStats.c_str());
+}
+
+
 /*
   handle app and main window events, such as resize, move, etc
   and resize gui elements
@@ -2481,23 +3527,34 @@ void svPositionWidgets ()
 
 /*
   handle host item icon change
-  (void * not used so parameter name removed)
+  (data is the changed HostItem, or NULL to refresh every row)
 */
-void svHandleListItemIconChange (void *)
+void svHandleListItemIconChange (void * data)
 {
-  uint16_t nSize = app->hostList->size();
+  const HostItem * itmChanged = static_cast<HostItem *>(data);
+
+  // only the row whose item changed needs its icon set
+  if (itmChanged)
+  {
+    int nRow = svItemNumFromItm(itmChanged);
+
+    if (nRow > 0 && itmChanged->state().icon)
+      app->hostList->icon(nRow, itmChanged->state().icon);
+
+    app->hostList->redraw();
+
+    return;
+  }
+
+  int nSize = app->hostList->size();
 
   // iterate through host list and set status icons for items
-  for (uint16_t i = 0; i < nSize; i++)
+  for (int i = 1; i <= nSize; i++)
   {
     const HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
 
-    if (itm && itm->icon)
-    {
-      app->hostList->icon(i, itm->icon);
-
-      Fl::check();
-    }
+    if (itm && itm->state().icon)
+      app->hostList->icon(i, itm->state().icon);
   }
 
   app->hostList->redraw();
@@ -2511,27 +3568,34 @@ void svHandleThreadConnection (void * data)
   if (!itm)
     return;
 
-  VncObject * vnc = itm->vnc;
+  VncObject * vnc = itm->state().vnc;
   if (!vnc)
     return;
 
   int nItem = svItemNumFromItm(itm);
 
   // set viewer as connected
-  if (itm->isWaitingForShow)
+  if (itm->state().isWaitingForShow)
   {
     svDebugLog("svConnectionWatcher - itm changing from 'isWaitingToShow' to 'isConnected'");
 
-    itm->isWaitingForShow = false;
+    itm->state().isWaitingForShow = false;
 
     app->nViewersWaiting --;
 
+    // connected, so any automatic reconnecting is done
+    itm->state().isReconnecting = false;
+    itm->state().reconnectAttempts = 0;
+    itm->state().reconnectTime = 0;
+
     // set host list item status icon
-    itm->icon = app->iconConnected;
-    svHandleListItemIconChange(NULL);
+    itm->state().icon = app->iconConnected;
+    svHandleListItemIconChange(itm);
 
     // store connection time
     itm->lastConnectedTime = svMakeTimeStamp(false);
+    itm->configDirty = true;
+    itm->state().lastActivityTime = time(NULL);
 
     // only update the quick info if we're on this host item
     if (app->hostList->value() == svItemNumFromItm(itm))
@@ -2540,16 +3604,16 @@ void svHandleThreadConnection (void * data)
     svLogToFile("Connected to '" + itm->name + "' - " + itm->hostAddress);
 
     // show viewer if it matches the selected host list item
-    uint16_t nSelectedHost = app->hostList->value();
+    int nSelectedHost = app->hostList->value();
 
-    if (nItem == nSelectedHost && !itm->isListener)
+    if (nItem == nSelectedHost && !itm->state().isListener)
     {
       svDebugLog("svConnectionWatcher - Showing viewer because it's selected");
       vnc->setObjectVisible();
     }
 
     // append desktop name to this listener and create another listening viewer
-    if (itm->isListener)
+    if (itm->state().isListener)
     {
       // add remote desktop's name to this Listening item
       int nListeningItem = svItemNumFromItm(itm);
@@ -2560,10 +3624,16 @@ void svHandleThreadConnection (void * data)
 
       app->hostList->text(nListeningItem, itm->name.c_str());
 
-      // (try to) create another listener
-      svDebugLog("svConnectionWatcher - Creating Listener object");
+      svSearchIndexUpdate(itm);
+      svSearchFilterHostList();
 
-      VncObject::createVNCListener();
+      // (try to) create another listener, unless the accept loop is still taking them
+      if (!svListenerIsRunning())
+      {
+        svDebugLog("svConnectionWatcher - Creating Listener object");
+
+        VncObject::createVNCListener();
+      }
 
       if (app->showReverseConnect)
         svMessageWindow("A remote VNC host has just reverse-connected"
@@ -2572,30 +3642,49 @@ void svHandleThreadConnection (void * data)
   }
 
   // set no connect icon
-  if (itm->hasCouldntConnect)
+  if (itm->state().hasCouldntConnect)
   {
     svDebugLog("svConnectionWatcher - itm changing from 'hasCouldntConnect' to"
       " 'isConnected = false'");
 
-    itm->isConnected = false;
+    itm->state().isConnected = false;
     app->nViewersWaiting --;
 
     // set host list item status icon
     if (!itm->lastErrorMessage.empty())
     {
-      itm->icon = app->iconDisconnectedBigError;
+      itm->state().icon = app->iconDisconnectedBigError;
 
       // only update the lastError quick info if we're on this host item
       if (app->hostList->value() == svItemNumFromItm(itm))
         app->lastErrorBox->value(itm->lastErrorMessage.c_str());
     }
     else
-      itm->icon = app->iconNoConnect;
+      itm->state().icon = app->iconNoConnect;
+
+    svHandleListItemIconChange(itm);
 
-    svHandleListItemIconChange(NULL);
+    // resuming a suspended connection failed, so stop showing its old frame
+    if (itm->state().isSuspended)
+    {
+      itm->state().isSuspended = false;
+      itm->state().hasSuspendedFrame = false;
+      itm->suspendedFrame.clear();
+      itm->suspendedFrame.shrink_to_fit();
+
+      if (app->vncViewer->suspendedItm == itm)
+        app->vncViewer->clearSuspendedFrame();
+    }
+
+    // an automatic reconnect failed, so back off and try again
+    if (itm->state().isReconnecting)
+    {
+      itm->state().isReconnecting = false;
+      svScheduleReconnect(itm);
+    }
 
     // deal with listening items
-    if (itm->isListener)
+    if (itm->state().isListener)
     {
       // output to console and attempt to log error
       std::string strLErr = svMakeTimeStamp() + " - SpiritVNC-FLTK - Error: Incoming reverse VNC connection failed.  "
@@ -2607,14 +3696,17 @@ void svHandleThreadConnection (void * data)
         std::cout << strLErr << std::endl;
 
       // remove item from host list
+      svSearchIndexRemove(itm);
       app->hostList->remove(svItemNumFromItm(itm));
+      svSearchFilterHostList(true);
 
       // try to create another listener
-      VncObject::createVNCListener();
+      if (!svListenerIsRunning())
+        VncObject::createVNCListener();
     }
 
     // set cleanup flag so svConnectionWatcher will do the thing
-    itm->vncNeedsCleanup = true;
+    itm->state().vncNeedsCleanup = true;
   }
 }
 
@@ -2656,7 +3748,11 @@ void svHandleThreadCursorChange (void * data)
 void svInsertEmptyItem ()
 {
   // make and populate a new itm
-  HostItem * itm = new HostItem();
+  HostItem * itm = svHostItemNew();
+
+  if (!itm)
+    return;
+
   itm->name = "(new connection)";
   itm->hostAddress = "0.0.0.0";
   itm->vncPort = "5900";
@@ -2666,6 +3762,8 @@ void svInsertEmptyItem ()
   itm->compressLevel = 5;
   itm->qualityLevel = 5;
 
+  svSearchIndexUpdate(itm);
+
   // add empty item to hostlist, set its icon and make it visible
   app->hostList->add(itm->name.c_str(), itm);
   app->hostList->icon(app->hostList->size(), app->iconDisconnected);
@@ -2682,17 +3780,127 @@ int svItemNumFromItm (const HostItem * itmIn)
   if (!itmIn)
     return 0;
 
-  uint16_t nSize = app->hostList->size();
+  return app->hostList->itemRow(itmIn);
+}
+
+
+/*
+  add itm to the set of items that have a VncObject, so per-tick
+  work only has to look at live connections
+*/
+void svActiveAdd (HostItem * itm)
+{
+  if (!itm || itm->state().activeIndex >= 0)
+    return;
+
+  itm->state().activeIndex = static_cast<int>(app->activeIds.size());
+  app->activeIds.push_back(itm->stateId);
+}
+
+
+/*
+  take itm out of the active set
+  (the last entry moves into its slot, so this is O(1))
+*/
+void svActiveRemove (HostItem * itm)
+{
+  if (!itm || itm->state().activeIndex < 0)
+    return;
+
+  uint32_t nLastId = app->activeIds.back();
+
+  app->activeIds[itm->state().activeIndex] = nLastId;
+  svHostState(nLastId).activeIndex = itm->state().activeIndex;
+
+  app->activeIds.pop_back();
+  itm->state().activeIndex = -1;
+}
+
+
+/*
+  search box text changed
+  (no parameters used so all parameter names removed)
+*/
+void svHandleSearchBox (Fl_Widget *, void *)
+{
+  svSearchFilterHostList();
+}
+
+
+/*
+  show only the host list rows matching the search box
+  (only rows whose state changes are touched, unless reset is
+  true because rows were added, removed or moved)
+*/
+void svSearchFilterHostList (bool reset)
+{
+  if (!app->searchBox || !app->hostList)
+    return;
+
+  const char * strQuery = app->searchBox->value();
+  int nSize = app->hostList->size();
 
-  // go through hostlist and find item owning matching itmIn
-  for (uint16_t i = 0; i <= nSize; i ++)
+  // nothing to search for, so show everything again
+  if (!strQuery || strQuery[0] == '\0')
   {
-    const HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
-    if (itm && itm == itmIn)
-      return i;
+    if (m_searchActive)
+    {
+      for (int i = 1; i <= nSize; i ++)
+        app->hostList->show(i);
+
+      m_searchActive = false;
+      m_searchShownRows.clear();
+
+      app->hostList->redraw();
+    }
+
+    return;
+  }
+
+  std::vector<void *> matches;
+  svSearchQuery(strQuery, matches);
+
+  std::vector<int> rows;
+  rows.reserve(matches.size());
+
+  for (const void * itm : matches)
+  {
+    int nRow = app->hostList->itemRow(itm);
+
+    if (nRow > 0)
+      rows.push_back(nRow);
+  }
+
+  std::sort(rows.begin(), rows.end());
+
+  if (!m_searchActive || reset)
+  {
+    for (int i = 1; i <= nSize; i ++)
+      app->hostList->hide(i);
+
+    for (int nRow : rows)
+      app->hostList->show(nRow);
+  }
+  else
+  {
+    std::vector<int> changed;
+
+    std::set_symmetric_difference(m_searchShownRows.begin(), m_searchShownRows.end(),
+      rows.begin(), rows.end(), std::back_inserter(changed));
+
+    for (int nRow : changed)
+    {
+      if (std::binary_search(rows.begin(), rows.end(), nRow))
+        app->hostList->show(nRow);
+      else
+        app->hostList->hide(nRow);
+    }
   }
 
-  return 0;
+  m_searchActive = true;
+  m_searchShownRows.swap(rows);
+
+  app->hostList->redraw();
 }
 
 
@@ -2840,16 +4048,10 @@ void svMessageWindow (const std::string& strMessage, const std::string& strTitle
 /*  return number of connected items (integer)  */
 bool svThereAreConnectedItems ()
 {
-  int nSize = app->hostList->size();
-
-  // go through each itm in the host list and
-  // return true on the first connected one
-  for (uint16_t i = 1; i <= nSize; i ++)
-  {
-    const HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
-    if (itm && itm->isConnected)
-        return true;
-  }
+  // only items with a viewer can be connected
+  for (uint32_t nId : app->activeIds)
+    if (svHostState(nId).isConnected)
+      return true;
 
   return false;
 }
@@ -2932,6 +4134,58 @@ void svRunCommand(const std::string& label, const std::string& cmd)
 }
 
 
+/*
+  build the scan order from the host list, starting the scan
+  after the item at app->nCurrentScanItem
+  (called when a scan starts and each time it wraps around)
+*/
+void svScanBuildOrder ()
+{
+  app->scanOrder.clear();
+  app->nScanPos = 0;
+
+  // only items with a viewer can be scanned, taken in host list order
+  for (uint32_t nId : app->activeIds)
+  {
+    if (svHostState(nId).isListener)
+      continue;
+
+    int nRow = svItemNumFromItm(svHostState(nId).itm);
+
+    if (nRow > 0)
+      app->scanOrder.push_back(std::make_pair(nRow, nId));
+  }
+
+  std::sort(app->scanOrder.begin(), app->scanOrder.end());
+
+  // the next step moves forward one, so sit on the entry before the current item
+  for (size_t n = 0; n < app->scanOrder.size() && app->scanOrder[n].first <= app->nCurrentScanItem; n ++)
+    app->nScanPos = n;
+}
+
+
+/*
+  return the scan order position of the next connected
+  item after nFrom, wrapping around to the top
+  (returns app->scanOrder.size() if nothing is connected)
+*/
+size_t svScanNextConnected (size_t nFrom)
+{
+  size_t nSize = app->scanOrder.size();
+
+  for (size_t n = 1; n <= nSize; n ++)
+  {
+    size_t nPos = (nFrom + n) % nSize;
+    const HostState & state = svHostState(app->scanOrder[nPos].second);
+
+    if (state.isConnected && state.vnc && state.vnc->vncClient)
+      return nPos;
+  }
+
+  return nSize;
+}
+
+
 /*
   scan the host list for active connections and pause on each one
   for user-determined time interval
@@ -2942,10 +4196,28 @@ void svScanTimer (void *)
   // remove any previously added timer
   Fl::remove_timeout(svScanTimer);
 
-  if (!app->scanIsRunning || !svThereAreConnectedItems())
+  size_t nPos = app->scanOrder.size();
+
+  if (app->scanIsRunning)
+  {
+    nPos = svScanNextConnected(app->nScanPos);
+
+    // the list changed under us or we wrapped around, so pick up any
+    // added / removed items before going on
+    if (nPos < app->scanOrder.size() && (nPos <= app->nScanPos ||
+      app->hostList->data(app->scanOrder[nPos].first) != svHostState(app->scanOrder[nPos].second).itm))
+    {
+      svScanBuildOrder();
+      nPos = svScanNextConnected(app->nScanPos);
+    }
+  }
+
+  if (!app->scanIsRunning || nPos >= app->scanOrder.size())
   {
     app->scanIsRunning = false;
     app->nCurrentScanItem = 0;
+    app->scanOrder.clear();
+    m_scanPrefetchItm = NULL;
     app->mainWin->label("SpiritVNC");
     app->btnListScan->image(new Fl_Pixmap(pmListScan));
     app->btnListScan->redraw();
@@ -2959,78 +4231,119 @@ void svScanTimer (void *)
     return;
   }
 
-  while (app->scanIsRunning)
-  {
-    app->nCurrentScanItem ++;
+  HostItem * itm = svHostState(app->scanOrder[nPos].second).itm;
 
-    // start over from the top
-    if (app->nCurrentScanItem > app->hostList->size())
-    {
-      app->nCurrentScanItem = 0;
-      svDeselectAllItems();
-      svScanTimer(NULL);
+  app->nScanPos = nPos;
+  app->nCurrentScanItem = app->scanOrder[nPos].first;
 
-      return;
-    }
+  // decode the frame requested on the last step before showing it, so
+  // the switch doesn't show a stale or blank screen first
+  bool wasPrefetched = (itm == m_scanPrefetchItm && itm->state().vnc->handlePendingMessages());
 
-    // hunt for next connected viewer
-    HostItem * itm = static_cast<HostItem *>(app->hostList->data(app->nCurrentScanItem));
-    if (!itm)
-      continue;
+  m_scanPrefetchItm = NULL;
 
-    if (itm->isConnected)
-    {
-      svDeselectAllItems();
-      VncObject::hideMainViewer();
-      app->hostList->select(app->nCurrentScanItem);
-      itm->vnc->setObjectVisible();
+  if (itm->state().isConnected)
+  {
+    svDeselectAllItems();
+    VncObject::hideMainViewer();
+    app->hostList->select(app->nCurrentScanItem);
+    itm->state().vnc->setObjectVisible(!wasPrefetched);
 
-      // set quick note label and note text
-      svQuickInfoSetLabelAndText(itm);
+    // set quick note label and note text
+    svQuickInfoSetLabelAndText(itm);
 
-      // 'tickle' host screen so it doesn't go to screensaver by
-      // moving remote mouse back and forth a certain amount
-      // (don't do this for view-only connections)
-      if (!itm->viewOnly)
-      {
-        SendPointerEvent(itm->vnc->vncClient, 0, 0, 0);
-        Fl::check();
-        SendPointerEvent(itm->vnc->vncClient, 100, 100, 0);
-        Fl::check();
-        SendPointerEvent(itm->vnc->vncClient, 0, 0, 0);
-        Fl::check();
-      }
-      break;
+    // 'tickle' host screen so it doesn't go to screensaver by
+    // moving remote mouse back and forth a certain amount
+    // (don't do this for view-only connections)
+    if (!itm->viewOnly)
+    {
+      itm->state().vnc->sendPointer(0, 0, 0);
+      Fl::check();
+      itm->state().vnc->sendPointer(100, 100, 0);
+      Fl::check();
+      itm->state().vnc->sendPointer(0, 0, 0);
+      Fl::check();
     }
   }
 
+  // ask the next host for a full frame now, so it's ready by the next step
+  size_t nNextPos = svScanNextConnected(app->nScanPos);
+
+  if (nNextPos < app->scanOrder.size() && nNextPos != app->nScanPos)
+  {
+    const HostState & state = svHostState(app->scanOrder[nNextPos].second);
+
+    if (state.vnc->sendFullUpdateRequest())
+      m_scanPrefetchItm = state.itm;
+  }
+
   // call me again
   Fl::add_timeout(app->nScanTimeout, svScanTimer);
 }
 
 
+/*
+  schedule an automatic reconnect for itm using exponential
+  backoff with random jitter, if the host wants one
+*/
+void svScheduleReconnect (HostItem * itm)
+{
+  static std::mt19937 rng(std::random_device{}());
+
+  if (!itm || !itm->autoReconnect || itm->state().isListener || app->shuttingDown)
+    return;
+
+  // double the wait for each failed attempt, up to the maximum
+  int nShift = std::min<int>(itm->state().reconnectAttempts, 8);
+  int nDelay = std::min(SV_RECONNECT_MAX_SECS, SV_RECONNECT_BASE_SECS << nShift);
+
+  // wait somewhere between half and all of that, so hosts that dropped
+  // together don't all come back at once
+  std::uniform_int_distribution<int> jitter(0, nDelay / 2);
+  nDelay = (nDelay / 2) + jitter(rng);
+
+  if (nDelay < 1)
+    nDelay = 1;
+
+  itm->state().reconnectAttempts ++;
+
+  if (itm->state().reconnectTime == 0)
+    app->reconnectQueue.push_back(itm);
+
+  itm->state().reconnectTime = time(NULL) + nDelay;
+
+  svLogToFile("Reconnecting to '" + itm->name + "' - " + itm->hostAddress + " in " +
+    std::to_string(nDelay) + " seconds");
+}
+
+
 /* send a stored text string to the vnc host */
-void svSendKeyStrokesToHost (const std::string& strIn, const VncObject * vnc)
+void svSendKeyStrokesToHost (const std::string& strIn, VncObject * vnc)
 {
   if (!vnc)
     return;
 
   size_t stringSize = strIn.size();
 
-  // iterate through string and send each character
+  vnc->keyBatch.reserve(vnc->keyBatch.size() + (stringSize * 2));
+
+  // iterate through string and batch each character's key down / up
   for (uintmax_t i = 0; i < stringSize; i ++)
   {
-    // get out if we hit a null character
+    // stop if we hit a null character
     if (strIn[i] == '\0')
-      return;
+      break;
 
     // send everything except newlines
     if (strIn[i] != '\n')
     {
-      SendKeyEvent(vnc->vncClient, strIn[i], true);
-      SendKeyEvent(vnc->vncClient, strIn[i], false);
+      vnc->addKeyToBatch(static_cast<uint8_t>(strIn[i]), true);
+      vnc->addKeyToBatch(static_cast<uint8_t>(strIn[i]), false);
     }
   }
+
+  // send the whole string in one write (or paced, if the host has a key delay)
+  vnc->sendKeyBatch();
 }
 
 
@@ -3039,7 +4352,7 @@ void svSetAppTooltips ()
 {
   // set app tooltips
   // (item and app options tooltips are set in their svShow.. methods)
-  app->btnListAdd->tooltip("Add a new connection");
+  app->btnListAdd->tooltip("Add a new connection (right-click to import many)");
   app->btnListDelete->tooltip("Delete current connection");
   app->btnListUp->tooltip("Move current connection item up in list");
   app->btnListDown->tooltip("Move current connection item down in list");
@@ -3047,11 +4360,13 @@ void svSetAppTooltips ()
   app->btnListListen->tooltip("Listen for incoming VNC connections");
   app->btnListHelp->tooltip("View About and Help information");
   app->btnListOptions->tooltip("View / edit app options");
+  app->searchBox->tooltip("Type to show only items whose name, address, group or Quick Note match");
   app->hostList->tooltip("Double-click a disconnected item to connect to it\n\n"
     "Right-click a connected item to disconnect from it\n\n"
     "Right-click a disconnected item to connect, edit or delete it");
   app->quickInfoLabel->tooltip("The current item's name");
   app->lastConnected->tooltip("The last time this connection was successfully made");
+  app->connStats->tooltip("Round-trip time and retransmitted packets for the current connection");
   app->lastErrorBox->tooltip("The last error when trying to connect to the current item");
   app->quickNoteBox->tooltip("Click here to enter a brief note about the current item");
 
@@ -3176,7 +4491,11 @@ void svShowAppOptions ()
 
   // window size
   int nWinWidth = 675;
-  int nWinHeight = 630;
+  #ifdef _WIN32
+  int nWinHeight = 758;
+  #else
+  int nWinHeight = 822;
+  #endif
 
   // set window position
   int nX = app->hostList->w() + 50;
@@ -3223,6 +4542,41 @@ void svShowAppOptions ()
   spinLocalSSHPort->value(app->nStartingLocalPort);
   spinLocalSSHPort->tooltip("This is the first SSH port used locally for VNC-over-SSH connections");
 
+  // how many local ports ssh forwards can use
+  Fl_Spinner * spinLocalPortRange = new Fl_Spinner(nXPos + 165, nYPos, 90, 28, "Range ");
+  m_appOptions["spinLocalPortRange"] = spinLocalPortRange;
+  spinLocalPortRange->textsize(app->nAppFontSize);
+  spinLocalPortRange->labelsize(app->nAppFontSize);
+  spinLocalPortRange->step(100);
+  spinLocalPortRange->minimum(1);
+  spinLocalPortRange->maximum(50000);
+  spinLocalPortRange->value(app->nLocalPortRange);
+  spinLocalPortRange->tooltip("How many local ports, starting at the SSH port number, can be used"
+    " for VNC-over-SSH connections at once");
+
+  #ifndef _WIN32
+  // forward ssh over unix-domain sockets?
+  Fl_Check_Button * chkSSHUnixSockets = new Fl_Check_Button(nXPos, nYPos += nYStep, 210, 28,
+    " Use local socket files for SSH forwarding");
+  m_appOptions["chkSSHUnixSockets"] = chkSSHUnixSockets;
+  chkSSHUnixSockets->labelsize(app->nAppFontSize);
+  chkSSHUnixSockets->tooltip("Check this to forward VNC-over-SSH connections through private"
+    " socket files instead of local port numbers (requires OpenSSH 6.7 or newer)");
+  if (app->sshUnixSockets)
+    chkSSHUnixSockets->set();
+
+  // share one ssh connection per ssh server?
+  Fl_Check_Button * chkSSHControlMaster = new Fl_Check_Button(nXPos, nYPos += nYStep, 210, 28,
+    " Share SSH connections to the same server");
+  m_appOptions["chkSSHControlMaster"] = chkSSHControlMaster;
+  chkSSHControlMaster->labelsize(app->nAppFontSize);
+  chkSSHControlMaster->tooltip("Check this to run one SSH connection per SSH user, server and port"
+    " and add each host's forwarding to it, so connecting more hosts through the same server"
+    " skips the SSH login");
+  if (app->sshControlMaster)
+    chkSSHControlMaster->set();
+  #endif
+
   // ssh command
   SVInput * inSSHCommand = new SVInput(nXPos, nYPos += nYStep, 210, 28, "SSH command (eg: ssh or /usr/bin/ssh) ");
   m_appOptions["inSSHCommand"] = inSSHCommand;
@@ -3248,6 +4602,56 @@ void svShowAppOptions ()
   if (app->rightClickToClose)
     chkRightClickToClose->set();
 
+  // decode screen updates in a background thread?
+  Fl_Check_Button * chkDecodeInThread = new Fl_Check_Button(nXPos, nYPos += nYStep, 210, 28,
+    " Decode screen updates in a background thread");
+  m_appOptions["chkDecodeInThread"] = chkDecodeInThread;
+  chkDecodeInThread->labelsize(app->nAppFontSize);
+  chkDecodeInThread->tooltip("Check this to read and decode the displayed host's screen updates"
+    " in a separate thread, keeping the app responsive during heavy updates such as video");
+  if (app->decodeInThread)
+    chkDecodeInThread->set();
+
+  // maximum automatic reconnects in progress at once
+  Fl_Spinner * spinMaxReconnects = new Fl_Spinner(nXPos, nYPos += nYStep, 100, 28,
+    "Maximum simultaneous reconnects ");
+  m_appOptions["spinMaxReconnects"] = spinMaxReconnects;
+  spinMaxReconnects->textsize(app->nAppFontSize);
+  spinMaxReconnects->labelsize(app->nAppFontSize);
+  spinMaxReconnects->step(1);
+  spinMaxReconnects->minimum(1);
+  spinMaxReconnects->maximum(100);
+  spinMaxReconnects->value(app->nMaxReconnects);
+  spinMaxReconnects->tooltip("The most automatic reconnects that can be in progress at the same"
+    " time.  Lower this to avoid overloading a shared SSH jump host after a network outage");
+
+  // minutes before an unused connection is suspended
+  Fl_Spinner * spinIdleSuspendMins = new Fl_Spinner(nXPos, nYPos += nYStep, 100, 28,
+    "Suspend idle connections (mins) ");
+  m_appOptions["spinIdleSuspendMins"] = spinIdleSuspendMins;
+  spinIdleSuspendMins->textsize(app->nAppFontSize);
+  spinIdleSuspendMins->labelsize(app->nAppFontSize);
+  spinIdleSuspendMins->step(5);
+  spinIdleSuspendMins->minimum(0);
+  spinIdleSuspendMins->maximum(1440);
+  spinIdleSuspendMins->value(app->nIdleSuspendMins);
+  spinIdleSuspendMins->tooltip("Disconnect connections that haven't been displayed or used for this"
+    " many minutes, keeping a compressed copy of the last screen.  Selecting the host shows that"
+    " copy and reconnects.  0 turns this off");
+
+  // seconds between host reachability probes
+  Fl_Spinner * spinProbeInterval = new Fl_Spinner(nXPos, nYPos += nYStep, 100, 28,
+    "Host reachability check (secs) ");
+  m_appOptions["spinProbeInterval"] = spinProbeInterval;
+  spinProbeInterval->textsize(app->nAppFontSize);
+  spinProbeInterval->labelsize(app->nAppFontSize);
+  spinProbeInterval->step(30);
+  spinProbeInterval->minimum(0);
+  spinProbeInterval->maximum(3600);
+  spinProbeInterval->value(app->nProbeInterval);
+  spinProbeInterval->tooltip("How often, in seconds, to check in the background whether each"
+    " unconnected host is answering.  Unreachable hosts get the 'no connect' icon.  0 turns this off");
+
   // adjust message loop wait time
   Fl_Spinner * spinMsgLoopSpeed = new Fl_Spinner(nXPos, nYPos += nYStep, 100, 28, "VNC message loop speed");
   m_appOptions["spinMsgLoopSpeed"] = spinMsgLoopSpeed;
@@ -3516,6 +4920,20 @@ void svHandleQuickNoteEditorButtons (Fl_Widget * button, void *)
     if (button == m_quickNoteEdit["btnSave"])
     {
       itm->quickNote = buf->text();
+      itm->quickNoteEncoded = false;
+
+      // a config reload waiting for this host keeps the new note too
+      HostItem * itmReloaded = NULL;
+
+      if (svConfigWatchPending(itm, &itmReloaded) && itmReloaded)
+      {
+        itmReloaded->quickNote = itm->quickNote;
+        itmReloaded->quickNoteEncoded = false;
+      }
+
+      itm->configDirty = true;
+      svSearchIndexUpdate(itm);
+      svSearchFilterHostList();
       svQuickInfoSetLabelAndText(itm);
     }
   }
@@ -3542,6 +4960,9 @@ void svShowQuickNoteEditorWindow (HostItem * itm)
 
   m_quickNoteEdit["itm"] = itm;
 
+  // hold back config reloads of this host until the editor closes
+  svConfigWatchSetEditing(itm);
+
   // set window position
   int nX = (app->mainWin->w() / 4);
   int nY = (app->mainWin->h() / 3);
@@ -3562,7 +4983,7 @@ void svShowQuickNoteEditorWindow (HostItem * itm)
   SVQuickNoteTextEditor * edit = new SVQuickNoteTextEditor(0, 0, 0, 0);
   edit->buffer(buf);
   edit->wrap_mode(Fl_Text_Display::WRAP_AT_BOUNDS, 0);
-  buf->text(itm->quickNote.c_str());
+  buf->text(svQuickNote(itm).c_str());
 
   // move cursor to the end
   edit->insert_position(buf->length());
@@ -3622,7 +5043,15 @@ void svShowConnectionEditor (HostItem * itmIn)
   // make a new itm if we're passed a null one
   if (!itm)
   {
-    itm = new HostItem();
+    itm = svHostItemNew();
+
+    if (!itm)
+    {
+      app->childWindowVisible = false;
+      svMessageWindow("Error: Too many hosts, can't add another", "SpiritVNC - FLTK");
+      return;
+    }
+
     itm->name = "(new connection)";
     itm->hostAddress = "0.0.0.0";
     itm->vncPort = "5900";
@@ -3632,16 +5061,19 @@ void svShowConnectionEditor (HostItem * itmIn)
     itm->showRemoteCursor = true;
     itm->compressLevel = 5;
     itm->qualityLevel = 5;
-    itm->vnc = NULL;
+    itm->state().vnc = NULL;
   }
 
   m_itmSettings.clear();
 
   m_itmSettings["itm"] = itm;
 
+  // hold back config reloads of this host until the editor closes
+  svConfigWatchSetEditing(itm);
+
   // window size
   int nWinWidth = 545;
-  int nWinHeight = 600;
+  int nWinHeight = 656;
 
   // set window position
   int nX = app->hostList->w() + 50;
@@ -3660,7 +5092,7 @@ void svShowConnectionEditor (HostItem * itmIn)
   int nYPos = -24;
 
   // disable some things if the connection is connected
-  bool disableConnectedSettings = itm->isConnected;
+  bool disableConnectedSettings = itm->state().isConnected;
 
   // add itm value editors / selectors
 
@@ -3705,6 +5137,13 @@ void svShowConnectionEditor (HostItem * itmIn)
   inF12Macro->tooltip("Key presses that are sent to the remote host when"
       " you press the F12 key");
 
+  // delay between key presses when sending the F12 macro
+  SVIntInput * inKeyDelay = new SVIntInput(nXPos, nYPos += nYStep, 48, 28, "Key delay (ms) ");
+  m_itmSettings["inKeyDelay"] = inKeyDelay;
+  inKeyDelay->value(std::to_string(itm->keyDelay).c_str());
+  inKeyDelay->tooltip("Milliseconds to wait between key presses when sending the F12 macro,"
+      " from 0 to 1000.  Use 0 to send the whole macro at once");
+
   // * vnc type buttons *
 
   // vnc without ssh
@@ -3774,6 +5213,23 @@ void svShowConnectionEditor (HostItem * itmIn)
   inVNCQualityLevel->value(std::to_string(itm->qualityLevel).c_str());
   inVNCQualityLevel->tooltip("The level of image quality, from 0 to 9");
 
+  // vnc colour depth
+  Fl_Choice * chColorDepth = new Fl_Choice(nXPos, nYPos += nYStep, 210, 28, "Color depth ");
+  m_itmSettings["chColorDepth"] = chColorDepth;
+  if (disableConnectedSettings)
+    chColorDepth->deactivate();
+  chColorDepth->add("8-bit (256 colors)");
+  chColorDepth->add("16-bit (65536 colors)");
+  chColorDepth->add("24-bit (true color)");
+  if (itm->colorDepth == 8)
+    chColorDepth->value(0);
+  else if (itm->colorDepth == 16)
+    chColorDepth->value(1);
+  else
+    chColorDepth->value(2);
+  chColorDepth->tooltip("The color depth requested from the host.  Lower color depths"
+      " use less bandwidth on slow links");
+
   // ##### scaling start #####
 
   // * scaling options group *
@@ -3893,6 +5349,71 @@ void svShowConnectionEditor (HostItem * itmIn)
   // end of ssh options tab
   sshGroup->end();
 
+  // ############ network options ##########################################################
+  nYPos = 4;
+
+  Fl_Group * networkGroup = new Fl_Group(0, nYPos += nYStep, nWinWidth - 20, nWinHeight - 20, "Network");
+
+  nYPos = 16;
+
+  // disable nagle's algorithm
+  Fl_Check_Button * chkTcpNoDelay = new Fl_Check_Button(nXPos, nYPos += nYStep, 100, 28,
+    " Send input immediately (TCP_NODELAY)");
+  m_itmSettings["chkTcpNoDelay"] = chkTcpNoDelay;
+  if (disableConnectedSettings)
+    chkTcpNoDelay->deactivate();
+  if (itm->tcpNoDelay)
+    chkTcpNoDelay->set();
+  chkTcpNoDelay->tooltip("Check to send key presses and mouse moves without waiting to combine them");
+
+  // socket buffer sizes
+  SVIntInput * inTcpBufferSize = new SVIntInput(nXPos, nYPos += nYStep, 100, 28, "Socket buffers (KB) ");
+  m_itmSettings["inTcpBufferSize"] = inTcpBufferSize;
+  if (disableConnectedSettings)
+    inTcpBufferSize->deactivate();
+  inTcpBufferSize->value(std::to_string(itm->tcpBufferSize).c_str());
+  inTcpBufferSize->tooltip("Size of the socket send and receive buffers in kilobytes.  Use 0 for the"
+      " system default.  Larger buffers help on fast, high-latency links");
+
+  // tcp keepalive
+  Fl_Check_Button * chkTcpKeepAlive = new Fl_Check_Button(nXPos, nYPos += nYStep, 100, 28,
+    " Detect dead connections (keepalive)");
+  m_itmSettings["chkTcpKeepAlive"] = chkTcpKeepAlive;
+  if (disableConnectedSettings)
+    chkTcpKeepAlive->deactivate();
+  if (itm->tcpKeepAlive)
+    chkTcpKeepAlive->set();
+  chkTcpKeepAlive->tooltip("Check to probe idle connections so dead links are noticed");
+
+  // keepalive idle time
+  SVIntInput * inKeepAliveIdle = new SVIntInput(nXPos, nYPos += nYStep, 100, 28, "Keepalive idle (secs) ");
+  m_itmSettings["inKeepAliveIdle"] = inKeepAliveIdle;
+  if (disableConnectedSettings)
+    inKeepAliveIdle->deactivate();
+  inKeepAliveIdle->value(std::to_string(itm->keepAliveIdle).c_str());
+  inKeepAliveIdle->tooltip("Seconds a connection must be idle before keepalive probes are sent");
+
+  // keepalive probe interval
+  SVIntInput * inKeepAliveInterval = new SVIntInput(nXPos, nYPos += nYStep, 100, 28,
+    "Keepalive interval (secs) ");
+  m_itmSettings["inKeepAliveInterval"] = inKeepAliveInterval;
+  if (disableConnectedSettings)
+    inKeepAliveInterval->deactivate();
+  inKeepAliveInterval->value(std::to_string(itm->keepAliveInterval).c_str());
+  inKeepAliveInterval->tooltip("Seconds between keepalive probes");
+
+  // reconnect automatically after unexpected disconnects
+  Fl_Check_Button * chkAutoReconnect = new Fl_Check_Button(nXPos, nYPos += nYStep, 100, 28,
+    " Reconnect automatically if disconnected");
+  m_itmSettings["chkAutoReconnect"] = chkAutoReconnect;
+  if (itm->autoReconnect)
+    chkAutoReconnect->set();
+  chkAutoReconnect->tooltip("Check to reconnect after an unexpected disconnect, waiting a little"
+      " longer after each failed attempt");
+
+  // end of network options tab
+  networkGroup->end();
+
   // ############ custom commands ##########################################################
   nYPos = 4;
 
@@ -4002,9 +5523,9 @@ void svShowConnectionEditor (HostItem * itmIn)
 /* update text on all host items */
 void svUpdateHostListItemText ()
 {
-  uint16_t nSize = app->hostList->size();
+  int nSize = app->hostList->size();
 
-  for (uint16_t i = 0; i <= nSize; i ++)
+  for (int i = 0; i <= nSize; i ++)
   {
     HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
     if (itm)
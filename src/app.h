@@ -45,6 +45,7 @@
 #include <FL/fl_ask.H>
 #include <FL/Fl_Button.H>
 #include <FL/Fl_Check_Button.H>
+#include <FL/Fl_Choice.H>
 #include <FL/Fl_Double_Window.H>
 #include <FL/fl_draw.H>
 #include <FL/Fl_File_Chooser.H>
@@ -73,6 +74,7 @@
 #include <FL/Fl_Window.H>
 
 #include <fstream>
+#include <random>
 #include <unordered_map>
 //#include <cstring>
 
@@ -91,12 +93,22 @@
 #include <signal.h>
 
 #include "base64.h"
+#include "confwatch.h"
 #include "consts_enums.h"
+#include "framebuffer.h"
+#include "hostcache.h"
 #include "hostitem.h"
+#include "import.h"
+#include "listener.h"
+#include "net.h"
 #include "pixmaps.h"
+#include "prober.h"
+#include "resolver.h"
+#include "search.h"
 #include "vnc.h"
 #include "ssh.h"
 
+class SVHostList;
 class SVMainWindow;
 class SVInput;
 class SVQuickNoteBox;
@@ -112,6 +124,7 @@ public:
     flexParent(NULL),
     flexLeftSide(NULL),
     hostList(NULL),
+    searchBox(NULL),
     scroller(NULL),
     vncViewer(NULL),
     iconApp(NULL),
@@ -139,12 +152,20 @@ public:
     btnListScan(NULL),
     scanIsRunning(false),
     nCurrentScanItem(0),
+    nScanPos(0),
     nScanTimeout(2),
     nStartingLocalPort(15000),
+    nLocalPortRange(1000),
+    sshUnixSockets(false),
+    sshControlMaster(false),
     showTooltips(true),
     enableLogToFile(false),
     rightClickToClose(false),
     debugMode(false),
+    decodeInThread(false),
+    nMaxReconnects(3),
+    nProbeInterval(0),
+    nIdleSuspendMins(0),
     #ifdef _WIN32
     nAppFontSize(12),
     #else
@@ -170,6 +191,7 @@ public:
     quickInfoLabel(NULL),
     lastConnectedLabel(),
     lastConnected(NULL),
+    connStats(NULL),
     lastErrorBox(NULL),
     quickNoteBox(NULL),
     quickNotePack(NULL),
@@ -235,7 +257,8 @@ public:
   SVMainWindow * mainWin;
   Fl_Flex * flexParent;
   Fl_Flex * flexLeftSide;
-  Fl_Hold_Browser * hostList;
+  SVHostList * hostList;
+  SVInput * searchBox;
   Fl_Scroll * scroller;
   VncViewer * vncViewer;
   Fl_RGB_Image * iconApp;
@@ -263,12 +286,23 @@ public:
   Fl_Button * btnListScan;
   bool scanIsRunning;
   int nCurrentScanItem;
+  std::vector<std::pair<int, uint32_t>> scanOrder;
+  size_t nScanPos;
+  std::vector<uint32_t> activeIds;
+  std::vector<HostItem *> reconnectQueue;
   uint16_t nScanTimeout;
   int nStartingLocalPort;
+  int nLocalPortRange;
+  bool sshUnixSockets;
+  bool sshControlMaster;
   bool showTooltips;
   bool enableLogToFile;
   bool rightClickToClose;
   bool debugMode;
+  bool decodeInThread;
+  int nMaxReconnects;
+  int nProbeInterval;
+  int nIdleSuspendMins;
   int nAppFontSize;
   std::string strListFont;
   int nListFontSize;
@@ -286,6 +320,7 @@ public:
   Fl_Box * quickInfoLabel;
   Fl_Box * lastConnectedLabel;
   Fl_Box * lastConnected;
+  Fl_Box * connStats;
   Fl_Multiline_Output * lastErrorBox;
   SVQuickNoteBox * quickNoteBox;
   SVQuickNotePack * quickNotePack;
@@ -308,6 +343,30 @@ public:
   void resize(int x, int y, int w, int h) override;
 };
 
+/*
+  subclassed host list that keeps a row <-> item index, so
+  looking up an item's row doesn't walk the whole list
+*/
+class SVHostList : public Fl_Hold_Browser
+{
+public:
+  SVHostList (int x, int y, int w, int h, const char * label = 0) :
+    Fl_Hold_Browser(x, y, w, h, label),
+    rowItems(1, static_cast<void *>(NULL)) {}
+  using Fl_Hold_Browser::data;
+  void add (const char *, void * = 0);
+  void insert (int, const char *, void * = 0);
+  void remove (int);
+  void clear ();
+  void swap (int, int);
+  void * data (int) const;
+  int itemRow (const void *) const;
+private:
+  void reindexFrom (int);
+  std::vector<void *> rowItems;
+  std::unordered_map<const void *, int> itemRows;
+};
+
 /* subclassed input box */
 class SVInput : public Fl_Input
 {
@@ -368,12 +427,18 @@ private:
 };
 
 /* forward function declarations */
+void svActiveAdd (HostItem *);
+void svActiveRemove (HostItem *);
 void svBlinkCursor (void *);
 void svCloseChildWindow (Fl_Widget *, void *);
 void svCloseDeleteFinalizeChildWindow (Fl_Window *);
 void svCloseSSHConnection (void *);
 void svConfigCreateNewDir ();
+const std::string& svConfigHostBlock (HostItem *);
+bool svConfigLoadFile (std::string&);
+void svConfigParseHosts (std::string&, std::vector<HostItem *>&);
 void svConfigRead ();
+bool svConfigSetHostProperty (HostItem *, const char *, const char *);
 void svConfigWrite ();
 void svConnectionWatcher (void *);
 void svCreateAppIcons (const bool fromAppOptions = false);
@@ -385,20 +450,19 @@ void svDeleteItem (const int);
 void svDeselectAllItems ();
 void svDoStartupTasks ();
 void svEnableDisableTooltips ();
-int svFindFreeTcpPort ();
-std::string svGetConfigProperty (const char *);
-std::string svGetConfigValue (const char *);
 void svHandleAppOptionsButtons ();
 void svHandleConnEditButtons (Fl_Widget *, void *);
 void svHandleLocalClipboard (const int, void *);
 void svHandleHostListButtons (Fl_Widget *, void *);
 void svHandleHostListEvents (Fl_Widget *, void *);
 void svHandleQuickNoteEditorButtons (Fl_Widget *, void *);
+void svHandleSearchBox (Fl_Widget *, void *);
 void svHandleMainWindowEvents (Fl_Widget *, void *);
 void svPositionWidgets ();
 void svHandleListItemIconChange (void *);
 void svHandleThreadConnection (void *);
 void svHandleThreadCursorChange (void *);
+void svIdleWatcher ();
 void svInsertEmptyItem ();
 int svItemNumFromItm (const HostItem *);
 void svHandleConnEditChoosePrvKeyBtn (Fl_Widget *, void *);
@@ -413,12 +477,20 @@ bool svThereAreConnectedItems ();
 void svPopUpEditMenu (Fl_Input_ *);
 void svQuickInfoSetLabelAndText (HostItem *);
 void svQuickInfoSetToEmpty ();
+void svQuickInfoUpdateStats ();
+const std::string& svQuickNote (HostItem *);
+void svReconnectWatcher ();
+void svRemoveHostItem (const int);
 void svResizeScroller ();
 void svRestoreWindowSizePosition (void *);
 void svRunCommand(const std::string&, const std::string&);
 void svRunCommandHelper(const char **);
+void svScanBuildOrder ();
+size_t svScanNextConnected (size_t);
 void svScanTimer (void *);
-void svSendKeyStrokesToHost (const std::string&, const VncObject *);
+void svScheduleReconnect (HostItem *);
+void svSearchFilterHostList (bool reset = false);
+void svSendKeyStrokesToHost (const std::string&, VncObject *);
 void svSetAppTooltips ();
 void svShowAboutHelp ();
 void svShowAppOptions ();
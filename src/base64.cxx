@@ -34,60 +34,88 @@
 
 #include "base64.h"
 
-
-/*  base64  */
-static inline bool base64Type (unsigned char c)
-{
-  return (isalnum(c) || (c == '+') || (c == '/'));
-}
+/*  base64 alphabet, indexed by 6-bit value  */
+static const char m_base64Chars[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  "abcdefghijklmnopqrstuvwxyz"
+  "0123456789+/";
+
+/*  6-bit value of each byte, 0xFF for bytes outside the alphabet (including '=')  */
+static const unsigned char m_base64Values[256] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+  0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
 
 
-/*  base64  */
+/*
+  base64
+  (decoding stops at the first '=' or byte outside the alphabet)
+*/
 std::string base64Decode (std::string const& encoded_string)
 {
-  size_t in_len = encoded_string.size();
+  const unsigned char * p = reinterpret_cast<const unsigned char *>(encoded_string.data());
+  size_t nLen = encoded_string.size();
   size_t i = 0;
 
-  int in_ = 0;
-  unsigned char char_array_4[4], char_array_3[3];
   std::string ret;
+  ret.resize((nLen / 4) * 3 + 3);
+
+  char * out = &ret[0];
 
-  while (in_len-- && ( encoded_string[in_] != '=') && base64Type(encoded_string[in_]))
+  // whole groups of four characters
+  while (i + 4 <= nLen)
   {
-    char_array_4[i ++] = encoded_string[in_]; in_ ++;
+    unsigned char a = m_base64Values[p[i]];
+    unsigned char b = m_base64Values[p[i + 1]];
+    unsigned char c = m_base64Values[p[i + 2]];
+    unsigned char d = m_base64Values[p[i + 3]];
 
-    if (i ==4)
-    {
-      for (i = 0; i < 4; i ++)
-        char_array_4[i] = static_cast<unsigned char>(base64_chars.find(char_array_4[i]));
+    if ((a | b | c | d) & 0x80)
+      break;
 
-      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+    uint32_t n = (a << 18) | (b << 12) | (c << 6) | d;
 
-      for (i = 0; (i < 3); i ++)
-        ret += char_array_3[i];
+    out[0] = static_cast<char>(n >> 16);
+    out[1] = static_cast<char>(n >> 8);
+    out[2] = static_cast<char>(n);
 
-      i = 0;
-    }
+    out += 3;
+    i += 4;
   }
 
-  if (i != 0)
-  {
-    for (int j = i; j <4; j ++)
-      char_array_4[j] = 0;
+  // a short last group, before padding or the end
+  unsigned char tail[3] = {0, 0, 0};
+  size_t nTail = 0;
+
+  while (i < nLen && nTail < 3 && !(m_base64Values[p[i]] & 0x80))
+    tail[nTail ++] = m_base64Values[p[i ++]];
 
-    for (int j = 0; j <4; j ++)
-      char_array_4[j] = static_cast<unsigned char>(base64_chars.find(char_array_4[j]));
+  if (nTail > 1)
+  {
+    uint32_t n = (tail[0] << 18) | (tail[1] << 12) | (tail[2] << 6);
 
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+    *out ++ = static_cast<char>(n >> 16);
 
-    for (size_t j = 0; (j < i - 1); j ++)
-      ret += char_array_3[j];
+    if (nTail > 2)
+      *out ++ = static_cast<char>(n >> 8);
   }
 
+  ret.resize(out - ret.data());
+
   return ret;
 }
 
@@ -96,44 +124,38 @@ std::string base64Decode (std::string const& encoded_string)
 std::string base64Encode (unsigned char const * bytes_to_encode, unsigned int in_len)
 {
   std::string ret;
-  int i = 0;
+  ret.resize(((static_cast<size_t>(in_len) + 2) / 3) * 4);
 
-  unsigned char char_array_3[3];
-  unsigned char char_array_4[4];
+  char * out = &ret[0];
+  const unsigned char * p = bytes_to_encode;
+  const unsigned char * pEnd = p + in_len;
 
-  while (in_len--)
+  // whole groups of three bytes
+  while (pEnd - p >= 3)
   {
-    char_array_3[i ++] = *(bytes_to_encode ++);
-
-    if (i == 3)
-    {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
+    uint32_t n = (p[0] << 16) | (p[1] << 8) | p[2];
 
-      for (i = 0; (i < 4) ; i ++)
-        ret += base64_chars[char_array_4[i]];
+    out[0] = m_base64Chars[(n >> 18) & 0x3F];
+    out[1] = m_base64Chars[(n >> 12) & 0x3F];
+    out[2] = m_base64Chars[(n >> 6) & 0x3F];
+    out[3] = m_base64Chars[n & 0x3F];
 
-      i = 0;
-    }
+    out += 4;
+    p += 3;
   }
 
-  if (i != 0)
+  // one or two bytes left, padded with '='
+  if (p < pEnd)
   {
-    for (int j = i; j < 3; j ++)
-      char_array_3[j] = '\0';
-
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-    char_array_4[3] = char_array_3[2] & 0x3f;
+    uint32_t n = p[0] << 16;
 
-    for (int j = 0; (j < i + 1); j ++)
-      ret += base64_chars[char_array_4[j]];
+    if (pEnd - p == 2)
+      n |= p[1] << 8;
 
-    while (i ++ < 3)
-      ret += '=';
+    out[0] = m_base64Chars[(n >> 18) & 0x3F];
+    out[1] = m_base64Chars[(n >> 12) & 0x3F];
+    out[2] = (pEnd - p == 2) ? m_base64Chars[(n >> 6) & 0x3F] : '=';
+    out[3] = '=';
   }
 
   return ret;
@@ -37,12 +37,6 @@
 
 #include <iostream>
 
-/*  base64  */
-static const std::string base64_chars =
-             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-             "abcdefghijklmnopqrstuvwxyz"
-             "0123456789+/";
-
 std::string base64Encode (unsigned char const *, unsigned int);
 std::string base64Decode (std::string const& encoded_string);
 
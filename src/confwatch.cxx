@@ -0,0 +1,586 @@
+/*
+ * confwatch.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "app.h"
+#include "confwatch.h"
+#include "hostitem.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/inotify.h>
+#endif
+
+/* a config file parsed by the reload thread, waiting for the main thread */
+struct SVConfigReload
+{
+  std::string strText;
+  std::vector<HostItem *> hosts;
+};
+
+// the config text we last loaded or wrote, so our own saves aren't reloaded
+static pthread_mutex_t m_knownTextMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::string m_knownText;
+
+// connected or edited hosts the config changed under (NULL value means removed)
+static std::unordered_map<HostItem *, HostItem *> m_pending;
+
+// host open in the connection or quick note editor, if any
+static HostItem * m_itmEditing = NULL;
+
+static int m_watchFd = -1;
+static bool m_reloadBusy = false;
+static bool m_reloadAgain = false;
+
+static void svConfigWatchReload (void *);
+
+
+/*  remember strText as the config we're already showing  */
+void svConfigWatchSetText (const std::string& strText)
+{
+  pthread_mutex_lock(&m_knownTextMutex);
+  m_knownText = strText;
+  pthread_mutex_unlock(&m_knownTextMutex);
+}
+
+
+/*
+  whether changes to itm must wait, because it's connected or
+  open in an editor that would save over them (or use it once deleted)
+*/
+static bool svConfigWatchMustWait (const HostItem * itm)
+{
+  return itm->state().vnc || itm == m_itmEditing;
+}
+
+
+/*  give idle itm the settings reloaded into itmNew, then free itmNew  */
+static void svConfigWatchApplyEdit (HostItem * itm, HostItem * itmNew)
+{
+  static_cast<HostConfig&>(*itm) = *itmNew;
+
+  // the block itmNew was compared with is now itm's block too
+  itm->configBlock = itmNew->configBlock;
+  itm->configDirty = itmNew->configDirty;
+
+  delete itmNew;
+
+  svSearchIndexUpdate(itm);
+
+  if (itm->hostType == 'v')
+    svResolverPrewarm(itm->hostAddress);
+}
+
+
+/*
+  remove idle itm's row, and a separator left
+  doubled up when it was the last of its group
+*/
+static void svConfigWatchRemoveItem (HostItem * itm)
+{
+  int nRow = svItemNumFromItm(itm);
+
+  if (nRow < 1)
+    return;
+
+  svRemoveHostItem(nRow);
+
+  if (nRow > 1 && nRow <= app->hostList->size() && !app->hostList->data(nRow) &&
+    !app->hostList->data(nRow - 1))
+    app->hostList->remove(nRow);
+}
+
+
+/*
+  add a host new to the config after the last host in its group,
+  or as a new group after the last host
+*/
+static void svConfigWatchAddItem (HostItem * itm)
+{
+  int nSize = app->hostList->size();
+  int nLastHost = 0;
+  int nLastInGroup = 0;
+
+  for (int i = 1; i <= nSize; i ++)
+  {
+    const HostItem * itmRow = static_cast<HostItem *>(app->hostList->data(i));
+
+    if (!itmRow || itmRow->state().isListener)
+      continue;
+
+    nLastHost = i;
+
+    if (itmRow->group == itm->group)
+      nLastInGroup = i;
+  }
+
+  int nRow;
+
+  if (nLastInGroup > 0)
+    nRow = nLastInGroup + 1;
+  else if (nLastHost > 0)
+  {
+    // color 16 (@C16) is supposed to be gray colour
+    app->hostList->insert(nLastHost + 1, "@C16@.· · ·");
+    nRow = nLastHost + 2;
+  }
+  else
+  {
+    // empty row at top of list, with a separator below the new host
+    app->hostList->insert(1, " ");
+    app->hostList->insert(2, "@C16@.· · ·");
+    nRow = 2;
+  }
+
+  app->hostList->insert(nRow, itm->name.c_str(), itm);
+  app->hostList->icon(nRow, app->iconDisconnected);
+
+  svSearchIndexUpdate(itm);
+
+  if (itm->hostType == 'v')
+    svResolverPrewarm(itm->hostAddress);
+}
+
+
+/*
+  diff a reloaded config against the host list by name and group,
+  adding, removing and editing hosts in place; hosts with a live
+  connection or open in an editor keep their settings until it closes
+  (a config with no hosts at all is refused while the list has some,
+  it's much more likely a bad write than every host being deleted)
+  (called on the main thread by Fl::awake)
+*/
+static void svConfigWatchApply (void * data)
+{
+  SVConfigReload * reload = static_cast<SVConfigReload *>(data);
+
+  m_reloadBusy = false;
+
+  if (reload && !app->shuttingDown && app->hostList)
+  {
+    // current hosts by name and group, in list order
+    std::unordered_map<std::string, std::vector<HostItem *>> current;
+    std::vector<HostItem *> unmatched;
+    int nSize = app->hostList->size();
+
+    for (int i = 0; i <= nSize; i ++)
+    {
+      HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
+
+      if (itm && !itm->state().isListener)
+        current[itm->name + '\n' + itm->group].push_back(itm);
+    }
+
+    if (reload->hosts.empty() && !current.empty())
+    {
+      svLogToFile("WARNING - Config file changed but has no hosts, not reloading it");
+
+      // nothing left unmatched, so the list is left as it is
+      current.clear();
+    }
+    else
+      svConfigWatchSetText(reload->strText);
+
+    size_t nAdded = 0;
+    size_t nEdited = 0;
+    size_t nRemoved = 0;
+
+    for (HostItem * itmNew : reload->hosts)
+    {
+      std::vector<HostItem *>& matches = current[itmNew->name + '\n' + itmNew->group];
+
+      // a host the list doesn't have yet
+      if (matches.empty())
+      {
+        svConfigWatchAddItem(itmNew);
+        nAdded ++;
+        continue;
+      }
+
+      HostItem * itm = matches.front();
+      matches.erase(matches.begin());
+
+      // unchanged
+      if (svConfigHostBlock(itm) == svConfigHostBlock(itmNew))
+      {
+        svConfigWatchForget(itm);
+        delete itmNew;
+        continue;
+      }
+
+      nEdited ++;
+
+      if (svConfigWatchMustWait(itm))
+      {
+        svConfigWatchForget(itm);
+        m_pending[itm] = itmNew;
+      }
+      else
+        svConfigWatchApplyEdit(itm, itmNew);
+    }
+
+    reload->hosts.clear();
+
+    // whatever didn't match is gone from the config
+    for (std::pair<const std::string, std::vector<HostItem *>>& entry : current)
+      for (HostItem * itm : entry.second)
+        unmatched.push_back(itm);
+
+    for (HostItem * itm : unmatched)
+    {
+      nRemoved ++;
+
+      if (svConfigWatchMustWait(itm))
+      {
+        svConfigWatchForget(itm);
+        m_pending[itm] = NULL;
+      }
+      else
+        svConfigWatchRemoveItem(itm);
+    }
+
+    if (nAdded > 0 || nEdited > 0 || nRemoved > 0)
+    {
+      svLogToFile("Config file changed - " + std::to_string(nAdded) + " added, " +
+        std::to_string(nEdited) + " changed, " + std::to_string(nRemoved) + " removed");
+
+      // rows may have moved
+      svSearchFilterHostList(true);
+
+      if (app->scanIsRunning)
+        svScanBuildOrder();
+
+      HostItem * itmSel = static_cast<HostItem *>(app->hostList->data(app->hostList->value()));
+
+      if (itmSel)
+        svQuickInfoSetLabelAndText(itmSel);
+      else
+        svQuickInfoSetToEmpty();
+
+      app->hostList->redraw();
+    }
+  }
+
+  if (reload)
+  {
+    for (HostItem * itm : reload->hosts)
+      delete itm;
+
+    delete reload;
+  }
+
+  // the file changed again while we were parsing it
+  if (m_reloadAgain && !app->shuttingDown)
+  {
+    m_reloadAgain = false;
+    Fl::add_timeout(SV_CONFIG_RELOAD_DELAY, svConfigWatchReload);
+  }
+}
+
+
+/*
+  read and parse the config file, skipping text we already have
+  and text that's still being written
+  (this is called as a thread so parsing doesn't stall the ui)
+*/
+static void * svConfigWatchThread (void *)
+{
+  // detach this thread
+  pthread_detach(pthread_self());
+
+  SVConfigReload * reload = new SVConfigReload();
+  std::string strLastRead;
+  bool isSettled = false;
+  bool isNew = false;
+
+  // only trust the file once two reads a settle delay apart match,
+  // a writer that truncates first can be caught half done
+  if (svConfigLoadFile(strLastRead))
+  {
+    for (int i = 0; i < SV_CONFIG_RELOAD_TRIES && !isSettled; i ++)
+    {
+      usleep(static_cast<useconds_t>(SV_CONFIG_RELOAD_DELAY * 1000000));
+
+      if (!svConfigLoadFile(reload->strText))
+        break;
+
+      isSettled = (reload->strText == strLastRead);
+
+      if (!isSettled)
+        strLastRead = reload->strText;
+    }
+
+    if (!isSettled)
+      svLogToFile("WARNING - Config file kept changing or couldn't be read, not reloading it");
+  }
+
+  if (isSettled)
+  {
+    pthread_mutex_lock(&m_knownTextMutex);
+    isNew = (reload->strText != m_knownText);
+    pthread_mutex_unlock(&m_knownTextMutex);
+  }
+
+  if (isNew)
+  {
+    // parsing splits the text in place, so keep the original for next time
+    std::string strConfig = reload->strText;
+
+    svConfigParseHosts(strConfig, reload->hosts);
+  }
+  else
+  {
+    delete reload;
+    reload = NULL;
+  }
+
+  Fl::awake(svConfigWatchApply, reload);
+
+  return SV_RET_VOID;
+}
+
+
+/*
+  start reloading the config file, or note that another
+  reload is needed when one is already running
+  (timer callback)
+*/
+static void svConfigWatchReload (void *)
+{
+  if (app->shuttingDown)
+    return;
+
+  if (m_reloadBusy)
+  {
+    m_reloadAgain = true;
+    return;
+  }
+
+  m_reloadBusy = true;
+
+  pthread_t threadReload;
+
+  if (pthread_create(&threadReload, NULL, svConfigWatchThread, NULL) != 0)
+  {
+    svLogToFile("ERROR - Couldn't create config reload thread");
+    m_reloadBusy = false;
+  }
+}
+
+
+#ifdef __linux__
+/*
+  drain inotify events, and reload shortly after the config file
+  was written or renamed into place
+  (fd callback for the inotify descriptor)
+*/
+static void svConfigWatchEvents (int nFd, void *)
+{
+  char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  const char * strConfigName = fl_filename_name(app->configPathAndFile.c_str());
+  bool isChanged = false;
+  ssize_t nLen;
+
+  while ((nLen = read(nFd, buf, sizeof(buf))) > 0)
+  {
+    for (char * p = buf; p < buf + nLen; )
+    {
+      const struct inotify_event * evt = reinterpret_cast<const struct inotify_event *>(p);
+
+      if (evt->len > 0 && strcmp(evt->name, strConfigName) == 0)
+        isChanged = true;
+
+      p += sizeof(struct inotify_event) + evt->len;
+    }
+  }
+
+  // wait for a burst of writes to settle before reading
+  if (isChanged)
+  {
+    Fl::remove_timeout(svConfigWatchReload);
+    Fl::add_timeout(SV_CONFIG_RELOAD_DELAY, svConfigWatchReload);
+  }
+}
+#endif
+
+
+/*
+  watch the config file's directory so edits made by other programs
+  are picked up without a restart (linux only, uses inotify)
+*/
+bool svConfigWatchStart ()
+{
+  #ifdef __linux__
+  if (m_watchFd >= 0)
+    return true;
+
+  m_watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if (m_watchFd < 0)
+  {
+    svLogToFile("ERROR - Couldn't start watching the config file");
+    return false;
+  }
+
+  // the directory, because saves replace the file by renaming over it
+  if (inotify_add_watch(m_watchFd, app->configPath.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+  {
+    svLogToFile("ERROR - Couldn't watch config directory '" + app->configPath + "'");
+    close(m_watchFd);
+    m_watchFd = -1;
+    return false;
+  }
+
+  Fl::add_fd(m_watchFd, FL_READ, svConfigWatchEvents);
+
+  return true;
+  #else
+  return false;
+  #endif
+}
+
+
+/*  stop watching the config file  */
+void svConfigWatchStop ()
+{
+  Fl::remove_timeout(svConfigWatchReload);
+
+  if (m_watchFd < 0)
+    return;
+
+  Fl::remove_fd(m_watchFd);
+  close(m_watchFd);
+  m_watchFd = -1;
+}
+
+
+/*
+  apply reloaded settings to hosts whose connections or editors have closed
+  (called by svConnectionWatcher and svConfigWatchSetEditing)
+*/
+void svConfigWatchTick ()
+{
+  if (m_pending.empty())
+    return;
+
+  std::vector<std::pair<HostItem *, HostItem *>> due;
+
+  std::unordered_map<HostItem *, HostItem *>::iterator it = m_pending.begin();
+
+  while (it != m_pending.end())
+  {
+    if (svConfigWatchMustWait(it->first))
+    {
+      ++ it;
+      continue;
+    }
+
+    due.push_back(*it);
+    it = m_pending.erase(it);
+  }
+
+  if (due.empty())
+    return;
+
+  for (const std::pair<HostItem *, HostItem *>& entry : due)
+  {
+    if (entry.second)
+      svConfigWatchApplyEdit(entry.first, entry.second);
+    else
+      svConfigWatchRemoveItem(entry.first);
+  }
+
+  svSearchFilterHostList(true);
+
+  if (app->scanIsRunning)
+    svScanBuildOrder();
+
+  app->hostList->redraw();
+}
+
+
+/*
+  true if a reload changed connected itm; itmNew is set to its
+  new settings, or NULL when the config no longer has it
+*/
+bool svConfigWatchPending (HostItem * itm, HostItem ** itmNew)
+{
+  if (m_pending.empty())
+    return false;
+
+  std::unordered_map<HostItem *, HostItem *>::iterator it = m_pending.find(itm);
+
+  if (it == m_pending.end())
+    return false;
+
+  *itmNew = it->second;
+
+  return true;
+}
+
+
+/*
+  note the host open in an editor (NULL once the editor closes,
+  which applies any reload that waited for it)
+*/
+void svConfigWatchSetEditing (HostItem * itm)
+{
+  m_itmEditing = itm;
+
+  if (!itm)
+    svConfigWatchTick();
+}
+
+
+/*  drop any reloaded settings waiting for itm  */
+void svConfigWatchForget (HostItem * itm)
+{
+  std::unordered_map<HostItem *, HostItem *>::iterator it = m_pending.find(itm);
+
+  if (it == m_pending.end())
+    return;
+
+  delete it->second;
+  m_pending.erase(it);
+}
+
+
+/*  drop all waiting reloaded settings (the host list is being rebuilt)  */
+void svConfigWatchClearPending ()
+{
+  for (std::pair<HostItem * const, HostItem *>& entry : m_pending)
+    delete entry.second;
+
+  m_pending.clear();
+}
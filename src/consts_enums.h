@@ -41,8 +41,8 @@
 #define SV_CURRENT_YEAR "2026"
 
 #define SV_CONNECTION_TIMEOUT_SECS  30
+#define SV_CONNECT_STAGGER_MS       250
 #define SV_ONE_SECOND               1.00
-#define SV_MAX_PROP_LINE_LEN        4096
 #define SV_MAX_PROP_LEN             1024
 #define SV_MAX_BUF_LEN              4096
 #define SV_MAX_HOSTLIST_ENTRIES     65000
@@ -56,6 +56,34 @@
 #define SV_APP_FONT_SIZE_MAX        24
 #define SV_LIST_FONT_SIZE_MIN       8
 #define SV_LIST_FONT_SIZE_MAX       24
+#define SV_TCP_KEEPALIVE_COUNT      3
+#define SV_TCP_KEEPALIVE_MAX_SECS   32767
+#define SV_FB_HUGE_PAGE_SIZE        (2 * 1024 * 1024)
+#define SV_FB_POOL_MAX_BUFFERS      8
+#define SV_FB_KEEP_SECS             120
+#define SV_FB_KEEP_MAX_BYTES        (256 * 1024 * 1024)
+#define SV_RECONNECT_BASE_SECS      2
+#define SV_RECONNECT_MAX_SECS       300
+#define SV_RESOLVER_THREADS         4
+#define SV_RESOLVER_TTL_SECS        300
+#define SV_RESOLVER_NEGATIVE_TTL_SECS 30
+#define SV_PROBE_MAX_IN_FLIGHT      256
+#define SV_PROBE_TIMEOUT_SECS       3
+#define SV_PROBE_POLL_MS            100
+#define SV_SCAN_MAX_PREFETCH_MSGS   32
+#define SV_LISTEN_PORT              5500
+#define SV_LISTEN_BACKLOG           128
+#define SV_LISTEN_POLL_MS           250
+#define SV_SSH_STDERR_KEEP          4096
+#define SV_HOST_CACHE_VERSION       2
+#define SV_CONFIG_RELOAD_DELAY      0.5
+#define SV_CONFIG_RELOAD_TRIES      10
+#define SV_SEARCH_BUILD_CHUNK       1000
+#define SV_SEARCH_COMPACT_MIN       1024
+#define SV_DRAW_RETRY_SECS          0.01
+#define SV_HOST_STATE_CHUNK         1024
+#define SV_HOST_STATE_MAX_CHUNKS    1024
+#define SV_HOST_STATE_NONE          UINT32_MAX
 
 // return type for threads
 #define SV_RET_VOID         static_cast<void *>(NULL)
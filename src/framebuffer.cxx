@@ -0,0 +1,262 @@
+/*
+ * framebuffer.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "app.h"
+#include "framebuffer.h"
+#include "hostitem.h"
+#include <deque>
+#include <map>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+/* pool of unused framebuffers, keyed by capacity */
+static std::multimap<size_t, uint8_t *> m_fbPool;
+static pthread_mutex_t m_fbPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* a disconnected host's framebuffer, kept in case it reconnects soon */
+struct SVKeptFrameBuffer
+{
+  HostItem * itm;
+  size_t nBytes;
+  time_t tKept;
+};
+
+/* kept framebuffers, oldest first (main thread only) */
+static std::deque<SVKeptFrameBuffer> m_fbKept;
+static size_t m_fbKeptBytes = 0;
+
+
+/* stop tracking itm's kept framebuffer, if it has one */
+static void svFrameBufferForget (const HostItem * itm)
+{
+  for (std::deque<SVKeptFrameBuffer>::iterator it = m_fbKept.begin(); it != m_fbKept.end(); ++ it)
+  {
+    if (it->itm == itm)
+    {
+      m_fbKeptBytes -= it->nBytes;
+      m_fbKept.erase(it);
+      return;
+    }
+  }
+}
+
+
+/* stop tracking kept framebuffers whose hosts reconnected and use them again */
+static void svFrameBufferDropReconnected ()
+{
+  for (size_t i = 0; i < m_fbKept.size();)
+  {
+    if (m_fbKept[i].itm->state().vnc)
+    {
+      m_fbKeptBytes -= m_fbKept[i].nBytes;
+      m_fbKept.erase(m_fbKept.begin() + i);
+    }
+    else
+      i ++;
+  }
+}
+
+
+/*
+  allocate a framebuffer of (already rounded) size nCapacity
+  large buffers are huge page aligned and advised as such
+*/
+static uint8_t * svFrameBufferAlloc (size_t nCapacity)
+{
+  void * buf = NULL;
+
+  #ifdef _WIN32
+  buf = malloc(nCapacity);
+  #else
+  size_t nAlign = (nCapacity >= SV_FB_HUGE_PAGE_SIZE) ? SV_FB_HUGE_PAGE_SIZE : 64;
+
+  if (posix_memalign(&buf, nAlign, nCapacity) != 0)
+    return NULL;
+
+  // ask for transparent huge pages to cut tlb misses when blitting big desktops
+  #ifdef MADV_HUGEPAGE
+  if (nCapacity >= SV_FB_HUGE_PAGE_SIZE)
+    madvise(buf, nCapacity, MADV_HUGEPAGE);
+  #endif
+  #endif
+
+  return static_cast<uint8_t *>(buf);
+}
+
+
+/*
+  put a framebuffer into the pool, freeing the smallest
+  pooled buffer if the pool is full
+  (pool mutex must be held)
+*/
+static void svFrameBufferPoolPut (uint8_t * buf, size_t nCapacity)
+{
+  if (!buf)
+    return;
+
+  m_fbPool.insert(std::make_pair(nCapacity, buf));
+
+  if (m_fbPool.size() > SV_FB_POOL_MAX_BUFFERS)
+  {
+    free(m_fbPool.begin()->second);
+    m_fbPool.erase(m_fbPool.begin());
+  }
+}
+
+
+/*
+  return a framebuffer of at least nSize bytes for itm
+  the host keeps its current buffer if it still fits, otherwise
+  the buffer goes back to the pool and a pooled or new one is used
+  (called from the rfb thread on connect and the main thread on resize)
+*/
+uint8_t * svFrameBufferAcquire (HostItem * itm, size_t nSize)
+{
+  if (!itm || nSize == 0)
+    return NULL;
+
+  pthread_mutex_lock(&m_fbPoolMutex);
+
+  // reuse the host's own buffer, unless it's wastefully large
+  if (itm->frameBuffer && itm->frameBufferSize >= nSize && itm->frameBufferSize <= nSize * 2)
+  {
+    pthread_mutex_unlock(&m_fbPoolMutex);
+    return itm->frameBuffer;
+  }
+
+  svFrameBufferPoolPut(itm->frameBuffer, itm->frameBufferSize);
+
+  itm->frameBuffer = NULL;
+  itm->frameBufferSize = 0;
+
+  // best fit from the pool
+  std::multimap<size_t, uint8_t *>::iterator it = m_fbPool.lower_bound(nSize);
+
+  if (it != m_fbPool.end() && it->first <= nSize * 2)
+  {
+    itm->frameBuffer = it->second;
+    itm->frameBufferSize = it->first;
+
+    m_fbPool.erase(it);
+  }
+  else
+  {
+    // round up to whole huge pages for large buffers, whole pages otherwise
+    size_t nRound = (nSize >= SV_FB_HUGE_PAGE_SIZE) ? SV_FB_HUGE_PAGE_SIZE : 4096;
+    size_t nCapacity = ((nSize + nRound - 1) / nRound) * nRound;
+
+    itm->frameBuffer = svFrameBufferAlloc(nCapacity);
+
+    if (itm->frameBuffer)
+      itm->frameBufferSize = nCapacity;
+  }
+
+  pthread_mutex_unlock(&m_fbPoolMutex);
+
+  return itm->frameBuffer;
+}
+
+
+/*
+  give itm's framebuffer back to the pool
+  (use when the host item is deleted or won't reconnect)
+*/
+void svFrameBufferRelease (HostItem * itm)
+{
+  if (!itm)
+    return;
+
+  svFrameBufferForget(itm);
+
+  if (!itm->frameBuffer)
+    return;
+
+  pthread_mutex_lock(&m_fbPoolMutex);
+
+  svFrameBufferPoolPut(itm->frameBuffer, itm->frameBufferSize);
+
+  itm->frameBuffer = NULL;
+  itm->frameBufferSize = 0;
+
+  pthread_mutex_unlock(&m_fbPoolMutex);
+}
+
+
+/*
+  keep a disconnected host's framebuffer so a quick reconnect can reuse
+  it, releasing the oldest kept ones past SV_FB_KEEP_MAX_BYTES
+  (main thread)
+*/
+void svFrameBufferKeep (HostItem * itm)
+{
+  if (!itm || !itm->frameBuffer)
+    return;
+
+  // only buffers of hosts that are still disconnected can be released
+  svFrameBufferDropReconnected();
+  svFrameBufferForget(itm);
+
+  SVKeptFrameBuffer kept;
+  kept.itm = itm;
+  kept.nBytes = itm->frameBufferSize;
+  kept.tKept = time(NULL);
+
+  m_fbKept.push_back(kept);
+  m_fbKeptBytes += kept.nBytes;
+
+  while (m_fbKeptBytes > SV_FB_KEEP_MAX_BYTES && !m_fbKept.empty())
+    svFrameBufferRelease(m_fbKept.front().itm);
+}
+
+
+/*
+  release kept framebuffers whose hosts haven't reconnected within
+  SV_FB_KEEP_SECS
+  (called by svConnectionWatcher)
+*/
+void svFrameBufferTick ()
+{
+  if (m_fbKept.empty())
+    return;
+
+  svFrameBufferDropReconnected();
+
+  time_t tNow = time(NULL);
+
+  // oldest first, so stop at the first one still within its grace period
+  while (!m_fbKept.empty() && tNow - m_fbKept.front().tKept >= SV_FB_KEEP_SECS)
+    svFrameBufferRelease(m_fbKept.front().itm);
+}
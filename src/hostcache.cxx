@@ -0,0 +1,426 @@
+/*
+ * hostcache.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "app.h"
+#include "hostcache.h"
+#include "hostitem.h"
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+/*
+  binary snapshot of the parsed host list, laid out as a header,
+  one fixed-size record per host and then every string back to back
+  (machine-local, so native byte order)
+*/
+struct SVHostCacheHeader
+{
+  char strMagic[4];
+  uint32_t nVersion;
+  uint64_t nConfigSize;
+  int64_t nConfigMTime;
+  uint64_t nConfigHash;
+  uint32_t nHosts;
+  uint32_t nStringBytes;
+};
+
+/* the string properties a host saves, in record order */
+static std::string HostConfig::* const m_cacheStrings[] = {
+  &HostConfig::name,
+  &HostConfig::group,
+  &HostConfig::hostAddress,
+  &HostConfig::vncPort,
+  &HostConfig::sshPort,
+  &HostConfig::sshUser,
+  &HostConfig::sshKeyPrivate,
+  &HostConfig::vncPassword,
+  &HostConfig::vncLoginUser,
+  &HostConfig::vncLoginPassword,
+  &HostConfig::f12Macro,
+  &HostConfig::quickNote,
+  &HostConfig::lastConnectedTime,
+  &HostConfig::customCommand1Label,
+  &HostConfig::customCommand1,
+  &HostConfig::customCommand2Label,
+  &HostConfig::customCommand2,
+  &HostConfig::customCommand3Label,
+  &HostConfig::customCommand3
+};
+
+/* the boolean properties a host saves, one bit each in record order */
+static bool HostConfig::* const m_cacheFlags[] = {
+  &HostConfig::scalingFast,
+  &HostConfig::showRemoteCursor,
+  &HostConfig::tcpNoDelay,
+  &HostConfig::tcpKeepAlive,
+  &HostConfig::autoReconnect,
+  &HostConfig::viewOnly,
+  &HostConfig::quickNoteEncoded,
+  &HostConfig::customCommand1Enabled,
+  &HostConfig::customCommand2Enabled,
+  &HostConfig::customCommand3Enabled
+};
+
+#define SV_HOST_CACHE_STRINGS (sizeof(m_cacheStrings) / sizeof(m_cacheStrings[0]))
+#define SV_HOST_CACHE_FLAGS (sizeof(m_cacheFlags) / sizeof(m_cacheFlags[0]))
+
+/* one host's fixed-size record */
+struct SVHostCacheRecord
+{
+  uint32_t nStrOffset[SV_HOST_CACHE_STRINGS];
+  uint32_t nStrLen[SV_HOST_CACHE_STRINGS];
+  uint32_t nFlags;
+  uint16_t keyDelay;
+  uint16_t tcpBufferSize;
+  uint16_t keepAliveIdle;
+  uint16_t keepAliveInterval;
+  char hostType;
+  char scaling;
+  uint8_t compressLevel;
+  uint8_t qualityLevel;
+  uint8_t colorDepth;
+};
+
+
+/*  return the host cache's path, next to the config file  */
+static std::string svHostCachePath ()
+{
+  return app->configPath + "/spiritvnc-fltk.hostcache";
+}
+
+
+/*  64-bit fnv-1a hash of the config file text  */
+static uint64_t svHostCacheHash (const std::string& strData)
+{
+  uint64_t nHash = 14695981039346656037ULL;
+
+  for (const char & c : strData)
+  {
+    nHash ^= static_cast<uint8_t>(c);
+    nHash *= 1099511628211ULL;
+  }
+
+  return nHash;
+}
+
+
+/*  fill in the config file's size and modification time  */
+static bool svHostCacheStatConfig (uint64_t& nSize, int64_t& nMTime)
+{
+  struct stat st;
+
+  if (stat(app->configPathAndFile.c_str(), &st) != 0)
+    return false;
+
+  nSize = static_cast<uint64_t>(st.st_size);
+  nMTime = static_cast<int64_t>(st.st_mtime);
+
+  return true;
+}
+
+
+/*
+  build HostItems from a cache image, if it was made from exactly
+  strConfig (the config file text that was just read)
+*/
+static bool svHostCacheRead (const uint8_t * data, size_t nLen, const std::string& strConfig,
+  std::vector<HostItem *>& hosts)
+{
+  if (nLen < sizeof(SVHostCacheHeader))
+    return false;
+
+  SVHostCacheHeader header;
+  memcpy(&header, data, sizeof(header));
+
+  if (memcmp(header.strMagic, "SVHC", 4) != 0 || header.nVersion != SV_HOST_CACHE_VERSION)
+    return false;
+
+  // the cheap checks first, then the hash
+  uint64_t nSize = 0;
+  int64_t nMTime = 0;
+
+  if (!svHostCacheStatConfig(nSize, nMTime) || header.nConfigSize != nSize ||
+    header.nConfigMTime != nMTime || header.nConfigSize != strConfig.size())
+    return false;
+
+  if (header.nConfigHash != svHostCacheHash(strConfig))
+    return false;
+
+  size_t nRecordBytes = static_cast<size_t>(header.nHosts) * sizeof(SVHostCacheRecord);
+
+  if (header.nHosts > SV_MAX_HOSTLIST_ENTRIES ||
+    nLen != sizeof(SVHostCacheHeader) + nRecordBytes + header.nStringBytes)
+    return false;
+
+  const uint8_t * records = data + sizeof(SVHostCacheHeader);
+  const char * strings = reinterpret_cast<const char *>(records + nRecordBytes);
+
+  hosts.reserve(header.nHosts);
+
+  for (uint32_t i = 0; i < header.nHosts; i ++)
+  {
+    SVHostCacheRecord rec;
+    memcpy(&rec, records + i * sizeof(SVHostCacheRecord), sizeof(rec));
+
+    HostItem * itm = svHostItemNew();
+
+    // no room for every host, so leave it to the parser to stop at the limit
+    if (!itm)
+    {
+      for (HostItem * itmLoaded : hosts)
+        delete itmLoaded;
+
+      hosts.clear();
+
+      return false;
+    }
+
+    for (size_t s = 0; s < SV_HOST_CACHE_STRINGS; s ++)
+    {
+      // a damaged cache just means parsing the text after all
+      if (static_cast<uint64_t>(rec.nStrOffset[s]) + rec.nStrLen[s] > header.nStringBytes)
+      {
+        delete itm;
+
+        for (HostItem * itmLoaded : hosts)
+          delete itmLoaded;
+
+        hosts.clear();
+
+        return false;
+      }
+
+      (itm->*m_cacheStrings[s]).assign(strings + rec.nStrOffset[s], rec.nStrLen[s]);
+    }
+
+    for (size_t f = 0; f < SV_HOST_CACHE_FLAGS; f ++)
+      itm->*m_cacheFlags[f] = (rec.nFlags & (1u << f)) != 0;
+
+    itm->keyDelay = rec.keyDelay;
+    itm->tcpBufferSize = rec.tcpBufferSize;
+    itm->keepAliveIdle = rec.keepAliveIdle;
+    itm->keepAliveInterval = rec.keepAliveInterval;
+    itm->hostType = rec.hostType;
+    itm->scaling = rec.scaling;
+    itm->compressLevel = rec.compressLevel;
+    itm->qualityLevel = rec.qualityLevel;
+    itm->colorDepth = rec.colorDepth;
+
+    hosts.push_back(itm);
+  }
+
+  return true;
+}
+
+
+/*
+  load the host list from the binary cache instead of parsing it,
+  if the cache was made from the config text in strConfig
+  (returns false if the cache is missing or stale)
+*/
+bool svHostCacheLoad (const std::string& strConfig, std::vector<HostItem *>& hosts)
+{
+  std::string strPath = svHostCachePath();
+  bool isLoaded = false;
+
+  #ifdef _WIN32
+  std::ifstream ifs(strPath.c_str(), std::ifstream::in | std::ifstream::binary);
+
+  if (ifs.fail())
+    return false;
+
+  std::vector<char> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+  isLoaded = svHostCacheRead(reinterpret_cast<const uint8_t *>(data.data()), data.size(), strConfig, hosts);
+  #else
+  int nFd = open(strPath.c_str(), O_RDONLY);
+
+  if (nFd < 0)
+    return false;
+
+  struct stat st;
+
+  if (fstat(nFd, &st) != 0 || st.st_size <= 0)
+  {
+    close(nFd);
+    return false;
+  }
+
+  size_t nLen = static_cast<size_t>(st.st_size);
+  void * data = mmap(NULL, nLen, PROT_READ, MAP_PRIVATE, nFd, 0);
+
+  close(nFd);
+
+  if (data == MAP_FAILED)
+    return false;
+
+  isLoaded = svHostCacheRead(static_cast<const uint8_t *>(data), nLen, strConfig, hosts);
+
+  munmap(data, nLen);
+  #endif
+
+  return isLoaded;
+}
+
+
+#ifndef _WIN32
+/*  write all nSize bytes of data to nFd, carrying on after short writes  */
+static bool svHostCacheWriteAll (int nFd, const void * data, size_t nSize)
+{
+  const char * p = static_cast<const char *>(data);
+
+  while (nSize > 0)
+  {
+    ssize_t nWritten = write(nFd, p, nSize);
+
+    if (nWritten < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      return false;
+    }
+
+    p += nWritten;
+    nSize -= nWritten;
+  }
+
+  return true;
+}
+#endif
+
+
+/*
+  write the binary cache for hosts, stamped with the config file
+  text in strConfig so a later edit of the text makes it stale
+*/
+void svHostCacheSave (const std::string& strConfig, const std::vector<HostItem *>& hosts)
+{
+  SVHostCacheHeader header;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.strMagic, "SVHC", 4);
+  header.nVersion = SV_HOST_CACHE_VERSION;
+
+  if (!svHostCacheStatConfig(header.nConfigSize, header.nConfigMTime) ||
+    header.nConfigSize != strConfig.size())
+    return;
+
+  header.nConfigHash = svHostCacheHash(strConfig);
+  header.nHosts = static_cast<uint32_t>(hosts.size());
+
+  std::vector<SVHostCacheRecord> records(hosts.size());
+  std::string strStrings;
+
+  for (size_t i = 0; i < hosts.size(); i ++)
+  {
+    const HostItem * itm = hosts[i];
+    SVHostCacheRecord& rec = records[i];
+
+    memset(&rec, 0, sizeof(rec));
+
+    for (size_t s = 0; s < SV_HOST_CACHE_STRINGS; s ++)
+    {
+      const std::string& str = itm->*m_cacheStrings[s];
+
+      rec.nStrOffset[s] = static_cast<uint32_t>(strStrings.size());
+      rec.nStrLen[s] = static_cast<uint32_t>(str.size());
+
+      strStrings += str;
+    }
+
+    for (size_t f = 0; f < SV_HOST_CACHE_FLAGS; f ++)
+      if (itm->*m_cacheFlags[f])
+        rec.nFlags |= (1u << f);
+
+    rec.keyDelay = itm->keyDelay;
+    rec.tcpBufferSize = itm->tcpBufferSize;
+    rec.keepAliveIdle = itm->keepAliveIdle;
+    rec.keepAliveInterval = itm->keepAliveInterval;
+    rec.hostType = itm->hostType;
+    rec.scaling = itm->scaling;
+    rec.compressLevel = itm->compressLevel;
+    rec.qualityLevel = itm->qualityLevel;
+    rec.colorDepth = itm->colorDepth;
+  }
+
+  header.nStringBytes = static_cast<uint32_t>(strStrings.size());
+
+  // written beside the real cache and renamed over it, so readers never see half of one
+  std::string strPath = svHostCachePath();
+  std::string strTemp = strPath + ".tmp";
+
+  #ifdef _WIN32
+  std::ofstream ofs(strTemp.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+
+  if (ofs.fail())
+    return;
+
+  ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  if (!records.empty())
+    ofs.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(SVHostCacheRecord));
+
+  ofs.write(strStrings.data(), strStrings.size());
+  ofs.close();
+
+  if (ofs.fail())
+  {
+    remove(strTemp.c_str());
+    return;
+  }
+
+  MoveFileExA(strTemp.c_str(), strPath.c_str(), MOVEFILE_REPLACE_EXISTING);
+  #else
+  // the cache holds the same passwords as the config file, so only we can read it
+  int nFd = open(strTemp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+  if (nFd < 0)
+    return;
+
+  bool isOkay = svHostCacheWriteAll(nFd, &header, sizeof(header)) &&
+    svHostCacheWriteAll(nFd, records.data(), records.size() * sizeof(SVHostCacheRecord)) &&
+    svHostCacheWriteAll(nFd, strStrings.data(), strStrings.size());
+
+  if (close(nFd) != 0)
+    isOkay = false;
+
+  if (!isOkay || rename(strTemp.c_str(), strPath.c_str()) != 0)
+    remove(strTemp.c_str());
+  #endif
+}
@@ -39,15 +39,16 @@
 #include <iostream>
 #include "vnc.h"
 #include "consts_enums.h"
+#include "hoststate.h"
 
-// forward declaration of VncObject
-class VncObject;
-
-/* host item class */
-class HostItem
+/*
+  per-connection settings, exactly what the config file
+  saves for a host (copying one copies all of them)
+*/
+class HostConfig
 {
 public:
-  HostItem () :
+  HostConfig () :
     name(""),
     group(""),
     hostAddress(""),
@@ -56,40 +57,29 @@ public:
     sshUser(""),
     //sshPass(""),
     sshKeyPrivate(""),
-    sshLocalPort(0),
     vncPassword(""),
     vncLoginUser(""),
     vncLoginPassword(""),
     hostType('v'),
-    vnc(NULL),
-    threadRFB(0),
-    threadRFBRunning(false),
-    sshReady(false),
-    vncAddressAndPort(""),
     f12Macro(""),
+    keyDelay(0),
     scaling('f'),
     scalingFast(false),
     showRemoteCursor(false),
     compressLevel(5),
     qualityLevel(5),
+    colorDepth(24),
+    tcpNoDelay(true),
+    tcpBufferSize(0),
+    tcpKeepAlive(true),
+    keepAliveIdle(60),
+    keepAliveInterval(10),
+    autoReconnect(false),
     //ignoreInactive(false),
     //centerX(false),
     //centerY(false),
-    isListener(false),
-    isConnecting(false),
-    isConnected(false),
-    isWaitingForShow(false),
-    hasCouldntConnect(false),
-    hasError(false),
-    hasDisconnectRequest(false),
-    vncNeedsCleanup(false),
-    initOkay(false),
-    icon(NULL),
-    lastErrorMessage(""),
-    sshWaitTime(5),
-    sshCmdStream(NULL),
-    sshCloseThread(0),
     quickNote(""),
+    quickNoteEncoded(false),
     lastConnectedTime(""),
     viewOnly(false),
     customCommand1Enabled(false),
@@ -100,8 +90,7 @@ public:
     customCommand2(""),
     customCommand3Enabled(false),
     customCommand3Label("Command 3"),
-    customCommand3(""),
-    clipboard("")
+    customCommand3("")
   {}
 
   std::string name;
@@ -112,41 +101,29 @@ public:
   std::string sshUser;
   //std::string sshPass;
   std::string sshKeyPrivate;
-  int sshLocalPort;
   std::string vncPassword;
   std::string vncLoginUser;
   std::string vncLoginPassword;
   char hostType;
-  VncObject * vnc;
-  pthread_t threadRFB;
-  bool threadRFBRunning;
-  bool sshReady;
-  std::string vncAddressAndPort;
   std::string f12Macro;
+  uint16_t keyDelay;
   char scaling;
   bool scalingFast;
   bool showRemoteCursor;
   uint8_t compressLevel;
   uint8_t qualityLevel;
+  uint8_t colorDepth;
+  bool tcpNoDelay;
+  uint16_t tcpBufferSize;
+  bool tcpKeepAlive;
+  uint16_t keepAliveIdle;
+  uint16_t keepAliveInterval;
+  bool autoReconnect;
   //bool ignoreInactive;
   //bool centerX;
   //bool centerY;
-  //
-  bool isListener;
-  bool isConnecting;
-  bool isConnected;
-  bool isWaitingForShow;
-  bool hasCouldntConnect;
-  bool hasError;
-  bool hasDisconnectRequest;
-  bool vncNeedsCleanup;
-  bool initOkay;
-  Fl_Image * icon;
-  std::string lastErrorMessage;
-  uint16_t sshWaitTime;
-  FILE * sshCmdStream;
-  pthread_t sshCloseThread;
   std::string quickNote;
+  bool quickNoteEncoded;
   std::string lastConnectedTime;
   bool viewOnly;
   bool customCommand1Enabled;
@@ -158,7 +135,75 @@ public:
   bool customCommand3Enabled;
   std::string customCommand3Label;
   std::string customCommand3;
+};
+
+
+/*
+  host item class
+  (its runtime state is in the host state table, under stateId;
+  make them with svHostItemNew, which checks there was room for it)
+*/
+class HostItem : public HostConfig
+{
+public:
+  HostItem () :
+    stateId(svHostStateNew()),
+    sshLocalPort(0),
+    sshLocalSocket(""),
+    vncAddressAndPort(""),
+    frameBuffer(NULL),
+    frameBufferSize(0),
+    suspendedWidth(0),
+    suspendedHeight(0),
+    lastErrorMessage(""),
+    sshWaitTime(5),
+    sshCmdStream(NULL),
+    sshPid(0),
+    sshCloseThread(0),
+    sshMasterId(0),
+    sshMultiplexed(false),
+    configBlock(""),
+    configDirty(true),
+    clipboard("")
+  {
+    if (stateId != SV_HOST_STATE_NONE)
+      svHostState(stateId).itm = this;
+  }
+
+  ~HostItem ()
+  {
+    if (stateId != SV_HOST_STATE_NONE)
+      svHostStateDelete(stateId);
+  }
+
+  // each item owns its state id, so items aren't copied
+  HostItem (const HostItem&) = delete;
+  HostItem& operator= (const HostItem&) = delete;
+
+  HostState& state () { return svHostState(stateId); }
+  const HostState& state () const { return svHostState(stateId); }
+
+  const uint32_t stateId;
+  int sshLocalPort;
+  std::string sshLocalSocket;
+  std::string vncAddressAndPort;
+  uint8_t * frameBuffer;
+  size_t frameBufferSize;
+  std::vector<uint8_t> suspendedFrame;
+  int suspendedWidth;
+  int suspendedHeight;
+  std::string lastErrorMessage;
+  uint16_t sshWaitTime;
+  FILE * sshCmdStream;
+  pid_t sshPid;
+  pthread_t sshCloseThread;
+  unsigned int sshMasterId;
+  bool sshMultiplexed;
+  std::string configBlock;
+  bool configDirty;
   std::string clipboard;
 };
 
+HostItem * svHostItemNew ();
+
 #endif
@@ -0,0 +1,141 @@
+/*
+ * hoststate.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "app.h"
+#include "hostitem.h"
+#include <vector>
+
+HostState * hostStateChunks[SV_HOST_STATE_MAX_CHUNKS] = {};
+
+// hosts are created by the config reload thread too
+static pthread_mutex_t m_hostStateMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// ids of deleted hosts, handed out again before new ones
+static std::vector<uint32_t> m_hostStateFree;
+
+// one past the highest id handed out so far
+static uint32_t m_nHostStateEnd = 0;
+
+// the table ran out, so it's only logged once until an id comes back
+static bool m_hostStateFull = false;
+
+
+/*
+  give a new host a fresh state, returning its id
+  (SV_HOST_STATE_NONE when the table is full)
+*/
+uint32_t svHostStateNew ()
+{
+  uint32_t nId;
+  bool isNewlyFull = false;
+
+  pthread_mutex_lock(&m_hostStateMutex);
+
+  if (!m_hostStateFree.empty())
+  {
+    nId = m_hostStateFree.back();
+    m_hostStateFree.pop_back();
+  }
+  else
+  {
+    nId = m_nHostStateEnd;
+
+    // far more hosts than SV_MAX_HOSTLIST_ENTRIES are alive at once
+    if (nId / SV_HOST_STATE_CHUNK >= SV_HOST_STATE_MAX_CHUNKS)
+    {
+      isNewlyFull = !m_hostStateFull;
+      m_hostStateFull = true;
+      nId = SV_HOST_STATE_NONE;
+    }
+    else
+    {
+      if (nId % SV_HOST_STATE_CHUNK == 0)
+        hostStateChunks[nId / SV_HOST_STATE_CHUNK] = new HostState[SV_HOST_STATE_CHUNK];
+
+      m_nHostStateEnd ++;
+    }
+  }
+
+  pthread_mutex_unlock(&m_hostStateMutex);
+
+  if (isNewlyFull)
+    svLogToFile("ERROR - Too many hosts at once, no more can be added");
+
+  return nId;
+}
+
+
+/*  give back the state of a host that's being deleted  */
+void svHostStateDelete (uint32_t nId)
+{
+  // so going through the table never finds a stale viewer
+  svHostState(nId) = HostState();
+
+  pthread_mutex_lock(&m_hostStateMutex);
+  m_hostStateFree.push_back(nId);
+  m_hostStateFull = false;
+  pthread_mutex_unlock(&m_hostStateMutex);
+}
+
+
+/*
+  one past the highest id handed out so far, for going through the
+  whole table (deleted hosts' states are in there too)
+*/
+uint32_t svHostStateEnd ()
+{
+  pthread_mutex_lock(&m_hostStateMutex);
+  uint32_t nEnd = m_nHostStateEnd;
+  pthread_mutex_unlock(&m_hostStateMutex);
+
+  return nEnd;
+}
+
+
+/*
+  make a new host item, or return NULL when there's no
+  room left in the host state table for it
+*/
+HostItem * svHostItemNew ()
+{
+  HostItem * itm = new HostItem();
+
+  if (itm->stateId == SV_HOST_STATE_NONE)
+  {
+    delete itm;
+    return NULL;
+  }
+
+  return itm;
+}
@@ -0,0 +1,126 @@
+/*
+ * hoststate.h - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef HOSTSTATE_H
+#define HOSTSTATE_H
+
+#include <FL/Fl_Image.H>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include "consts_enums.h"
+
+// forward declarations
+class HostItem;
+class VncObject;
+
+/*
+  per-connection runtime state read on every watcher tick and scan step
+  (these live in the host state table rather than in each HostItem, so
+  going through them by id doesn't pull in the items' settings strings;
+  itm points back at the host, NULL for an unused entry)
+*/
+class HostState
+{
+public:
+  HostState () :
+    itm(NULL),
+    vnc(NULL),
+    icon(NULL),
+    threadRFB(0),
+    reconnectTime(0),
+    lastActivityTime(0),
+    activeIndex(-1),
+    listenSock(-1),
+    reconnectAttempts(0),
+    isConnecting(false),
+    isConnected(false),
+    isWaitingForShow(false),
+    hasCouldntConnect(false),
+    hasError(false),
+    hasDisconnectRequest(false),
+    vncNeedsCleanup(false),
+    initOkay(false),
+    isListener(false),
+    isReconnecting(false),
+    isSuspended(false),
+    threadRFBRunning(false),
+    sshReady(false),
+    hasSuspendedFrame(false)
+  {}
+
+  HostItem * itm;
+  VncObject * vnc;
+  Fl_Image * icon;
+  pthread_t threadRFB;
+  time_t reconnectTime;
+  time_t lastActivityTime;
+  int activeIndex;
+  int listenSock;
+  uint16_t reconnectAttempts;
+  bool isConnecting;
+  bool isConnected;
+  bool isWaitingForShow;
+  bool hasCouldntConnect;
+  bool hasError;
+  bool hasDisconnectRequest;
+  bool vncNeedsCleanup;
+  bool initOkay;
+  bool isListener;
+  bool isReconnecting;
+  bool isSuspended;
+  bool threadRFBRunning;
+  bool sshReady;
+  bool hasSuspendedFrame;
+};
+
+/*
+  the host state table, in fixed chunks of SV_HOST_STATE_CHUNK states
+  (chunks are never moved or freed, so a state stays put while its
+  host's threads are using it)
+*/
+extern HostState * hostStateChunks[SV_HOST_STATE_MAX_CHUNKS];
+
+uint32_t svHostStateNew ();
+void svHostStateDelete (uint32_t);
+uint32_t svHostStateEnd ();
+
+
+/*  the state with id nId  */
+inline HostState& svHostState (uint32_t nId)
+{
+  return hostStateChunks[nId / SV_HOST_STATE_CHUNK][nId % SV_HOST_STATE_CHUNK];
+}
+
+#endif
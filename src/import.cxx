@@ -0,0 +1,817 @@
+/*
+ * import.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "app.h"
+#include "hostitem.h"
+#include "import.h"
+#include <algorithm>
+#include <sstream>
+#include <unordered_set>
+
+/* what an import did, for the summary message */
+struct SVImportStats
+{
+  size_t nAdded;
+  size_t nDuplicates;
+  size_t nOverLimit;
+  size_t nInvalid;
+  size_t nLine;
+  std::string strBadLines;
+};
+
+/* inventory column names that aren't config property names */
+struct SVImportAlias
+{
+  const char * strAlias;
+  const char * strProp;
+};
+
+static const SVImportAlias m_importAliases[] = {
+  {"address",     "hostaddress"},
+  {"displayname", "name"},
+  {"host",        "hostaddress"},
+  {"hostname",    "hostaddress"},
+  {"ip",          "hostaddress"},
+  {"label",       "name"},
+  {"note",        "quicknote"},
+  {"notes",       "quicknote"},
+  {"password",    "vncpass"},
+  {"port",        "vncport"},
+  {"title",       "name"}
+};
+
+
+/*
+  turn an inventory column name into the config property it sets
+  ('VNC Port', 'vnc_port' and 'vncport' are all 'vncport')
+*/
+static std::string svImportPropName (const std::string& strColumn)
+{
+  std::string strProp;
+
+  for (char c : strColumn)
+  {
+    if (c == ' ' || c == '_' || c == '-' || c == '"')
+      continue;
+
+    strProp += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  }
+
+  for (const SVImportAlias & alias : m_importAliases)
+    if (strProp == alias.strAlias)
+      return alias.strProp;
+
+  return strProp;
+}
+
+
+/*  trim spaces and tabs from both ends of strIn  */
+static std::string svImportTrim (const std::string& strIn)
+{
+  size_t nStart = strIn.find_first_not_of(" \t");
+
+  if (nStart == std::string::npos)
+    return "";
+
+  size_t nEnd = strIn.find_last_not_of(" \t");
+
+  return strIn.substr(nStart, nEnd - nStart + 1);
+}
+
+
+/*  true if strPort is a port number from 1 to 65535  */
+static bool svImportValidPort (const std::string& strPort)
+{
+  if (strPort.empty() || strPort.size() > 5)
+    return false;
+
+  for (char c : strPort)
+    if (c < '0' || c > '9')
+      return false;
+
+  int nPort = atoi(strPort.c_str());
+
+  return nPort >= 1 && nPort <= 65535;
+}
+
+
+/*  set one inventory value on itm, returning false for unknown columns  */
+static bool svImportSetProperty (HostItem * itm, const std::string& strProp, const std::string& strVal)
+{
+  if (strProp == "name")
+    itm->name = strVal;
+  else if (strProp == "quicknote")
+    // inventories carry plain text, the config file carries base64
+    itm->quickNote = strVal;
+  else if (strProp == "vncpass")
+    itm->vncPassword = base64Encode(reinterpret_cast<const unsigned char *>(strVal.c_str()), strVal.size());
+  else if (strProp == "vncloginpass")
+    itm->vncLoginPassword = base64Encode(reinterpret_cast<const unsigned char *>(strVal.c_str()),
+      strVal.size());
+  else
+    return svConfigSetHostProperty(itm, strProp.c_str(), strVal.c_str());
+
+  return true;
+}
+
+
+/*  note a row that couldn't be imported  */
+static void svImportBadRow (SVImportStats& stats)
+{
+  stats.nInvalid ++;
+
+  // only list the first few
+  if (stats.nInvalid <= 10)
+  {
+    if (!stats.strBadLines.empty())
+      stats.strBadLines += ", ";
+
+    stats.strBadLines += std::to_string(stats.nLine);
+  }
+}
+
+
+/*
+  check a freshly filled itm and keep it unless it's invalid or
+  already in the list by name or by address and vnc port
+*/
+static void svImportFinishRow (HostItem * itm, std::vector<HostItem *>& imported, SVImportStats& stats,
+  std::unordered_set<std::string>& names, std::unordered_set<std::string>& addresses)
+{
+  itm->hostAddress = svImportTrim(itm->hostAddress);
+  itm->vncPort = svImportTrim(itm->vncPort);
+  itm->sshPort = svImportTrim(itm->sshPort);
+
+  if (itm->name.empty())
+    itm->name = itm->hostAddress;
+
+  if (itm->vncPort.empty())
+    itm->vncPort = "5900";
+
+  if (itm->hostType == 's' && itm->sshPort.empty())
+    itm->sshPort = "22";
+
+  if (itm->hostAddress.empty() || !svImportValidPort(itm->vncPort) ||
+    (!itm->sshPort.empty() && !svImportValidPort(itm->sshPort)))
+  {
+    delete itm;
+    svImportBadRow(stats);
+    return;
+  }
+
+  std::string strAddress = itm->hostAddress + ':' + itm->vncPort;
+
+  for (char& c : strAddress)
+    c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+
+  if (names.count(itm->name) > 0 || addresses.count(strAddress) > 0)
+  {
+    delete itm;
+    stats.nDuplicates ++;
+    return;
+  }
+
+  if (app->hostList->size() + imported.size() >= SV_MAX_HOSTLIST_ENTRIES)
+  {
+    delete itm;
+    stats.nOverLimit ++;
+    return;
+  }
+
+  names.insert(itm->name);
+  addresses.insert(strAddress);
+  imported.push_back(itm);
+  stats.nAdded ++;
+}
+
+
+/*
+  a new itm with the same defaults as the connection editor
+  (NULL when there's no room for another host)
+*/
+static HostItem * svImportNewItem ()
+{
+  HostItem * itm = svHostItemNew();
+
+  if (!itm)
+    return NULL;
+
+  itm->scaling = 'f';
+  itm->showRemoteCursor = true;
+  itm->compressLevel = 5;
+  itm->qualityLevel = 5;
+
+  return itm;
+}
+
+
+/*
+  split one csv record into fields, reading more lines from ifs
+  when a quoted field runs over a line break
+*/
+static bool svImportReadCSVRecord (std::ifstream& ifs, char cDelim, std::vector<std::string>& fields,
+  SVImportStats& stats)
+{
+  std::string strLine;
+
+  fields.clear();
+
+  if (!std::getline(ifs, strLine))
+    return false;
+
+  stats.nLine ++;
+
+  std::string strField;
+  bool inQuotes = false;
+  size_t i = 0;
+
+  while (true)
+  {
+    if (i >= strLine.size())
+    {
+      // a quoted field with a line break in it
+      if (inQuotes && std::getline(ifs, strLine))
+      {
+        stats.nLine ++;
+        strField += '\n';
+        i = 0;
+        continue;
+      }
+
+      break;
+    }
+
+    char c = strLine[i ++];
+
+    if (inQuotes)
+    {
+      if (c == '"')
+      {
+        if (i < strLine.size() && strLine[i] == '"')
+        {
+          strField += '"';
+          i ++;
+        }
+        else
+          inQuotes = false;
+      }
+      else
+        strField += c;
+    }
+    else if (c == '"')
+      inQuotes = true;
+    else if (c == cDelim)
+    {
+      fields.push_back(strField);
+      strField.clear();
+    }
+    else if (c != '\r')
+      strField += c;
+  }
+
+  fields.push_back(strField);
+
+  return true;
+}
+
+
+/*  import a csv inventory whose first row names the columns  */
+static void svImportCSV (std::ifstream& ifs, std::vector<HostItem *>& imported, SVImportStats& stats,
+  std::unordered_set<std::string>& names, std::unordered_set<std::string>& addresses)
+{
+  std::vector<std::string> fields;
+  std::vector<std::string> props;
+
+  // use whichever common delimiter the header row has the most of
+  std::string strHeader;
+
+  if (!std::getline(ifs, strHeader))
+    return;
+
+  stats.nLine ++;
+
+  char cDelim = ',';
+  size_t nMost = std::count(strHeader.begin(), strHeader.end(), ',');
+
+  for (char c : {';', '\t'})
+  {
+    size_t nCount = std::count(strHeader.begin(), strHeader.end(), c);
+
+    if (nCount > nMost)
+    {
+      nMost = nCount;
+      cDelim = c;
+    }
+  }
+
+  // strip a utf-8 byte order mark
+  if (strHeader.compare(0, 3, "\xEF\xBB\xBF") == 0)
+    strHeader.erase(0, 3);
+
+  std::istringstream issHeader(strHeader);
+  std::string strColumn;
+
+  while (std::getline(issHeader, strColumn, cDelim))
+    props.push_back(svImportPropName(svImportTrim(strColumn)));
+
+  while (svImportReadCSVRecord(ifs, cDelim, fields, stats))
+  {
+    // skip blank lines
+    if (fields.size() == 1 && svImportTrim(fields[0]).empty())
+      continue;
+
+    HostItem * itm = svImportNewItem();
+
+    if (!itm)
+    {
+      stats.nOverLimit ++;
+      continue;
+    }
+
+    for (size_t i = 0; i < fields.size() && i < props.size(); i ++)
+      if (!props[i].empty())
+        svImportSetProperty(itm, props[i], fields[i]);
+
+    svImportFinishRow(itm, imported, stats, names, addresses);
+  }
+}
+
+
+/*  append code point nCode to strOut as utf-8  */
+static void svImportAppendUTF8 (std::string& strOut, unsigned long nCode)
+{
+  if (nCode < 0x80)
+    strOut += static_cast<char>(nCode);
+  else if (nCode < 0x800)
+  {
+    strOut += static_cast<char>(0xC0 | (nCode >> 6));
+    strOut += static_cast<char>(0x80 | (nCode & 0x3F));
+  }
+  else if (nCode < 0x10000)
+  {
+    strOut += static_cast<char>(0xE0 | (nCode >> 12));
+    strOut += static_cast<char>(0x80 | ((nCode >> 6) & 0x3F));
+    strOut += static_cast<char>(0x80 | (nCode & 0x3F));
+  }
+  else
+  {
+    strOut += static_cast<char>(0xF0 | (nCode >> 18));
+    strOut += static_cast<char>(0x80 | ((nCode >> 12) & 0x3F));
+    strOut += static_cast<char>(0x80 | ((nCode >> 6) & 0x3F));
+    strOut += static_cast<char>(0x80 | (nCode & 0x3F));
+  }
+}
+
+
+/*  parse the json string starting at p (just past its opening quote)  */
+static bool svImportJSONString (const char *& p, const char * pEnd, std::string& strOut)
+{
+  strOut.clear();
+
+  while (p < pEnd)
+  {
+    char c = *p ++;
+
+    if (c == '"')
+      return true;
+
+    if (c != '\\')
+    {
+      strOut += c;
+      continue;
+    }
+
+    if (p >= pEnd)
+      return false;
+
+    c = *p ++;
+
+    switch (c)
+    {
+      case 'b':
+        strOut += '\b';
+        break;
+
+      case 'f':
+        strOut += '\f';
+        break;
+
+      case 'n':
+        strOut += '\n';
+        break;
+
+      case 'r':
+        strOut += '\r';
+        break;
+
+      case 't':
+        strOut += '\t';
+        break;
+
+      case 'u':
+      {
+        if (pEnd - p < 4)
+          return false;
+
+        unsigned long nCode = strtoul(std::string(p, 4).c_str(), NULL, 16);
+        p += 4;
+
+        // surrogate pair
+        if (nCode >= 0xD800 && nCode <= 0xDBFF && pEnd - p >= 6 && p[0] == '\\' && p[1] == 'u')
+        {
+          unsigned long nLow = strtoul(std::string(p + 2, 4).c_str(), NULL, 16);
+
+          if (nLow >= 0xDC00 && nLow <= 0xDFFF)
+          {
+            nCode = 0x10000 + ((nCode - 0xD800) << 10) + (nLow - 0xDC00);
+            p += 6;
+          }
+        }
+
+        svImportAppendUTF8(strOut, nCode);
+        break;
+      }
+
+      default:
+        // \" \\ \/
+        strOut += c;
+        break;
+    }
+  }
+
+  return false;
+}
+
+
+/*
+  fill itm from one json-lines object of flat keys and values
+  (nested objects and arrays make the row invalid)
+*/
+static bool svImportJSONObject (const std::string& strLine, HostItem * itm)
+{
+  const char * p = strLine.c_str();
+  const char * pEnd = p + strLine.size();
+  std::string strKey;
+  std::string strVal;
+
+  while (p < pEnd && isspace(static_cast<unsigned char>(*p)))
+    p ++;
+
+  if (p >= pEnd || *p ++ != '{')
+    return false;
+
+  while (true)
+  {
+    while (p < pEnd && isspace(static_cast<unsigned char>(*p)))
+      p ++;
+
+    if (p >= pEnd)
+      return false;
+
+    if (*p == '}')
+      return true;
+
+    if (*p ++ != '"' || !svImportJSONString(p, pEnd, strKey))
+      return false;
+
+    while (p < pEnd && isspace(static_cast<unsigned char>(*p)))
+      p ++;
+
+    if (p >= pEnd || *p ++ != ':')
+      return false;
+
+    while (p < pEnd && isspace(static_cast<unsigned char>(*p)))
+      p ++;
+
+    if (p >= pEnd)
+      return false;
+
+    bool isNull = false;
+
+    if (*p == '"')
+    {
+      p ++;
+
+      if (!svImportJSONString(p, pEnd, strVal))
+        return false;
+    }
+    else if (*p == '{' || *p == '[')
+      return false;
+    else
+    {
+      // numbers, true and false are used as written
+      const char * pStart = p;
+
+      while (p < pEnd && *p != ',' && *p != '}' && !isspace(static_cast<unsigned char>(*p)))
+        p ++;
+
+      strVal.assign(pStart, p - pStart);
+      isNull = (strVal == "null");
+    }
+
+    if (!isNull)
+      svImportSetProperty(itm, svImportPropName(strKey), strVal);
+
+    while (p < pEnd && isspace(static_cast<unsigned char>(*p)))
+      p ++;
+
+    if (p < pEnd && *p == ',')
+      p ++;
+  }
+}
+
+
+/*  import a json-lines inventory, one object per line  */
+static void svImportJSONLines (std::ifstream& ifs, std::vector<HostItem *>& imported, SVImportStats& stats,
+  std::unordered_set<std::string>& names, std::unordered_set<std::string>& addresses)
+{
+  std::string strLine;
+
+  while (std::getline(ifs, strLine))
+  {
+    stats.nLine ++;
+
+    if (svImportTrim(strLine).empty() || strLine == "\r")
+      continue;
+
+    HostItem * itm = svImportNewItem();
+
+    if (!itm)
+    {
+      stats.nOverLimit ++;
+      continue;
+    }
+
+    if (!svImportJSONObject(strLine, itm))
+    {
+      delete itm;
+      svImportBadRow(stats);
+      continue;
+    }
+
+    svImportFinishRow(itm, imported, stats, names, addresses);
+  }
+}
+
+
+/*
+  rebuild the host list once with the imported hosts after the last
+  host of their group, or in new groups after the last host
+*/
+static void svImportRebuildHostList (const std::vector<HostItem *>& imported)
+{
+  std::vector<HostItem *> current;
+  std::vector<HostItem *> listeners;
+  int nSize = app->hostList->size();
+
+  for (int i = 0; i <= nSize; i ++)
+  {
+    HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
+
+    if (!itm)
+      continue;
+
+    if (itm->state().isListener)
+      listeners.push_back(itm);
+    else
+      current.push_back(itm);
+  }
+
+  // imported hosts by group, in file order
+  std::unordered_map<std::string, std::vector<HostItem *>> byGroup;
+  std::vector<std::string> groupOrder;
+
+  for (HostItem * itm : imported)
+  {
+    std::vector<HostItem *>& group = byGroup[itm->group];
+
+    if (group.empty())
+      groupOrder.push_back(itm->group);
+
+    group.push_back(itm);
+  }
+
+  // merge them in, each group's imports at the end of that group
+  std::vector<HostItem *> hosts;
+
+  hosts.reserve(current.size() + imported.size());
+
+  for (size_t i = 0; i < current.size(); i ++)
+  {
+    hosts.push_back(current[i]);
+
+    if (i + 1 < current.size() && current[i + 1]->group == current[i]->group)
+      continue;
+
+    std::unordered_map<std::string, std::vector<HostItem *>>::iterator it = byGroup.find(current[i]->group);
+
+    if (it != byGroup.end())
+    {
+      hosts.insert(hosts.end(), it->second.begin(), it->second.end());
+      byGroup.erase(it);
+    }
+  }
+
+  // groups the list didn't have
+  for (const std::string& strGroup : groupOrder)
+  {
+    std::unordered_map<std::string, std::vector<HostItem *>>::iterator it = byGroup.find(strGroup);
+
+    if (it != byGroup.end())
+      hosts.insert(hosts.end(), it->second.begin(), it->second.end());
+  }
+
+  const HostItem * itmSelected = static_cast<HostItem *>(app->hostList->data(app->hostList->value()));
+  std::string strLastGroup;
+  bool addSep = false;
+
+  app->hostList->clear();
+
+  for (HostItem * itm : hosts)
+  {
+    if (strLastGroup != itm->group)
+    {
+      if (addSep)
+        // add a separator
+        // color 16 (@C16) is supposed to be gray colour
+        app->hostList->add("@C16@.· · ·");
+      else
+      {
+        // add empty row at top of list
+        app->hostList->add(" ");
+        addSep = true;
+      }
+    }
+
+    strLastGroup = itm->group;
+
+    app->hostList->add(itm->name.c_str(), itm);
+    app->hostList->icon(app->hostList->size(), itm->state().icon ? itm->state().icon : app->iconDisconnected);
+  }
+
+  // add a separator
+  if (addSep)
+    // color 16 (@C16.) is supposed to be gray
+    app->hostList->add("@C16@.· · ·");
+
+  for (HostItem * itm : listeners)
+  {
+    app->hostList->add(itm->name.c_str(), itm);
+    app->hostList->icon(app->hostList->size(), itm->state().icon ? itm->state().icon : app->iconDisconnected);
+  }
+
+  int nSelected = app->hostList->itemRow(itmSelected);
+
+  if (nSelected > 0)
+    app->hostList->select(nSelected);
+}
+
+
+/*
+  import hosts from a csv or json-lines inventory, streaming it a record
+  at a time, then add them all with one list rebuild and config write
+*/
+void svImportHosts (const std::string& strFile)
+{
+  std::ifstream ifs(strFile.c_str(), std::ifstream::in | std::ifstream::binary);
+
+  if (ifs.fail())
+  {
+    svMessageWindow("Error: Could not open '" + strFile + "'", "SpiritVNC - Import");
+    return;
+  }
+
+  SVImportStats stats = {0, 0, 0, 0, 0, ""};
+  std::vector<HostItem *> imported;
+  std::unordered_set<std::string> names;
+  std::unordered_set<std::string> addresses;
+
+  // dedupe against what the list already has
+  int nSize = app->hostList->size();
+
+  for (int i = 0; i <= nSize; i ++)
+  {
+    const HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
+
+    if (!itm || itm->state().isListener)
+      continue;
+
+    std::string strAddress = itm->hostAddress + ':' + itm->vncPort;
+
+    for (char& c : strAddress)
+      c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+
+    names.insert(itm->name);
+    addresses.insert(strAddress);
+  }
+
+  // json lines start with an object, anything else is csv
+  int c;
+
+  while ((c = ifs.peek()) != EOF && isspace(c))
+    ifs.get();
+
+  if (c == '{')
+    svImportJSONLines(ifs, imported, stats, names, addresses);
+  else
+    svImportCSV(ifs, imported, stats, names, addresses);
+
+  if (!imported.empty())
+  {
+    svImportRebuildHostList(imported);
+
+    for (HostItem * itm : imported)
+      svSearchIndexUpdate(itm);
+
+    // rows have moved
+    svSearchFilterHostList(true);
+
+    if (app->scanIsRunning)
+      svScanBuildOrder();
+
+    app->hostList->redraw();
+
+    svConfigWrite();
+  }
+
+  std::string strMessage = "Imported " + std::to_string(stats.nAdded) + " server entries";
+
+  if (stats.nDuplicates > 0)
+    strMessage += "\nSkipped " + std::to_string(stats.nDuplicates) + " already in the list";
+
+  if (stats.nOverLimit > 0)
+    strMessage += "\nSkipped " + std::to_string(stats.nOverLimit) + " because the list is full (" +
+      std::to_string(SV_MAX_HOSTLIST_ENTRIES) + " entries max)";
+
+  if (stats.nInvalid > 0)
+    strMessage += "\nSkipped " + std::to_string(stats.nInvalid) + " invalid rows (line " +
+      stats.strBadLines + (stats.nInvalid > 10 ? ", ..." : "") + ")";
+
+  svLogToFile(strMessage);
+  svMessageWindow(strMessage, "SpiritVNC - Import");
+}
+
+
+/*  ask for an inventory file and import its hosts  */
+void svImportHostsFromFile ()
+{
+  // set default home path string
+  char strHome[FL_PATH_MAX] = {0};
+  fl_filename_expand(strHome, sizeof(strHome), "$HOME");
+
+  // create native file chooser
+  Fl_Native_File_Chooser fileChooser;
+  fileChooser.title("SpiritVNC - Please choose a CSV or JSON lines file to import...");
+  fileChooser.type(Fl_Native_File_Chooser::BROWSE_FILE);
+  fileChooser.filter("Server inventories\t*.{csv,tsv,txt,json,jsonl,ndjson}");
+
+  // set default directory
+  fileChooser.directory(strHome);
+
+  // show native chooser
+  int result = fileChooser.show();
+
+  // get out if we didn't choose anything or canceled
+  if (result == -1 || result == 1)
+    return;
+
+  const char * chosenFile = fileChooser.filename();
+
+  // get out if null or empty chosen file
+  if (!chosenFile || chosenFile[0] == '\0')
+    return;
+
+  svImportHosts(chosenFile);
+}
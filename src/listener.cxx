@@ -0,0 +1,293 @@
+/*
+ * listener.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "app.h"
+#include "hostitem.h"
+#include "listener.h"
+#include <atomic>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#endif
+
+/* one accepted reverse connection waiting for its viewer */
+struct SVAcceptedSocket
+{
+  int nSock;
+  std::string strPeer;
+};
+
+static pthread_mutex_t m_acceptedMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<SVAcceptedSocket> m_accepted;
+static std::atomic<bool> m_listenRunning(false);
+static std::atomic<bool> m_handOffPending(false);
+static pthread_t m_listenThread;
+static int m_listenSock = -1;
+static const void * m_listenItm = NULL;
+
+
+#ifndef _WIN32
+/*
+  hand accepted sockets to new listening viewers
+  (called on the main thread by Fl::awake)
+*/
+static void svListenerHandOff (void *)
+{
+  std::vector<SVAcceptedSocket> accepted;
+
+  pthread_mutex_lock(&m_acceptedMutex);
+  accepted.swap(m_accepted);
+  m_handOffPending = false;
+  pthread_mutex_unlock(&m_acceptedMutex);
+
+  for (const SVAcceptedSocket & acc : accepted)
+  {
+    if (!m_listenRunning || app->shuttingDown)
+    {
+      close(acc.nSock);
+      continue;
+    }
+
+    VncObject::createVNCReverseConnection(acc.nSock, acc.strPeer);
+  }
+}
+
+
+/*  return the numeric address of an accepted connection's peer  */
+static std::string svListenerPeerName (const struct sockaddr_storage& addr, socklen_t addrLen)
+{
+  char strHost[NI_MAXHOST] = {0};
+
+  if (getnameinfo(reinterpret_cast<const struct sockaddr *>(&addr), addrLen, strHost, sizeof(strHost),
+    NULL, 0, NI_NUMERICHOST) != 0)
+    return "unknown";
+
+  return strHost;
+}
+
+
+/*
+  accept reverse connections until stopped, queueing each socket
+  for the main thread so a burst is never refused or serialized
+  (runs as a thread)
+*/
+static void * svListenerThread (void *)
+{
+  struct pollfd pfd;
+
+  pfd.fd = m_listenSock;
+  pfd.events = POLLIN;
+
+  while (m_listenRunning)
+  {
+    pfd.revents = 0;
+
+    if (poll(&pfd, 1, SV_LISTEN_POLL_MS) <= 0)
+      continue;
+
+    bool queuedAny = false;
+
+    // take everything that's waiting, not just one connection per wakeup
+    while (m_listenRunning)
+    {
+      struct sockaddr_storage addr;
+      socklen_t addrLen = sizeof(addr);
+
+      int nSock = accept(m_listenSock, reinterpret_cast<struct sockaddr *>(&addr), &addrLen);
+
+      if (nSock < 0)
+      {
+        if (errno == EINTR || errno == ECONNABORTED)
+          continue;
+
+        // out of descriptors, so give viewers a moment to close some
+        if (errno == EMFILE || errno == ENFILE)
+        {
+          svLogToFile("WARNING - Too many open files to accept reverse VNC connections");
+          poll(NULL, 0, SV_LISTEN_POLL_MS);
+        }
+
+        break;
+      }
+
+      // the viewer's thread expects an ordinary blocking socket
+      fcntl(nSock, F_SETFL, fcntl(nSock, F_GETFL, 0) & ~O_NONBLOCK);
+      fcntl(nSock, F_SETFD, FD_CLOEXEC);
+
+      SVAcceptedSocket acc;
+      acc.nSock = nSock;
+      acc.strPeer = svListenerPeerName(addr, addrLen);
+
+      pthread_mutex_lock(&m_acceptedMutex);
+      m_accepted.push_back(acc);
+      pthread_mutex_unlock(&m_acceptedMutex);
+
+      queuedAny = true;
+    }
+
+    // one wakeup per batch, however many connections it holds
+    if (queuedAny && !m_handOffPending.exchange(true))
+      Fl::awake(svListenerHandOff, NULL);
+  }
+
+  close(m_listenSock);
+  m_listenSock = -1;
+
+  return SV_RET_VOID;
+}
+#endif
+
+
+/*
+  open the reverse connection port and start accepting on it,
+  on behalf of the 'Listening' host list item
+  (returns false if the port couldn't be opened)
+*/
+bool svListenerStart (void * itmData)
+{
+  #ifdef _WIN32
+  (void)itmData;
+
+  return false;
+  #else
+  if (m_listenRunning)
+    return true;
+
+  struct addrinfo hints;
+  struct addrinfo * res = NULL;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+
+  std::string strPort = std::to_string(SV_LISTEN_PORT);
+
+  int nErr = getaddrinfo(app->listenAddressStr, strPort.c_str(), &hints, &res);
+
+  if (nErr != 0 || !res)
+  {
+    svLogToFile("ERROR - Bad listening address '" + std::string(app->listenAddressStr) + "' - " +
+      gai_strerror(nErr));
+    return false;
+  }
+
+  int nSock = socket(res->ai_family, SOCK_STREAM, 0);
+
+  if (nSock < 0)
+  {
+    freeaddrinfo(res);
+    return false;
+  }
+
+  int nOne = 1;
+  setsockopt(nSock, SOL_SOCKET, SO_REUSEADDR, &nOne, sizeof(nOne));
+
+  fcntl(nSock, F_SETFL, fcntl(nSock, F_GETFL, 0) | O_NONBLOCK);
+  fcntl(nSock, F_SETFD, FD_CLOEXEC);
+
+  // a deep backlog so a fleet reconnecting at once isn't turned away
+  if (bind(nSock, res->ai_addr, res->ai_addrlen) != 0 || listen(nSock, SV_LISTEN_BACKLOG) != 0)
+  {
+    svLogToFile("ERROR - Could not listen on " + std::string(app->listenAddressStr) + ":" + strPort +
+      " - " + strerror(errno));
+
+    close(nSock);
+    freeaddrinfo(res);
+
+    return false;
+  }
+
+  freeaddrinfo(res);
+
+  m_listenSock = nSock;
+  m_listenRunning = true;
+
+  if (pthread_create(&m_listenThread, NULL, svListenerThread, NULL) != 0)
+  {
+    m_listenRunning = false;
+
+    close(m_listenSock);
+    m_listenSock = -1;
+
+    return false;
+  }
+
+  m_listenItm = itmData;
+
+  return true;
+  #endif
+}
+
+
+/*  stop accepting reverse connections and close the port  */
+void svListenerStop ()
+{
+  #ifndef _WIN32
+  if (!m_listenRunning)
+    return;
+
+  m_listenRunning = false;
+  m_listenItm = NULL;
+
+  // wait so the port is really closed before anyone tries to reopen it
+  pthread_join(m_listenThread, NULL);
+
+  // drop anything accepted but not handed off yet
+  pthread_mutex_lock(&m_acceptedMutex);
+
+  for (const SVAcceptedSocket & acc : m_accepted)
+    close(acc.nSock);
+
+  m_accepted.clear();
+  pthread_mutex_unlock(&m_acceptedMutex);
+  #endif
+}
+
+
+/*  return true if reverse connections are being accepted  */
+bool svListenerIsRunning ()
+{
+  return m_listenRunning;
+}
+
+
+/*  return true if itm is the 'Listening' item for the accept loop  */
+bool svListenerIsItem (const void * itmData)
+{
+  return itmData && m_listenRunning && itmData == m_listenItm;
+}
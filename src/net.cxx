@@ -0,0 +1,359 @@
+/*
+ * net.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "app.h"
+#include "hostitem.h"
+#include "net.h"
+
+#include <chrono>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#endif
+
+
+/*
+  set one integer socket option, logging any failure
+  (helper for svApplySocketOptions)
+*/
+static void svSetSocketOption (HostItem * itm, int nSock, int nLevel, int nOption, int nValue,
+  const char * strOption)
+{
+  if (setsockopt(nSock, nLevel, nOption, reinterpret_cast<const char *>(&nValue), sizeof(nValue)) != 0)
+    svLogToFile("WARNING - Could not set " + std::string(strOption) + " for '" + itm->name +
+      "' - " + itm->hostAddress + " - " + strerror(errno));
+}
+
+
+/*
+  apply the host's tcp tuning to its connected vnc socket
+  (called right after rfbInitClient succeeds)
+*/
+void svApplySocketOptions (HostItem * itm)
+{
+  if (!itm || !itm->state().vnc || !itm->state().vnc->vncClient)
+    return;
+
+  int nSock = itm->state().vnc->vncClient->sock;
+
+  if (nSock < 0)
+    return;
+
+  // disable nagle so key presses and pointer moves aren't held back
+  svSetSocketOption(itm, nSock, IPPROTO_TCP, TCP_NODELAY, itm->tcpNoDelay ? 1 : 0, "TCP_NODELAY");
+
+  // socket buffer sizes (0 leaves the system default alone)
+  // (sockets from svConnectRacing already have them, this covers the ones
+  // libvncclient connected itself, where only the send side still benefits)
+  if (itm->tcpBufferSize > 0)
+  {
+    int nBytes = itm->tcpBufferSize * 1024;
+
+    svSetSocketOption(itm, nSock, SOL_SOCKET, SO_RCVBUF, nBytes, "SO_RCVBUF");
+    svSetSocketOption(itm, nSock, SOL_SOCKET, SO_SNDBUF, nBytes, "SO_SNDBUF");
+  }
+
+  // keepalive, so dead links are noticed without waiting for the next read
+  svSetSocketOption(itm, nSock, SOL_SOCKET, SO_KEEPALIVE, itm->tcpKeepAlive ? 1 : 0, "SO_KEEPALIVE");
+
+  if (!itm->tcpKeepAlive)
+    return;
+
+  #if defined(TCP_KEEPIDLE)
+  svSetSocketOption(itm, nSock, IPPROTO_TCP, TCP_KEEPIDLE, itm->keepAliveIdle, "TCP_KEEPIDLE");
+  #elif defined(TCP_KEEPALIVE)
+  // macOS names the idle time TCP_KEEPALIVE
+  svSetSocketOption(itm, nSock, IPPROTO_TCP, TCP_KEEPALIVE, itm->keepAliveIdle, "TCP_KEEPALIVE");
+  #endif
+
+  #ifdef TCP_KEEPINTVL
+  svSetSocketOption(itm, nSock, IPPROTO_TCP, TCP_KEEPINTVL, itm->keepAliveInterval, "TCP_KEEPINTVL");
+  #endif
+
+  #ifdef TCP_KEEPCNT
+  svSetSocketOption(itm, nSock, IPPROTO_TCP, TCP_KEEPCNT, SV_TCP_KEEPALIVE_COUNT, "TCP_KEEPCNT");
+  #endif
+}
+
+
+#ifndef _WIN32
+/*
+  start a non-blocking connect to one resolved address
+  (returns the socket, or -1 with errno set; bConnected is set if it finished right away)
+  (helper for svConnectRacing)
+*/
+static int svStartConnect (const SVResolvedAddress& resolved, int nPort, int nBufferBytes, bool& bConnected)
+{
+  struct sockaddr_storage addr;
+
+  memcpy(&addr, &resolved.addr, sizeof(addr));
+
+  if (resolved.family == AF_INET6)
+    reinterpret_cast<struct sockaddr_in6 *>(&addr)->sin6_port = htons(nPort);
+  else
+    reinterpret_cast<struct sockaddr_in *>(&addr)->sin_port = htons(nPort);
+
+  int nSock = socket(resolved.family, SOCK_STREAM, 0);
+
+  if (nSock < 0)
+    return -1;
+
+  // buffer sizes have to be set before connecting, or the window
+  // scale is already agreed and a bigger receive buffer can't be used
+  if (nBufferBytes > 0)
+  {
+    setsockopt(nSock, SOL_SOCKET, SO_RCVBUF, &nBufferBytes, sizeof(nBufferBytes));
+    setsockopt(nSock, SOL_SOCKET, SO_SNDBUF, &nBufferBytes, sizeof(nBufferBytes));
+  }
+
+  int nFlags = fcntl(nSock, F_GETFL, 0);
+
+  if (nFlags < 0 || fcntl(nSock, F_SETFL, nFlags | O_NONBLOCK) < 0)
+  {
+    int errNum = errno;
+    close(nSock);
+    errno = errNum;
+
+    return -1;
+  }
+
+  bConnected = false;
+
+  if (connect(nSock, reinterpret_cast<struct sockaddr *>(&addr), resolved.addrLen) == 0)
+  {
+    bConnected = true;
+    return nSock;
+  }
+
+  if (errno == EINPROGRESS)
+    return nSock;
+
+  int errNum = errno;
+  close(nSock);
+  errno = errNum;
+
+  return -1;
+}
+#endif
+
+
+/*
+  connect to the first of addrsIn that answers, racing address families
+  with staggered starts so a black-holed family doesn't use up the whole timeout
+  (nBufferBytes sizes each socket's buffers before connecting, 0 leaves them alone)
+  (returns a connected non-blocking socket, or -1 with errno set)
+  (blocks, so call from a connection thread)
+*/
+int svConnectRacing (const std::vector<SVResolvedAddress>& addrsIn, int nPort, int nTimeoutSecs,
+  int nBufferBytes)
+{
+  #ifdef _WIN32
+  (void)addrsIn;
+  (void)nPort;
+  (void)nTimeoutSecs;
+  (void)nBufferBytes;
+
+  // not implemented for Windows, caller lets libvncclient connect instead
+  errno = ENOSYS;
+  return -1;
+  #else
+  if (addrsIn.empty())
+  {
+    errno = EHOSTUNREACH;
+    return -1;
+  }
+
+  // interleave the address families, keeping the resolver's order within each
+  std::vector<SVResolvedAddress> addrsFirst;
+  std::vector<SVResolvedAddress> addrsOther;
+  std::vector<SVResolvedAddress> addrs;
+
+  for (const SVResolvedAddress & resolved : addrsIn)
+  {
+    if (resolved.family == addrsIn[0].family)
+      addrsFirst.push_back(resolved);
+    else
+      addrsOther.push_back(resolved);
+  }
+
+  for (size_t i = 0; i < addrsFirst.size() || i < addrsOther.size(); i ++)
+  {
+    if (i < addrsFirst.size())
+      addrs.push_back(addrsFirst[i]);
+
+    if (i < addrsOther.size())
+      addrs.push_back(addrsOther[i]);
+  }
+
+  std::chrono::steady_clock::time_point tpNow = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point tpDeadline = tpNow + std::chrono::seconds(nTimeoutSecs);
+  std::chrono::steady_clock::time_point tpNextStart = tpNow;
+
+  std::vector<struct pollfd> pending;
+  size_t nNext = 0;
+  int nWinner = -1;
+  int errLast = ETIMEDOUT;
+
+  while (nWinner < 0)
+  {
+    tpNow = std::chrono::steady_clock::now();
+
+    if (tpNow >= tpDeadline)
+    {
+      errLast = ETIMEDOUT;
+      break;
+    }
+
+    // start the next attempt when its turn comes, or right away if nothing else is in flight
+    if (nNext < addrs.size() && (tpNow >= tpNextStart || pending.empty()))
+    {
+      bool bConnected = false;
+      int nSock = svStartConnect(addrs[nNext], nPort, nBufferBytes, bConnected);
+
+      nNext ++;
+      tpNextStart = tpNow + std::chrono::milliseconds(SV_CONNECT_STAGGER_MS);
+
+      if (nSock < 0)
+        errLast = errno;
+      else if (bConnected)
+        nWinner = nSock;
+      else
+      {
+        struct pollfd pfd;
+
+        pfd.fd = nSock;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+
+        pending.push_back(pfd);
+      }
+
+      continue;
+    }
+
+    // every address tried and failed
+    if (pending.empty())
+      break;
+
+    // wait for an attempt to finish, or until the next one is due
+    std::chrono::steady_clock::time_point tpWake = tpDeadline;
+
+    if (nNext < addrs.size() && tpNextStart < tpWake)
+      tpWake = tpNextStart;
+
+    int nWaitMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+      tpWake - tpNow).count()) + 1;
+
+    if (poll(pending.data(), pending.size(), nWaitMs) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      errLast = errno;
+      break;
+    }
+
+    for (size_t i = 0; i < pending.size();)
+    {
+      if (pending[i].revents == 0)
+      {
+        i ++;
+        continue;
+      }
+
+      int nSockErr = 0;
+      socklen_t nErrLen = sizeof(nSockErr);
+
+      if (getsockopt(pending[i].fd, SOL_SOCKET, SO_ERROR, &nSockErr, &nErrLen) != 0)
+        nSockErr = errno;
+
+      if (nSockErr == 0 && nWinner < 0)
+        nWinner = pending[i].fd;
+      else
+      {
+        if (nSockErr != 0)
+          errLast = nSockErr;
+
+        close(pending[i].fd);
+      }
+
+      pending.erase(pending.begin() + i);
+    }
+  }
+
+  // drop the attempts that lost the race
+  for (const struct pollfd & pfd : pending)
+    close(pfd.fd);
+
+  if (nWinner < 0)
+    errno = errLast;
+
+  return nWinner;
+  #endif
+}
+
+
+/*
+  return a short round-trip / retransmit readout for the host's vnc socket
+  (empty if not connected or the platform has no TCP_INFO)
+*/
+std::string svGetSocketStats (const HostItem * itm)
+{
+  if (!itm || !itm->state().isConnected || !itm->state().vnc || !itm->state().vnc->vncClient || itm->state().vnc->vncClient->sock < 0)
+    return "";
+
+  #if defined(__linux__) && defined(TCP_INFO)
+  struct tcp_info tcpInfo;
+  socklen_t nInfoLen = sizeof(tcpInfo);
+
+  memset(&tcpInfo, 0, sizeof(tcpInfo));
+
+  if (getsockopt(itm->state().vnc->vncClient->sock, IPPROTO_TCP, TCP_INFO, &tcpInfo, &nInfoLen) != 0)
+    return "";
+
+  char strStats[SV_MAX_PROP_LEN] = {0};
+
+  // tcpi_rtt and tcpi_rttvar are in microseconds
+  snprintf(strStats, SV_MAX_PROP_LEN, "RTT %.1f ms (+/- %.1f)  Retrans %u",
+    static_cast<double>(tcpInfo.tcpi_rtt) / 1000.0,
+    static_cast<double>(tcpInfo.tcpi_rttvar) / 1000.0,
+    tcpInfo.tcpi_total_retrans);
+
+  return strStats;
+  #else
+  return "";
+  #endif
+}
@@ -0,0 +1,411 @@
+/*
+ * prober.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "app.h"
+#include "hostitem.h"
+#include "prober.h"
+#include <atomic>
+#include <chrono>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+/* one host to probe and what came back */
+struct SVProbeTarget
+{
+  HostItem * itm;
+  std::string strHost;
+  int nPort;
+  const char * strBanner;
+  std::vector<SVResolvedAddress> addrs;
+  size_t nAddr;
+  bool wasProbed;
+  bool isUp;
+};
+
+/* one probe in flight */
+struct SVProbeState
+{
+  size_t nTarget;
+  bool isConnected;
+  std::chrono::steady_clock::time_point tpDeadline;
+};
+
+static std::atomic<bool> m_proberBusy(false);
+static std::atomic<time_t> m_lastProbeTime(0);
+
+
+#ifndef _WIN32
+/*
+  start a non-blocking connect to the target's next resolved address
+  that takes one
+  (returns the socket, or -1 when there are no addresses left to try)
+*/
+static int svProbeStart (SVProbeTarget& target)
+{
+  while (target.nAddr < target.addrs.size())
+  {
+    SVResolvedAddress& resolved = target.addrs[target.nAddr ++];
+
+    if (resolved.family == AF_INET6)
+      reinterpret_cast<struct sockaddr_in6 *>(&resolved.addr)->sin6_port = htons(target.nPort);
+    else
+      reinterpret_cast<struct sockaddr_in *>(&resolved.addr)->sin_port = htons(target.nPort);
+
+    int nSock = socket(resolved.family, SOCK_STREAM, 0);
+
+    if (nSock < 0)
+      continue;
+
+    int nFlags = fcntl(nSock, F_GETFL, 0);
+
+    if (nFlags < 0 || fcntl(nSock, F_SETFL, nFlags | O_NONBLOCK) < 0)
+    {
+      close(nSock);
+      continue;
+    }
+
+    if (connect(nSock, reinterpret_cast<struct sockaddr *>(&resolved.addr), resolved.addrLen) != 0 &&
+      errno != EINPROGRESS)
+    {
+      close(nSock);
+      continue;
+    }
+
+    return nSock;
+  }
+
+  return -1;
+}
+#endif
+
+
+/*
+  apply probe results to the host list icons
+  (called on the main thread by Fl::awake)
+*/
+static void svProberApplyResults (void * data)
+{
+  std::vector<SVProbeTarget> * targets = static_cast<std::vector<SVProbeTarget> *>(data);
+
+  if (!targets)
+    return;
+
+  if (!app->shuttingDown && app->hostList)
+  {
+    // items may have been deleted or connected while probing, so match
+    // results against the current list in one pass
+    std::unordered_map<const HostItem *, bool> results;
+
+    for (const SVProbeTarget & target : *targets)
+    {
+      if (target.wasProbed)
+        results[target.itm] = target.isUp;
+    }
+
+    int nSize = app->hostList->size();
+
+    for (int i = 0; i <= nSize; i ++)
+    {
+      HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
+
+      if (!itm || itm->state().isConnected || itm->state().isConnecting)
+        continue;
+
+      std::unordered_map<const HostItem *, bool>::const_iterator it = results.find(itm);
+
+      // hosts whose names didn't resolve in time weren't probed
+      if (it == results.end())
+        continue;
+
+      // leave error icons alone so the last error stays visible
+      if (itm->state().icon != app->iconDisconnected && itm->state().icon != app->iconNoConnect)
+        continue;
+
+      itm->state().icon = it->second ? app->iconDisconnected : app->iconNoConnect;
+      app->hostList->icon(i, itm->state().icon);
+    }
+
+    app->hostList->redraw();
+  }
+
+  delete targets;
+
+  m_lastProbeTime = time(NULL);
+  m_proberBusy = false;
+}
+
+
+/*
+  probe every target, many at once on this one thread, counting a host
+  as up when it answers with the expected banner
+  (this is called as a thread because it blocks)
+*/
+static void * svProberThread (void * data)
+{
+  // detach this thread
+  pthread_detach(pthread_self());
+
+  std::vector<SVProbeTarget> * targets = static_cast<std::vector<SVProbeTarget> *>(data);
+
+  #ifndef _WIN32
+  // get every name looking up in parallel before the probes need them
+  for (const SVProbeTarget & target : *targets)
+    svResolverPrewarm(target.strHost);
+
+  std::vector<struct pollfd> pfds;
+  std::vector<SVProbeState> states;
+
+  // targets whose names haven't resolved yet
+  std::vector<size_t> waiting;
+
+  for (size_t i = 0; i < targets->size(); i ++)
+    waiting.push_back(i);
+
+  // names that take longer than a connection would are left for the next round
+  std::chrono::steady_clock::time_point tpResolveDeadline =
+    std::chrono::steady_clock::now() + std::chrono::seconds(SV_CONNECTION_TIMEOUT_SECS);
+
+  while (!app->shuttingDown && (!waiting.empty() || !pfds.empty()))
+  {
+    // top up the probes in flight with hosts that are resolved already,
+    // so a slow lookup never holds up the rest
+    for (size_t w = 0; w < waiting.size() && pfds.size() < SV_PROBE_MAX_IN_FLIGHT;)
+    {
+      size_t nTarget = waiting[w];
+      SVProbeTarget& target = (*targets)[nTarget];
+
+      if (!svResolverCached(target.strHost, target.addrs))
+      {
+        w ++;
+        continue;
+      }
+
+      target.nAddr = 0;
+      target.wasProbed = true;
+
+      int nSock = svProbeStart(target);
+
+      if (nSock >= 0)
+      {
+        struct pollfd pfd;
+        pfd.fd = nSock;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+
+        SVProbeState state;
+        state.nTarget = nTarget;
+        state.isConnected = false;
+        state.tpDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(SV_PROBE_TIMEOUT_SECS);
+
+        pfds.push_back(pfd);
+        states.push_back(state);
+      }
+
+      waiting[w] = waiting.back();
+      waiting.pop_back();
+    }
+
+    if (!waiting.empty() && std::chrono::steady_clock::now() >= tpResolveDeadline)
+      waiting.clear();
+
+    // (with nothing in flight this just waits for the resolver)
+    if (poll(pfds.data(), pfds.size(), SV_PROBE_POLL_MS) < 0 && errno != EINTR)
+      break;
+
+    std::chrono::steady_clock::time_point tpNow = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < pfds.size();)
+    {
+      SVProbeTarget& target = (*targets)[states[i].nTarget];
+      bool isDone = false;
+      bool connectFailed = false;
+
+      if (pfds[i].revents != 0 && !states[i].isConnected)
+      {
+        int nSockErr = 0;
+        socklen_t nErrLen = sizeof(nSockErr);
+
+        // connected, so wait for the server's banner
+        if (getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, &nSockErr, &nErrLen) == 0 && nSockErr == 0)
+        {
+          states[i].isConnected = true;
+          pfds[i].events = POLLIN;
+        }
+        else
+          connectFailed = true;
+      }
+      else if (pfds[i].revents != 0)
+      {
+        char strBuf[16] = {0};
+        ssize_t nRead = recv(pfds[i].fd, strBuf, sizeof(strBuf) - 1, 0);
+
+        if (nRead >= 4 && strncmp(strBuf, target.strBanner, 4) == 0)
+          target.isUp = true;
+
+        isDone = true;
+      }
+
+      if (!isDone && !connectFailed && tpNow >= states[i].tpDeadline)
+      {
+        if (states[i].isConnected)
+          isDone = true;
+        else
+          connectFailed = true;
+      }
+
+      // refused, unreachable or no answer, so try the host's next address
+      if (connectFailed)
+      {
+        close(pfds[i].fd);
+
+        pfds[i].fd = svProbeStart(target);
+        pfds[i].events = POLLOUT;
+        states[i].tpDeadline = tpNow + std::chrono::seconds(SV_PROBE_TIMEOUT_SECS);
+
+        if (pfds[i].fd < 0)
+        {
+          pfds.erase(pfds.begin() + i);
+          states.erase(states.begin() + i);
+          continue;
+        }
+      }
+
+      if (isDone)
+      {
+        close(pfds[i].fd);
+
+        pfds.erase(pfds.begin() + i);
+        states.erase(states.begin() + i);
+      }
+      else
+        i ++;
+    }
+  }
+
+  // only left over if we're shutting down
+  for (const struct pollfd & pfd : pfds)
+    close(pfd.fd);
+  #endif
+
+  // the awake queue is full, so drop this round rather than stop probing
+  if (Fl::awake(svProberApplyResults, targets) != 0)
+  {
+    delete targets;
+
+    m_lastProbeTime = time(NULL);
+    m_proberBusy = false;
+  }
+
+  return SV_RET_VOID;
+}
+
+
+/*
+  start a probe round of every idle host if one is due
+  (called by svConnectionWatcher)
+*/
+void svProberTick ()
+{
+  #ifdef _WIN32
+  // not implemented for Windows yet
+  return;
+  #endif
+
+  if (app->nProbeInterval <= 0 || app->shuttingDown || !app->hostList || m_proberBusy)
+    return;
+
+  if (time(NULL) - m_lastProbeTime < app->nProbeInterval)
+    return;
+
+  std::vector<SVProbeTarget> * targets = new std::vector<SVProbeTarget>();
+  int nSize = app->hostList->size();
+
+  for (int i = 0; i <= nSize; i ++)
+  {
+    HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
+
+    if (!itm || itm->state().isListener || itm->state().isConnected || itm->state().isConnecting || itm->hostAddress.empty())
+      continue;
+
+    SVProbeTarget target;
+    target.itm = itm;
+    target.strHost = itm->hostAddress;
+    target.nAddr = 0;
+    target.wasProbed = false;
+    target.isUp = false;
+
+    // ssh hosts are probed on their ssh server, which answers with its own banner
+    if (itm->hostType == 's')
+    {
+      target.nPort = itm->sshPort.empty() ? 22 : atoi(itm->sshPort.c_str());
+      target.strBanner = "SSH-";
+    }
+    else
+    {
+      target.nPort = atoi(itm->vncPort.c_str());
+
+      // same display-number rule libvncclient uses
+      if (target.nPort < 100)
+        target.nPort += 5900;
+
+      target.strBanner = "RFB ";
+    }
+
+    targets->push_back(target);
+  }
+
+  if (targets->empty())
+  {
+    delete targets;
+    m_lastProbeTime = time(NULL);
+
+    return;
+  }
+
+  m_proberBusy = true;
+
+  pthread_t threadProber;
+
+  if (pthread_create(&threadProber, NULL, svProberThread, targets) != 0)
+  {
+    svLogToFile("ERROR - Couldn't create host prober thread");
+
+    delete targets;
+    m_lastProbeTime = time(NULL);
+    m_proberBusy = false;
+  }
+}
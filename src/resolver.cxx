@@ -0,0 +1,337 @@
+/*
+ * resolver.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "app.h"
+#include "resolver.h"
+#include <deque>
+
+#ifndef _WIN32
+#include <netdb.h>
+#endif
+
+/* cached lookup result for one host name */
+struct SVResolverEntry
+{
+  std::vector<SVResolvedAddress> addrs;
+  time_t expires;
+  bool pending;
+};
+
+/* resolver cache, work queue and worker state */
+static std::unordered_map<std::string, SVResolverEntry> m_resolverCache;
+static std::deque<std::string> m_resolverQueue;
+static pthread_mutex_t m_resolverMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t m_resolverQueueCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t m_resolverDoneCond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t m_resolverOnce = PTHREAD_ONCE_INIT;
+static SVResolveFunc m_resolveFunc = svResolveWithGetaddrinfo;
+static SVResolverClock m_resolverClock = time;
+
+
+/*
+  store a lookup result in the cache and wake anyone waiting on it
+  (resolver mutex must NOT be held)
+*/
+static void svResolverStore (const std::string& strHost, bool resolvedOkay,
+  const std::vector<SVResolvedAddress>& addrs)
+{
+  pthread_mutex_lock(&m_resolverMutex);
+
+  SVResolverEntry & entry = m_resolverCache[strHost];
+
+  entry.addrs = addrs;
+  entry.pending = false;
+
+  // failures are only remembered briefly
+  if (resolvedOkay && !addrs.empty())
+    entry.expires = m_resolverClock(NULL) + SV_RESOLVER_TTL_SECS;
+  else
+    entry.expires = m_resolverClock(NULL) + SV_RESOLVER_NEGATIVE_TTL_SECS;
+
+  pthread_cond_broadcast(&m_resolverDoneCond);
+  pthread_mutex_unlock(&m_resolverMutex);
+}
+
+
+/*
+  resolver worker, takes host names off the queue and looks them up
+  (this is called as a thread because lookups block)
+*/
+static void * svResolverWorker (void *)
+{
+  // detach this thread
+  pthread_detach(pthread_self());
+
+  while (true)
+  {
+    pthread_mutex_lock(&m_resolverMutex);
+
+    while (m_resolverQueue.empty())
+      pthread_cond_wait(&m_resolverQueueCond, &m_resolverMutex);
+
+    std::string strHost = m_resolverQueue.front();
+    m_resolverQueue.pop_front();
+
+    SVResolveFunc resolveFunc = m_resolveFunc;
+
+    pthread_mutex_unlock(&m_resolverMutex);
+
+    std::vector<SVResolvedAddress> addrs;
+    bool resolvedOkay = resolveFunc(strHost, addrs);
+
+    svResolverStore(strHost, resolvedOkay, addrs);
+  }
+
+  return SV_RET_VOID;
+}
+
+
+/*  start the resolver worker threads (once)  */
+static void svResolverStartWorkers ()
+{
+  for (int i = 0; i < SV_RESOLVER_THREADS; i ++)
+  {
+    pthread_t threadResolver;
+
+    if (pthread_create(&threadResolver, NULL, svResolverWorker, NULL) != 0)
+      svLogToFile("ERROR - Couldn't create resolver thread");
+  }
+}
+
+
+/*
+  get strHost's addresses without blocking, only if they're cached
+  (queues a background lookup and returns false when they aren't yet,
+  a cached failure returns true with no addresses)
+*/
+bool svResolverCached (const std::string& strHost, std::vector<SVResolvedAddress>& addrs)
+{
+  addrs.clear();
+
+  if (strHost.empty())
+    return true;
+
+  pthread_mutex_lock(&m_resolverMutex);
+
+  std::unordered_map<std::string, SVResolverEntry>::const_iterator it = m_resolverCache.find(strHost);
+
+  if (it != m_resolverCache.end() && !it->second.pending && it->second.expires > m_resolverClock(NULL))
+  {
+    addrs = it->second.addrs;
+    pthread_mutex_unlock(&m_resolverMutex);
+
+    return true;
+  }
+
+  pthread_mutex_unlock(&m_resolverMutex);
+
+  svResolverPrewarm(strHost);
+
+  return false;
+}
+
+
+/*
+  look up strHost, using the cache when it's fresh, waiting for a
+  lookup already in progress, or resolving right here otherwise
+  (blocks, so call from a connection thread)
+*/
+bool svResolverLookup (const std::string& strHost, std::vector<SVResolvedAddress>& addrs)
+{
+  addrs.clear();
+
+  if (strHost.empty())
+    return false;
+
+  struct timespec tsDeadline;
+  tsDeadline.tv_sec = time(NULL) + SV_CONNECTION_TIMEOUT_SECS;
+  tsDeadline.tv_nsec = 0;
+
+  pthread_mutex_lock(&m_resolverMutex);
+
+  while (true)
+  {
+    std::unordered_map<std::string, SVResolverEntry>::iterator it = m_resolverCache.find(strHost);
+
+    if (it == m_resolverCache.end())
+      break;
+
+    // a worker is resolving this host already, so wait for it
+    if (it->second.pending)
+    {
+      if (pthread_cond_timedwait(&m_resolverDoneCond, &m_resolverMutex, &tsDeadline) != 0)
+      {
+        pthread_mutex_unlock(&m_resolverMutex);
+        return false;
+      }
+
+      continue;
+    }
+
+    // fresh cache entry
+    if (it->second.expires > m_resolverClock(NULL))
+    {
+      addrs = it->second.addrs;
+      pthread_mutex_unlock(&m_resolverMutex);
+
+      return !addrs.empty();
+    }
+
+    break;
+  }
+
+  // nothing usable cached, so resolve it ourselves
+  m_resolverCache[strHost].pending = true;
+
+  SVResolveFunc resolveFunc = m_resolveFunc;
+
+  pthread_mutex_unlock(&m_resolverMutex);
+
+  bool resolvedOkay = resolveFunc(strHost, addrs);
+
+  svResolverStore(strHost, resolvedOkay, addrs);
+
+  return resolvedOkay && !addrs.empty();
+}
+
+
+/*
+  drop strHost from the cache
+  (use when connecting to a cached address failed, in case it went stale)
+*/
+void svResolverForget (const std::string& strHost)
+{
+  pthread_mutex_lock(&m_resolverMutex);
+
+  std::unordered_map<std::string, SVResolverEntry>::iterator it = m_resolverCache.find(strHost);
+
+  if (it != m_resolverCache.end() && !it->second.pending)
+    m_resolverCache.erase(it);
+
+  pthread_mutex_unlock(&m_resolverMutex);
+}
+
+
+/*
+  queue strHost for a background lookup, unless it's
+  already cached or being looked up
+*/
+void svResolverPrewarm (const std::string& strHost)
+{
+  if (strHost.empty())
+    return;
+
+  pthread_once(&m_resolverOnce, svResolverStartWorkers);
+
+  pthread_mutex_lock(&m_resolverMutex);
+
+  std::unordered_map<std::string, SVResolverEntry>::iterator it = m_resolverCache.find(strHost);
+
+  if (it == m_resolverCache.end() || (!it->second.pending && it->second.expires <= m_resolverClock(NULL)))
+  {
+    m_resolverCache[strHost].pending = true;
+    m_resolverQueue.push_back(strHost);
+
+    pthread_cond_signal(&m_resolverQueueCond);
+  }
+
+  pthread_mutex_unlock(&m_resolverMutex);
+}
+
+
+/*
+  replace the clock used for cache expiry
+  (lets a stub clock step past the cache lifetimes)
+*/
+void svResolverSetClock (SVResolverClock resolverClock)
+{
+  pthread_mutex_lock(&m_resolverMutex);
+  m_resolverClock = resolverClock ? resolverClock : time;
+  pthread_mutex_unlock(&m_resolverMutex);
+}
+
+
+/*
+  replace the function used to resolve host names
+  (lets a local stub resolver stand in for getaddrinfo)
+*/
+void svResolverSetFunction (SVResolveFunc resolveFunc)
+{
+  pthread_mutex_lock(&m_resolverMutex);
+
+  m_resolveFunc = resolveFunc ? resolveFunc : svResolveWithGetaddrinfo;
+  m_resolverCache.clear();
+
+  pthread_mutex_unlock(&m_resolverMutex);
+}
+
+
+/*  default resolve function, using the system's getaddrinfo  */
+bool svResolveWithGetaddrinfo (const std::string& strHost, std::vector<SVResolvedAddress>& addrs)
+{
+  struct addrinfo hints;
+  struct addrinfo * res = NULL;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_ADDRCONFIG;
+
+  int nErr = getaddrinfo(strHost.c_str(), NULL, &hints, &res);
+
+  if (nErr != 0)
+  {
+    svLogToFile("Could not resolve '" + strHost + "' - " + gai_strerror(nErr));
+    return false;
+  }
+
+  for (struct addrinfo * ai = res; ai != NULL; ai = ai->ai_next)
+  {
+    if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6)
+      continue;
+
+    SVResolvedAddress resolved;
+
+    memset(&resolved, 0, sizeof(resolved));
+    memcpy(&resolved.addr, ai->ai_addr, ai->ai_addrlen);
+    resolved.addrLen = ai->ai_addrlen;
+    resolved.family = ai->ai_family;
+
+    addrs.push_back(resolved);
+  }
+
+  freeaddrinfo(res);
+
+  return !addrs.empty();
+}
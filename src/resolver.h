@@ -0,0 +1,77 @@
+/*
+ * resolver.h - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+
+#include <string>
+#include <time.h>
+#include <vector>
+
+/* one resolved address for a host */
+struct SVResolvedAddress
+{
+  struct sockaddr_storage addr;
+  socklen_t addrLen;
+  int family;
+};
+
+/*
+  resolve function type
+  (getaddrinfo is used by default, a stub can be swapped in with svResolverSetFunction)
+*/
+typedef bool (* SVResolveFunc) (const std::string&, std::vector<SVResolvedAddress>&);
+
+/*
+  clock used for cache expiry, called like time()
+  (a stub can be swapped in with svResolverSetClock to check expiry without waiting)
+*/
+typedef time_t (* SVResolverClock) (time_t *);
+
+bool svResolverCached (const std::string&, std::vector<SVResolvedAddress>&);
+bool svResolverLookup (const std::string&, std::vector<SVResolvedAddress>&);
+void svResolverForget (const std::string&);
+void svResolverPrewarm (const std::string&);
+void svResolverSetClock (SVResolverClock);
+void svResolverSetFunction (SVResolveFunc);
+bool svResolveWithGetaddrinfo (const std::string&, std::vector<SVResolvedAddress>&);
+
+#endif
@@ -0,0 +1,430 @@
+/*
+ * search.cxx - part of SpiritVNC - FLTK
+ * 2016-2026 Will Brokenbourgh https://www.willbrokenbourgh.com/brainout/
+ */
+
+/*
+ * (C) Will Brokenbourgh
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "app.h"
+#include "hostitem.h"
+#include "search.h"
+#include <algorithm>
+#include <climits>
+#include <unordered_set>
+
+/* one indexed host and the lower-case text it's searched by */
+struct SVSearchEntry
+{
+  void * itm;
+  std::string strText;
+};
+
+/*
+  indexed hosts, by entry id
+  (removed and re-indexed hosts leave a dead entry, still in the
+  postings, until there are enough to compact)
+*/
+static std::vector<SVSearchEntry> m_searchEntries;
+static size_t m_nSearchRemoved = 0;
+
+/* entry id of each indexed host */
+static std::unordered_map<const void *, uint32_t> m_searchIds;
+
+/*
+  sorted entry ids of the hosts containing each one, two and three
+  character gram (the gram's length is in the key's top byte)
+*/
+static std::unordered_map<uint32_t, std::vector<uint32_t>> m_searchGrams;
+
+/* next host list row to index in the background, 0 when not building */
+static int m_nSearchBuildRow = 0;
+
+/*
+  hosts indexed without their quick note, because it was still encoded
+  (notes are decoded lazily, so they're only decoded for the index once
+  somebody actually searches)
+*/
+static std::unordered_set<const void *> m_searchNoteless;
+static bool m_searchNotesDecoded = false;
+
+
+/*  pack the nLen (1 - 3) characters at p into one gram key  */
+static inline uint32_t svSearchGram (const char * p, size_t nLen)
+{
+  uint32_t nGram = static_cast<uint32_t>(nLen) << 24;
+
+  for (size_t i = 0; i < nLen; i ++)
+    nGram |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * (nLen - 1 - i));
+
+  return nGram;
+}
+
+
+/*  return the sorted, unique one, two and three character grams in strText  */
+static std::vector<uint32_t> svSearchGrams (const std::string& strText)
+{
+  std::vector<uint32_t> grams;
+
+  grams.reserve(strText.size() * 3);
+
+  for (size_t i = 0; i < strText.size(); i ++)
+    for (size_t nLen = 1; nLen <= 3 && i + nLen <= strText.size(); nLen ++)
+      grams.push_back(svSearchGram(&strText[i], nLen));
+
+  std::sort(grams.begin(), grams.end());
+  grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+  return grams;
+}
+
+
+/*  order postings lists by length (std::sort comparator)  */
+static bool svSearchShorterPosting (const std::vector<uint32_t> * a, const std::vector<uint32_t> * b)
+{
+  return a->size() < b->size();
+}
+
+
+/*  lower-case strIn onto the end of strOut  */
+static void svSearchAppendLower (std::string& strOut, const std::string& strIn)
+{
+  for (const char & c : strIn)
+    strOut += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+
+/*
+  squeeze dead entries out of the index and its postings, renumbering
+  the rest (ids keep their order, so postings stay sorted)
+*/
+static void svSearchCompact ()
+{
+  std::vector<uint32_t> newIds(m_searchEntries.size(), UINT32_MAX);
+  size_t nNext = 0;
+
+  for (size_t i = 0; i < m_searchEntries.size(); i ++)
+  {
+    if (!m_searchEntries[i].itm)
+      continue;
+
+    newIds[i] = static_cast<uint32_t>(nNext);
+
+    if (nNext != i)
+      m_searchEntries[nNext] = std::move(m_searchEntries[i]);
+
+    m_searchIds[m_searchEntries[nNext].itm] = static_cast<uint32_t>(nNext);
+
+    nNext ++;
+  }
+
+  m_searchEntries.resize(nNext);
+  m_searchEntries.shrink_to_fit();
+  m_nSearchRemoved = 0;
+
+  std::unordered_map<uint32_t, std::vector<uint32_t>>::iterator it = m_searchGrams.begin();
+
+  while (it != m_searchGrams.end())
+  {
+    std::vector<uint32_t>& ids = it->second;
+    size_t nKept = 0;
+
+    for (uint32_t nId : ids)
+    {
+      if (newIds[nId] != UINT32_MAX)
+        ids[nKept ++] = newIds[nId];
+    }
+
+    ids.resize(nKept);
+
+    if (ids.empty())
+      it = m_searchGrams.erase(it);
+    else
+      ++ it;
+  }
+}
+
+
+/*  mark entry nId dead, compacting once dead entries are most of the index  */
+static void svSearchKill (uint32_t nId)
+{
+  m_searchEntries[nId].itm = NULL;
+  std::string().swap(m_searchEntries[nId].strText);
+
+  m_nSearchRemoved ++;
+
+  if (m_nSearchRemoved >= SV_SEARCH_COMPACT_MIN && m_nSearchRemoved * 2 > m_searchEntries.size())
+    svSearchCompact();
+}
+
+
+/*  index up to nRows more rows of the host list, from m_nSearchBuildRow  */
+static void svSearchBuildRows (int nRows)
+{
+  int nSize = app->hostList->size();
+
+  while (m_nSearchBuildRow > 0 && m_nSearchBuildRow <= nSize && nRows > 0)
+  {
+    void * itm = app->hostList->data(m_nSearchBuildRow ++);
+
+    // (hosts added since the build started were indexed as they came in)
+    if (itm && m_searchIds.find(itm) == m_searchIds.end())
+    {
+      svSearchIndexUpdate(itm);
+      nRows --;
+    }
+  }
+
+  if (m_nSearchBuildRow > nSize)
+    m_nSearchBuildRow = 0;
+}
+
+
+/*
+  index the host list a chunk at a time while the app is otherwise idle
+  (timer callback)
+*/
+static void svSearchBuildStep (void *)
+{
+  if (!app->hostList || m_nSearchBuildRow == 0)
+    return;
+
+  svSearchBuildRows(SV_SEARCH_BUILD_CHUNK);
+
+  if (m_nSearchBuildRow != 0)
+    Fl::repeat_timeout(0.0, svSearchBuildStep);
+}
+
+
+/*
+  index every host in the host list, in the background so loading a
+  long list isn't held up (a search before it's done finishes it)
+*/
+void svSearchIndexBuild ()
+{
+  svSearchIndexClear();
+
+  m_nSearchBuildRow = 1;
+
+  Fl::add_timeout(0.0, svSearchBuildStep);
+}
+
+
+/*  forget every indexed host  */
+void svSearchIndexClear ()
+{
+  Fl::remove_timeout(svSearchBuildStep);
+
+  // swapped with empty ones, so the memory goes back too
+  std::vector<SVSearchEntry>().swap(m_searchEntries);
+  std::unordered_map<const void *, uint32_t>().swap(m_searchIds);
+  std::unordered_map<uint32_t, std::vector<uint32_t>>().swap(m_searchGrams);
+  std::unordered_set<const void *>().swap(m_searchNoteless);
+
+  m_searchNotesDecoded = false;
+
+  m_nSearchRemoved = 0;
+  m_nSearchBuildRow = 0;
+}
+
+
+/*  stop finding a host that's being deleted  */
+void svSearchIndexRemove (const void * itmData)
+{
+  std::unordered_map<const void *, uint32_t>::iterator it = m_searchIds.find(itmData);
+
+  if (it == m_searchIds.end())
+    return;
+
+  uint32_t nId = it->second;
+
+  m_searchIds.erase(it);
+  m_searchNoteless.erase(itmData);
+  svSearchKill(nId);
+
+  // rows below this one moved up, so look again from the top for any
+  // the background build skipped
+  if (m_nSearchBuildRow > 1)
+    m_nSearchBuildRow = 1;
+}
+
+
+/*
+  (re)index a host by its name, address, group and quick note
+  (a changed host gets a fresh entry, so edits never search the postings)
+  (an encoded quick note is left out until the first search)
+*/
+void svSearchIndexUpdate (void * itmData)
+{
+  HostItem * itm = static_cast<HostItem *>(itmData);
+
+  if (!itm)
+    return;
+
+  std::string strText;
+
+  svSearchAppendLower(strText, itm->name);
+  strText += '\n';
+  svSearchAppendLower(strText, itm->hostAddress);
+  strText += '\n';
+  svSearchAppendLower(strText, itm->group);
+  strText += '\n';
+
+  if (itm->quickNoteEncoded && !m_searchNotesDecoded)
+    m_searchNoteless.insert(itm);
+  else
+  {
+    svSearchAppendLower(strText, svQuickNote(itm));
+    m_searchNoteless.erase(itm);
+  }
+
+  std::unordered_map<const void *, uint32_t>::iterator it = m_searchIds.find(itm);
+
+  if (it != m_searchIds.end())
+  {
+    if (m_searchEntries[it->second].strText == strText)
+      return;
+
+    uint32_t nOldId = it->second;
+
+    m_searchIds.erase(it);
+    svSearchKill(nOldId);
+  }
+
+  uint32_t nId = static_cast<uint32_t>(m_searchEntries.size());
+
+  SVSearchEntry entry;
+  entry.itm = itm;
+  entry.strText = strText;
+
+  m_searchEntries.push_back(entry);
+  m_searchIds[itm] = nId;
+
+  // new ids are always the largest, so postings stay sorted
+  for (uint32_t nGram : svSearchGrams(strText))
+    m_searchGrams[nGram].push_back(nId);
+}
+
+
+/*
+  find the hosts whose name, address, group or quick note
+  contain strQuery, ignoring case
+*/
+void svSearchQuery (const std::string& strQuery, std::vector<void *>& results)
+{
+  results.clear();
+
+  std::string strLower;
+  svSearchAppendLower(strLower, strQuery);
+
+  if (strLower.empty())
+    return;
+
+  // searched before the background build got through the list
+  if (m_nSearchBuildRow != 0)
+  {
+    svSearchBuildRows(INT_MAX);
+    Fl::remove_timeout(svSearchBuildStep);
+  }
+
+  // first search since loading, so decode the notes left out and index them
+  if (!m_searchNotesDecoded)
+  {
+    m_searchNotesDecoded = true;
+
+    std::vector<const void *> noteless(m_searchNoteless.begin(), m_searchNoteless.end());
+
+    for (const void * itm : noteless)
+      svSearchIndexUpdate(const_cast<void *>(itm));
+  }
+
+  // one or two characters are grams themselves, so their postings are the answer
+  if (strLower.size() < 3)
+  {
+    std::unordered_map<uint32_t, std::vector<uint32_t>>::const_iterator it =
+      m_searchGrams.find(svSearchGram(strLower.data(), strLower.size()));
+
+    if (it == m_searchGrams.end())
+      return;
+
+    results.reserve(it->second.size());
+
+    for (uint32_t nId : it->second)
+    {
+      if (m_searchEntries[nId].itm)
+        results.push_back(m_searchEntries[nId].itm);
+    }
+
+    return;
+  }
+
+  std::vector<uint32_t> trigrams;
+
+  for (size_t i = 0; i + 2 < strLower.size(); i ++)
+    trigrams.push_back(svSearchGram(&strLower[i], 3));
+
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+  // intersect the trigram postings, smallest first
+  std::vector<const std::vector<uint32_t> *> postings;
+
+  for (uint32_t nTrigram : trigrams)
+  {
+    std::unordered_map<uint32_t, std::vector<uint32_t>>::const_iterator it = m_searchGrams.find(nTrigram);
+
+    if (it == m_searchGrams.end())
+      return;
+
+    postings.push_back(&it->second);
+  }
+
+  std::sort(postings.begin(), postings.end(), svSearchShorterPosting);
+
+  std::vector<uint32_t> candidates = *postings[0];
+  std::vector<uint32_t> narrowed;
+
+  for (size_t i = 1; i < postings.size() && !candidates.empty(); i ++)
+  {
+    narrowed.clear();
+    std::set_intersection(candidates.begin(), candidates.end(), postings[i]->begin(), postings[i]->end(),
+      std::back_inserter(narrowed));
+    candidates.swap(narrowed);
+  }
+
+  // the trigrams can all be there without being in order, so check
+  for (uint32_t nId : candidates)
+  {
+    const SVSearchEntry & entry = m_searchEntries[nId];
+
+    if (entry.itm && entry.strText.find(strLower) != std::string::npos)
+      results.push_back(entry.itm);
+  }
+}
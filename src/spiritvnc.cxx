@@ -63,6 +63,9 @@ int main (int argc, char ** argv)
   // create gui, load list, etc.
   svDoStartupTasks();
 
+  // pick up config file changes made while we're running
+  svConfigWatchStart();
+
   // ignore SIGPIPE from libvncclient socket calls
   // (not sure if this does anything...?)
   #ifndef _WIN32
@@ -35,6 +35,690 @@
 #include "app.h"
 #include "hostitem.h"
 
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+extern char ** environ;
+#endif
+
+/* local forwarding ports handed out to ssh connections, and who has them */
+static std::unordered_map<int, const HostItem *> m_reservedPorts;
+static pthread_mutex_t m_reservedPortsMutex = PTHREAD_MUTEX_INITIALIZER;
+static int m_nNextPortOffset = 0;
+
+#ifndef _WIN32
+/* private directory for unix-domain socket forwards and ssh control sockets */
+static std::string m_strSocketDir;
+static int m_nNextSocketId = 0;
+
+/* one shared ssh master connection */
+struct SVSSHMaster
+{
+  std::string strKey;
+  std::string strTarget;
+  std::string strControlPath;
+  FILE * sshCmdStream;
+  pid_t sshPid;
+  int nRefs;
+  bool isReady;
+};
+
+/*
+  shared ssh master connections by id (main thread only)
+  (items hold the id, so a new master to the same server is never
+  mistaken for an old one)
+*/
+static std::unordered_map<unsigned int, SVSSHMaster> m_sshMasters;
+static unsigned int m_nNextMasterId = 1;
+
+/* a running ssh process we started, and who depends on it */
+struct SVSSHChild
+{
+  HostItem * itm;
+  unsigned int nMasterId;
+  int nStderrFd;
+  std::string strStderr;
+};
+
+/* running ssh processes by pid (main thread only) */
+static std::unordered_map<pid_t, SVSSHChild> m_sshChildren;
+
+/* SIGCHLD handler writes to this so the event loop notices ssh exiting */
+static int m_sigChildPipe[2] = {-1, -1};
+
+
+/*  SIGCHLD handler, just wakes up the event loop  */
+static void svSigChildHandler (int)
+{
+  int errNum = errno;
+
+  ssize_t nWritten = write(m_sigChildPipe[1], "c", 1);
+  (void)nWritten;
+
+  errno = errNum;
+}
+
+
+/*
+  read what an ssh process has written to stderr, keeping the tail
+  (fd callback)
+*/
+static void svSSHStderrReady (int nFd, void * data)
+{
+  pid_t pid = static_cast<pid_t>(reinterpret_cast<intptr_t>(data));
+  std::unordered_map<pid_t, SVSSHChild>::iterator it = m_sshChildren.find(pid);
+
+  char strBuf[1024];
+  ssize_t nRead = 0;
+
+  while ((nRead = read(nFd, strBuf, sizeof(strBuf))) > 0)
+  {
+    if (it == m_sshChildren.end())
+      continue;
+
+    it->second.strStderr.append(strBuf, nRead);
+
+    if (it->second.strStderr.size() > SV_SSH_STDERR_KEEP)
+      it->second.strStderr.erase(0, it->second.strStderr.size() - SV_SSH_STDERR_KEEP);
+  }
+
+  // end of file or a real error, so stop watching
+  if (nRead == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+  {
+    Fl::remove_fd(nFd);
+    close(nFd);
+
+    if (it != m_sshChildren.end())
+      it->second.nStderrFd = -1;
+  }
+}
+
+
+/*
+  the ssh process an itm depended on is gone, so drop
+  its vnc connection now instead of waiting for a timeout
+*/
+static void svSSHTunnelLost (HostItem * itm, const std::string& strReason)
+{
+  itm->sshPid = 0;
+  itm->state().sshReady = false;
+
+  if (itm->sshCmdStream)
+  {
+    fclose(itm->sshCmdStream);
+    itm->sshCmdStream = NULL;
+  }
+
+  if (!strReason.empty())
+    itm->lastErrorMessage = strReason;
+
+  if (itm->state().isConnected && itm->state().vnc && !itm->state().hasDisconnectRequest)
+    itm->state().vnc->endViewer();
+  else if (itm->state().isConnecting && !itm->state().threadRFBRunning)
+    // stops createVNCObject waiting for the forward
+    itm->state().hasError = true;
+}
+
+
+/*  deal with an ssh process that has exited  */
+static void svSSHChildExited (pid_t pid, int nStatus, SVSSHChild& child)
+{
+  // nobody depends on it any more, so it was closed on purpose
+  std::unordered_map<unsigned int, SVSSHMaster>::iterator itMaster = m_sshMasters.find(child.nMasterId);
+  bool isMaster = itMaster != m_sshMasters.end() && itMaster->second.sshPid == pid;
+
+  if (!child.itm && !isMaster)
+    return;
+
+  std::string strReason = "SSH exited";
+
+  if (WIFEXITED(nStatus))
+    strReason += " with status " + std::to_string(WEXITSTATUS(nStatus));
+  else if (WIFSIGNALED(nStatus))
+    strReason += " on signal " + std::to_string(WTERMSIG(nStatus));
+
+  // the last thing ssh complained about is usually the useful part
+  std::string strStderr = child.strStderr;
+
+  while (!strStderr.empty() && (strStderr.back() == '\n' || strStderr.back() == '\r'))
+    strStderr.pop_back();
+
+  size_t nLineStart = strStderr.find_last_of('\n');
+
+  if (nLineStart != std::string::npos)
+    strStderr.erase(0, nLineStart + 1);
+
+  if (!strStderr.empty())
+    strReason += " - " + strStderr;
+
+  if (child.itm)
+  {
+    svLogToFile("SSH tunnel for '" + child.itm->name + "' - " + child.itm->hostAddress + " ended.  " + strReason);
+    svSSHTunnelLost(child.itm, strReason);
+  }
+
+  if (isMaster)
+  {
+    svLogToFile("Shared SSH connection to " + itMaster->second.strKey + " ended.  " + strReason);
+
+    if (itMaster->second.sshCmdStream)
+      fclose(itMaster->second.sshCmdStream);
+
+    m_sshMasters.erase(itMaster);
+
+    // every host forwarding through it, or waiting for it to start, has lost its tunnel
+    int nSize = app->hostList->size();
+
+    for (int i = 0; i <= nSize; i ++)
+    {
+      HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
+
+      if (itm && itm->sshMasterId == child.nMasterId)
+      {
+        itm->sshMasterId = 0;
+        itm->sshMultiplexed = false;
+
+        svSSHTunnelLost(itm, strReason);
+      }
+    }
+  }
+}
+
+
+/*
+  reap any of our ssh processes that have exited
+  (fd callback for the SIGCHLD pipe)
+*/
+static void svSSHChildSignal (int nFd, void *)
+{
+  char strBuf[64];
+
+  while (read(nFd, strBuf, sizeof(strBuf)) > 0)
+    continue;
+
+  // only our own pids are waited on, so popen / pclose elsewhere still work
+  std::vector<std::pair<pid_t, int>> exited;
+
+  for (const std::pair<const pid_t, SVSSHChild> & child : m_sshChildren)
+  {
+    int nStatus = 0;
+
+    if (waitpid(child.first, &nStatus, WNOHANG) == child.first)
+      exited.push_back(std::make_pair(child.first, nStatus));
+  }
+
+  for (const std::pair<pid_t, int> & ex : exited)
+  {
+    std::unordered_map<pid_t, SVSSHChild>::iterator it = m_sshChildren.find(ex.first);
+
+    if (it == m_sshChildren.end())
+      continue;
+
+    // pick up anything ssh said on its way out
+    if (it->second.nStderrFd >= 0)
+      svSSHStderrReady(it->second.nStderrFd, reinterpret_cast<void *>(static_cast<intptr_t>(ex.first)));
+
+    if (it->second.nStderrFd >= 0)
+    {
+      Fl::remove_fd(it->second.nStderrFd);
+      close(it->second.nStderrFd);
+    }
+
+    SVSSHChild child = it->second;
+    m_sshChildren.erase(it);
+
+    svSSHChildExited(ex.first, ex.second, child);
+  }
+}
+
+
+/*  mark a file descriptor close-on-exec so other children don't inherit it  */
+static void svSetCloseOnExec (int nFd)
+{
+  fcntl(nFd, F_SETFD, fcntl(nFd, F_GETFD) | FD_CLOEXEC);
+}
+
+
+/*
+  start an ssh command line with a pipe on its stdin and stderr, watched
+  by the event loop so its exit is noticed right away
+  (returns the pid, or -1)
+*/
+static pid_t svSSHSpawn (const std::string& strCmdLine, HostItem * itm, unsigned int nMasterId,
+  FILE ** sshCmdStream)
+{
+  // watch for children exiting, the first time through
+  if (m_sigChildPipe[0] < 0)
+  {
+    if (pipe(m_sigChildPipe) != 0)
+    {
+      svLogToFile("ERROR - Could not create the SSH supervisor pipe");
+      return -1;
+    }
+
+    for (int nFd : m_sigChildPipe)
+    {
+      svSetCloseOnExec(nFd);
+      fcntl(nFd, F_SETFL, fcntl(nFd, F_GETFL) | O_NONBLOCK);
+    }
+
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = svSigChildHandler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+
+    sigaction(SIGCHLD, &sa, NULL);
+
+    Fl::add_fd(m_sigChildPipe[0], FL_READ, svSSHChildSignal);
+  }
+
+  int inPipe[2];
+  int errPipe[2];
+
+  if (pipe(inPipe) != 0)
+    return -1;
+
+  if (pipe(errPipe) != 0)
+  {
+    close(inPipe[0]);
+    close(inPipe[1]);
+
+    return -1;
+  }
+
+  svSetCloseOnExec(inPipe[0]);
+  svSetCloseOnExec(inPipe[1]);
+  svSetCloseOnExec(errPipe[0]);
+  svSetCloseOnExec(errPipe[1]);
+
+  posix_spawn_file_actions_t actions;
+
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, inPipe[0], STDIN_FILENO);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+  posix_spawn_file_actions_adddup2(&actions, errPipe[1], STDERR_FILENO);
+
+  // exec, so the pid we get is ssh's and not the shell's
+  std::string strShellCmd = "exec " + strCmdLine;
+  char * argv[] = {const_cast<char *>("/bin/sh"), const_cast<char *>("-c"),
+    const_cast<char *>(strShellCmd.c_str()), NULL};
+
+  pid_t pid = -1;
+  int nErr = posix_spawn(&pid, "/bin/sh", &actions, NULL, argv, environ);
+
+  posix_spawn_file_actions_destroy(&actions);
+
+  close(inPipe[0]);
+  close(errPipe[1]);
+
+  if (nErr != 0)
+  {
+    svLogToFile("ERROR - Could not start SSH - " + std::string(strerror(nErr)));
+
+    close(inPipe[1]);
+    close(errPipe[0]);
+
+    return -1;
+  }
+
+  fcntl(errPipe[0], F_SETFL, fcntl(errPipe[0], F_GETFL) | O_NONBLOCK);
+
+  SVSSHChild child;
+  child.itm = itm;
+  child.nMasterId = nMasterId;
+  child.nStderrFd = errPipe[0];
+
+  m_sshChildren[pid] = child;
+
+  Fl::add_fd(errPipe[0], FL_READ, svSSHStderrReady, reinterpret_cast<void *>(static_cast<intptr_t>(pid)));
+
+  *sshCmdStream = fdopen(inPipe[1], "w");
+
+  return pid;
+}
+
+
+/*  stop tracking an ssh process on behalf of an itm that's done with it  */
+static void svSSHDetachChild (pid_t pid)
+{
+  std::unordered_map<pid_t, SVSSHChild>::iterator it = m_sshChildren.find(pid);
+
+  if (it != m_sshChildren.end())
+  {
+    it->second.itm = NULL;
+    it->second.nMasterId = 0;
+  }
+}
+
+
+/*
+  return our private socket directory, creating it the first time
+  (m_reservedPortsMutex must be held)
+*/
+static std::string svSSHSocketDir ()
+{
+  if (m_strSocketDir.empty())
+  {
+    char strTemplate[] = "/tmp/spiritvnc-XXXXXX";
+
+    if (mkdtemp(strTemplate))
+      m_strSocketDir = strTemplate;
+    else
+      svLogToFile("ERROR - Could not create the directory for SSH sockets");
+  }
+
+  return m_strSocketDir;
+}
+
+
+/*  return the -L forwarding spec for the itm's local port or socket file  */
+static std::string svSSHForwardSpec (const HostItem * itm)
+{
+  if (!itm->sshLocalSocket.empty())
+    return itm->sshLocalSocket + ":127.0.0.1:" + itm->vncPort;
+
+  return std::to_string(itm->sshLocalPort) + ":127.0.0.1:" + itm->vncPort;
+}
+
+
+/*
+  send a control command (forward, cancel, exit...) to a master connection
+  (returns true if ssh says it worked)
+*/
+static bool svSSHControlCommand (const std::string& strControlPath, const std::string& strTarget,
+  const std::string& strCommand)
+{
+  std::string strCmdLine = app->sshCommand + " -o ControlPath=" + strControlPath + " " + strCommand +
+    " " + strTarget + " 2>/dev/null";
+
+  FILE * fCmd = popen(strCmdLine.c_str(), "r");
+
+  if (!fCmd)
+    return false;
+
+  return pclose(fCmd) == 0;
+}
+
+
+/*
+  check whether a master connection has finished connecting and
+  accepts control commands yet
+*/
+static bool svSSHMasterIsReady (SVSSHMaster& master)
+{
+  if (master.isReady)
+    return true;
+
+  // ssh only creates the control socket once it's logged in
+  struct stat st;
+
+  if (stat(master.strControlPath.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode))
+    return false;
+
+  master.isReady = svSSHControlCommand(master.strControlPath, master.strTarget, "-O check");
+
+  return master.isReady;
+}
+
+
+/*  tell a master connection to exit and forget about it  */
+static void svSSHMasterStop (unsigned int nMasterId)
+{
+  std::unordered_map<unsigned int, SVSSHMaster>::iterator it = m_sshMasters.find(nMasterId);
+
+  if (it == m_sshMasters.end())
+    return;
+
+  if (svSSHMasterIsReady(it->second))
+    svSSHControlCommand(it->second.strControlPath, it->second.strTarget, "-O exit");
+
+  // in case it didn't listen
+  svSSHDetachChild(it->second.sshPid);
+
+  if (it->second.sshCmdStream)
+    fclose(it->second.sshCmdStream);
+
+  kill(it->second.sshPid, SIGTERM);
+
+  m_sshMasters.erase(it);
+}
+
+
+/*
+  join the running master connection to the itm's ssh server, if there is
+  one (the forward is added by svSSHForwardIsReady once the master is up,
+  as it may still be logging in)
+  (returns false if there is no master for the itm's server)
+*/
+static bool svSSHMasterJoin (HostItem * itm)
+{
+  std::string strKey = itm->sshUser + "@" + itm->hostAddress + ":" + itm->sshPort;
+
+  for (std::pair<const unsigned int, SVSSHMaster> & master : m_sshMasters)
+  {
+    if (master.second.strKey != strKey)
+      continue;
+
+    master.second.nRefs ++;
+
+    itm->sshMasterId = master.first;
+    itm->sshMultiplexed = true;
+    itm->state().sshReady = false;
+
+    return true;
+  }
+
+  return false;
+}
+
+
+/*
+  add a joined itm's forward to its master connection once the master is up
+  (returns true when the forward is in place)
+*/
+static bool svSSHMasterAddForward (HostItem * itm)
+{
+  std::unordered_map<unsigned int, SVSSHMaster>::iterator it = m_sshMasters.find(itm->sshMasterId);
+
+  // gone already, svSSHChildExited told the itm
+  if (it == m_sshMasters.end())
+    return false;
+
+  if (!svSSHMasterIsReady(it->second))
+    return false;
+
+  if (!svSSHControlCommand(it->second.strControlPath, it->second.strTarget,
+    "-O forward -L " + svSSHForwardSpec(itm)))
+  {
+    // only this itm's forward failed, the master stays up for everyone else
+    svLogToFile("ERROR - Could not add forward for '" + itm->name + "' to shared SSH connection " +
+      it->second.strKey);
+
+    itm->lastErrorMessage = "Could not add SSH forward";
+    itm->state().hasError = true;
+
+    return false;
+  }
+
+  itm->state().sshReady = true;
+
+  return true;
+}
+
+
+/*
+  remove the itm's forward from its master connection, stopping the
+  master if nothing else is using it
+  (returns false if the itm isn't using a master connection)
+*/
+static bool svSSHMasterRelease (HostItem * itm)
+{
+  if (itm->sshMasterId == 0)
+    return false;
+
+  std::unordered_map<unsigned int, SVSSHMaster>::iterator it = m_sshMasters.find(itm->sshMasterId);
+
+  if (it != m_sshMasters.end())
+  {
+    if (itm->state().sshReady && svSSHMasterIsReady(it->second))
+      svSSHControlCommand(it->second.strControlPath, it->second.strTarget,
+        "-O cancel -L " + svSSHForwardSpec(itm));
+
+    it->second.nRefs --;
+
+    if (it->second.nRefs <= 0)
+      svSSHMasterStop(it->first);
+  }
+
+  itm->sshMasterId = 0;
+  itm->sshMultiplexed = false;
+  itm->state().sshReady = false;
+
+  return true;
+}
+#endif
+
+
+/*
+  check that nothing else on this computer is using a local port
+  (a fresh socket is used for every check)
+*/
+static bool svLocalPortIsFree (int nPort)
+{
+  struct sockaddr_in structSockAddress;
+
+  memset(&structSockAddress, 0, sizeof(structSockAddress));
+  structSockAddress.sin_family = AF_INET;
+  structSockAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  structSockAddress.sin_port = htons(static_cast<unsigned short>(nPort));
+
+  int nSock = socket(AF_INET, SOCK_STREAM, 0);
+  if (nSock < 0)
+  {
+    svLogToFile("ERROR - Cannot create socket to check local port " + std::to_string(nPort));
+    return false;
+  }
+
+  bool isFree = bind(nSock, reinterpret_cast<sockaddr *>(&structSockAddress), sizeof(structSockAddress)) == 0;
+
+  close(nSock);
+
+  return isFree;
+}
+
+
+/*
+  give the itm's ssh connection somewhere local to forward vnc to,
+  either a private socket file or a port reserved in our table
+  (returns false if nothing is available)
+*/
+bool svReserveSSHForward (void * itmData)
+{
+  HostItem * itm = static_cast<HostItem *>(itmData);
+
+  if (!itm)
+    return false;
+
+  // let go of anything left over from the last connection
+  svReleaseSSHForward(itm);
+
+  pthread_mutex_lock(&m_reservedPortsMutex);
+
+  #ifndef _WIN32
+  if (app->sshUnixSockets)
+  {
+    std::string strSocketDir = svSSHSocketDir();
+
+    if (!strSocketDir.empty())
+    {
+      itm->sshLocalSocket = strSocketDir + "/vnc-" + std::to_string(m_nNextSocketId ++) + ".sock";
+
+      pthread_mutex_unlock(&m_reservedPortsMutex);
+
+      return true;
+    }
+  }
+  #endif
+
+  int nRange = app->nLocalPortRange;
+
+  // don't go past the last port number
+  if (nRange > 65536 - app->nStartingLocalPort)
+    nRange = 65536 - app->nStartingLocalPort;
+
+  if (nRange < 1)
+    nRange = 1;
+
+  // keep going around the range instead of starting at the bottom every
+  // time, so a just-closed tunnel's port gets a chance to settle
+  for (int n = 0; n < nRange; n ++)
+  {
+    int nOffset = (m_nNextPortOffset + n) % nRange;
+    int nPort = app->nStartingLocalPort + nOffset;
+
+    // don't clobber the listening port
+    if (nPort == SV_LISTEN_PORT)
+      continue;
+
+    // already handed out to another connection
+    if (m_reservedPorts.find(nPort) != m_reservedPorts.end())
+      continue;
+
+    if (!svLocalPortIsFree(nPort))
+      continue;
+
+    m_reservedPorts[nPort] = itm;
+    m_nNextPortOffset = nOffset + 1;
+
+    itm->sshLocalPort = nPort;
+
+    pthread_mutex_unlock(&m_reservedPortsMutex);
+
+    return true;
+  }
+
+  pthread_mutex_unlock(&m_reservedPortsMutex);
+
+  svLogToFile("ERROR - No free local port for SSH forwarding of '" + itm->name + "' - " + itm->hostAddress);
+
+  return false;
+}
+
+
+/*  give back the itm's local forwarding port or socket file  */
+void svReleaseSSHForward (void * itmData)
+{
+  HostItem * itm = static_cast<HostItem *>(itmData);
+
+  if (!itm)
+    return;
+
+  pthread_mutex_lock(&m_reservedPortsMutex);
+
+  std::unordered_map<int, const HostItem *>::iterator it = m_reservedPorts.find(itm->sshLocalPort);
+
+  if (it != m_reservedPorts.end() && it->second == itm)
+    m_reservedPorts.erase(it);
+
+  itm->sshLocalPort = 0;
+
+  #ifndef _WIN32
+  if (!itm->sshLocalSocket.empty())
+  {
+    unlink(itm->sshLocalSocket.c_str());
+    itm->sshLocalSocket.clear();
+  }
+  #endif
+
+  pthread_mutex_unlock(&m_reservedPortsMutex);
+}
+
 
 /*
   attempts to close the popen'd ssh process
@@ -61,7 +745,7 @@ void * svSSHCloseHelper (void * itmData)
   // close the ssh process stream
   pclose(itm->sshCmdStream);
 
-  itm->sshReady = false;
+  itm->state().sshReady = false;
 
   return SV_RET_VOID;
 }
@@ -72,7 +756,44 @@ void svCloseSSHConnection (void * itmData)
 {
   HostItem * itm = static_cast<HostItem *>(itmData);
 
-  if (!itm || !itm->sshCmdStream)
+  if (!itm)
+    return;
+
+  #ifndef _WIN32
+  // a shared master connection only loses this itm's forward
+  if (svSSHMasterRelease(itm))
+  {
+    svReleaseSSHForward(itm);
+
+    itm->state().isConnecting = false;
+    svHandleThreadConnection(itm);
+
+    return;
+  }
+  #endif
+
+  // the forwarding port / socket can go to the next connection
+  svReleaseSSHForward(itm);
+
+  #ifndef _WIN32
+  if (itm->sshPid <= 0)
+    return;
+
+  // closing on purpose, so the supervisor shouldn't treat the exit as a lost tunnel
+  svSSHDetachChild(itm->sshPid);
+
+  if (itm->sshCmdStream)
+  {
+    fclose(itm->sshCmdStream);
+    itm->sshCmdStream = NULL;
+  }
+
+  kill(itm->sshPid, SIGTERM);
+
+  itm->sshPid = 0;
+  itm->state().sshReady = false;
+  #else
+  if (!itm->sshCmdStream)
     return;
 
   // create, launch and detach call to create our vnc connection
@@ -80,12 +801,13 @@ void svCloseSSHConnection (void * itmData)
   {
     svLogToFile("ERROR - Couldn't create SSH closer thread for '" + itm->name +
           "' - " + itm->hostAddress);
-    //itm->isConnecting = false;
-    itm->hasCouldntConnect = true;
-    itm->hasError = true;
+    //itm->state().isConnecting = false;
+    itm->state().hasCouldntConnect = true;
+    itm->state().hasError = true;
   }
+  #endif
 
-  itm->isConnecting = false;
+  itm->state().isConnecting = false;
   svHandleThreadConnection(itm);
 }
 
@@ -130,33 +852,201 @@ void svCreateSSHConnection (void * data)
 
     itm->lastErrorMessage = "SSH command not working";
 
-    itm->sshReady = false;
-    itm->hasError = true;
+    itm->state().sshReady = false;
+    itm->state().hasError = true;
+
+    return;
+  }
+
+  itm->sshMultiplexed = false;
 
+  #ifndef _WIN32
+  // reuse a running (or starting) master connection to the same ssh server,
+  // skipping the handshake
+  if (app->sshControlMaster && svSSHMasterJoin(itm))
     return;
+  #endif
+
+  // forward from our reserved local port or socket file
+  #ifdef _WIN32
+  std::string strForward = " -L " + std::to_string(itm->sshLocalPort) + ":127.0.0.1:" + itm->vncPort;
+  #else
+  std::string strForward = " -L " + svSSHForwardSpec(itm);
+
+  if (!itm->sshLocalSocket.empty())
+    strForward = " -o StreamLocalBindUnlink=yes" + strForward;
+  #endif
+
+  // interactive session closed with '~.' by svSSHCloseHelper
+  std::string strSession = " -t -t";
+
+  #ifndef _WIN32
+  // start a master connection other hosts on this ssh server can share
+  std::string strKey = itm->sshUser + "@" + itm->hostAddress + ":" + itm->sshPort;
+  std::string strControlPath;
+
+  if (app->sshControlMaster)
+  {
+    pthread_mutex_lock(&m_reservedPortsMutex);
+    std::string strSocketDir = svSSHSocketDir();
+
+    if (!strSocketDir.empty())
+      strControlPath = strSocketDir + "/cm-" + std::to_string(m_nNextSocketId ++);
+
+    pthread_mutex_unlock(&m_reservedPortsMutex);
   }
 
+  // masters have no session and are closed with '-O exit' instead
+  if (!strControlPath.empty())
+    strSession = " -N -o ControlMaster=yes -o ControlPath=" + strControlPath;
+  #endif
+
   // build the command string for our system() call
-  sshCommandLine = app->sshCommand + " " + itm->sshUser + "@" + itm->hostAddress + " -t" + " -t" +
+  // (ExitOnForwardFailure makes ssh quit if something else grabbed the port first)
+  sshCommandLine = app->sshCommand + " " + itm->sshUser + "@" + itm->hostAddress + strSession +
     " -p " + itm->sshPort + " -o ConnectTimeout=" + std::to_string(itm->sshWaitTime) +
-    " -L " + std::to_string(itm->sshLocalPort) + ":127.0.0.1:" + itm->vncPort +
+    " -o ExitOnForwardFailure=yes" + strForward +
     " -i " + itm->sshKeyPrivate;
 
+  #ifndef _WIN32
+  // start ssh under supervision, so its exit is noticed right away
+  // (it's ready once svSSHForwardIsReady sees the forward listening)
+  FILE * sshCmdStream = NULL;
+  bool isMaster = !strControlPath.empty();
+  unsigned int nMasterId = isMaster ? m_nNextMasterId ++ : 0;
+  pid_t pid = svSSHSpawn(sshCommandLine, isMaster ? NULL : itm, nMasterId, &sshCmdStream);
+
+  itm->state().sshReady = false;
+
+  if (pid < 0)
+  {
+    svLogToFile("SSH connection disconnected abnormally from '"
+        + itm->name + "' - " + itm->hostAddress);
+
+    itm->state().hasError = true;
+
+    return;
+  }
+
+  // the master's process belongs to the master table, not to this itm
+  if (isMaster)
+  {
+    SVSSHMaster master;
+    master.strKey = strKey;
+    master.strTarget = itm->sshUser + "@" + itm->hostAddress;
+    master.strControlPath = strControlPath;
+    master.sshCmdStream = sshCmdStream;
+    master.sshPid = pid;
+    master.nRefs = 1;
+    master.isReady = false;
+
+    m_sshMasters[nMasterId] = master;
+
+    // (its forward is on the master's own command line)
+    itm->sshMasterId = nMasterId;
+  }
+  else
+  {
+    itm->sshCmdStream = sshCmdStream;
+    itm->sshPid = pid;
+  }
+  #else
   // call the system's ssh client, if available and open write stream
   itm->sshCmdStream = popen(sshCommandLine.c_str(), "w");
 
   if (itm->sshCmdStream)
     // ssh started okay
-    itm->sshReady = true;
+    itm->state().sshReady = true;
   else
   {
     // something -- happened
     svLogToFile("SSH connection disconnected abnormally from '"
         + itm->name + "' - " + itm->hostAddress);
 
-    itm->sshReady = false;
-    itm->hasError = true;
+    itm->state().sshReady = false;
+    itm->state().hasError = true;
   }
+  #endif
 
   return;
 }
+
+
+/*
+  check whether the itm's ssh forward is accepting connections yet,
+  setting sshReady once it is
+  (Windows can't tell, so callers wait out sshWaitTime there)
+*/
+bool svSSHForwardIsReady (void * itmData)
+{
+  HostItem * itm = static_cast<HostItem *>(itmData);
+
+  if (!itm)
+    return false;
+
+  #ifdef _WIN32
+  return false;
+  #else
+  if (itm->state().sshReady)
+    return true;
+
+  // joined a shared master connection, so add the forward once it's up
+  if (itm->sshMultiplexed)
+    return svSSHMasterAddForward(itm);
+
+  bool isListening = false;
+
+  // ssh holds the socket file or our reserved port once its forward is up
+  if (!itm->sshLocalSocket.empty())
+  {
+    struct stat st;
+    isListening = stat(itm->sshLocalSocket.c_str(), &st) == 0 && S_ISSOCK(st.st_mode);
+  }
+  else if (itm->sshLocalPort > 0)
+    isListening = !svLocalPortIsFree(itm->sshLocalPort);
+
+  if (isListening)
+    itm->state().sshReady = true;
+
+  return isListening;
+  #endif
+}
+
+
+/*
+  remove our private socket directory and anything left in it
+  (called when the program shuts down, after the viewers have ended)
+*/
+void svSSHRemoveSocketDir ()
+{
+  #ifndef _WIN32
+  pthread_mutex_lock(&m_reservedPortsMutex);
+
+  if (!m_strSocketDir.empty())
+  {
+    DIR * dir = opendir(m_strSocketDir.c_str());
+
+    if (dir)
+    {
+      const struct dirent * entry;
+
+      while ((entry = readdir(dir)) != NULL)
+      {
+        std::string strName = entry->d_name;
+
+        if (strName != "." && strName != "..")
+          unlink((m_strSocketDir + "/" + strName).c_str());
+      }
+
+      closedir(dir);
+    }
+
+    if (rmdir(m_strSocketDir.c_str()) != 0)
+      svLogToFile("ERROR - Could not remove the directory for SSH sockets");
+
+    m_strSocketDir.clear();
+  }
+
+  pthread_mutex_unlock(&m_reservedPortsMutex);
+  #endif
+}
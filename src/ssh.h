@@ -38,5 +38,9 @@
 void svCloseSSHConnection (void *);
 void * svSSHCloseHelper (void *);
 void svCreateSSHConnection (void *);
+void svReleaseSSHForward (void *);
+bool svReserveSSHForward (void *);
+bool svSSHForwardIsReady (void *);
+void svSSHRemoveSocketDir ();
 
 #endif
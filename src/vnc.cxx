@@ -35,16 +35,64 @@
 #include "app.h"
 #include "consts_enums.h"
 #include "vnc.h"
+#include <atomic>
+#include <zlib.h>
 
 /* pointer for libvncclient's setclientdata and getclientdata */
 void * m_vncObjPtr = reinterpret_cast<void *>(0x777);
 
+/* background decode thread state */
+/* (m_decodeMutex guards the displayed viewer while the thread handles its messages) */
+static pthread_mutex_t m_decodeMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t m_decodeThread;
+static std::atomic<bool> m_decodeThreadRunning(false);
+static std::atomic<bool> m_redrawPending(false);
+static std::atomic<const VncObject *> m_freshFrameVnc(NULL);
 
-/* create a listening vnc obect */
-/* (static method) */
+/* cursor shape copied out of a libvncclient callback for the main thread */
+struct SVCursorShape
+{
+  VncObject * vnc;
+  std::vector<uchar> pixels;
+  int nWidth;
+  int nHeight;
+  int nDepth;
+  int xHot;
+  int yHot;
+};
+
+/* remote clipboard text copied out of a libvncclient callback for the main thread */
+struct SVRemoteClipboard
+{
+  const VncObject * vnc;
+  std::string text;
+};
+
+
+/*
+  whether vnc still belongs to a connected host item
+  (for Fl::awake callbacks whose viewer may have ended since)
+*/
+static bool svVncObjectIsLive (const VncObject * vnc)
+{
+  for (uint32_t nId : app->activeIds)
+  {
+    if (svHostState(nId).vnc == vnc)
+      return true;
+  }
+
+  return false;
+}
+
+
+/*
+  create the 'Listening' host list item and start accepting reverse
+  connections, each of which gets its own listening viewer
+  (static method)
+*/
 void VncObject::createVNCListener ()
 {
-  HostItem * itm = new HostItem();
+  HostItem * itm = svHostItemNew();
   if (!itm)
   {
     fl_beep(FL_BEEP_DEFAULT);
@@ -55,17 +103,72 @@ void VncObject::createVNCListener ()
   itm->name = "Listening";
   itm->scaling = 'f';
   itm->showRemoteCursor = true;
-  itm->isListener = true;
+  itm->state().isListener = true;
 
   // set host list status icon
-  itm->icon = app->iconDisconnected;
+  itm->state().icon = app->iconDisconnected;
 
   app->hostList->add("Listening", itm);
-  app->hostList->icon(app->hostList->size(), itm->icon);
+  app->hostList->icon(app->hostList->size(), itm->state().icon);
   app->hostList->bottomline(app->hostList->size());
 
   app->hostList->redraw();
 
+  svSearchIndexUpdate(itm);
+  svSearchFilterHostList(true);
+
+  #ifdef _WIN32
+  // windows keeps libvncclient's own one-at-a-time listener
+  VncObject::createVNCObject(itm);
+  #else
+  if (!svListenerStart(itm))
+  {
+    svSearchIndexRemove(itm);
+    app->hostList->remove(app->hostList->size());
+    app->hostList->redraw();
+
+    delete itm;
+
+    fl_beep(FL_BEEP_DEFAULT);
+    svMessageWindow("Error: Could not listen for reverse VNC connections on port " +
+      std::to_string(SV_LISTEN_PORT), "SpiritVNC - FLTK");
+  }
+  #endif
+}
+
+
+/*
+  create a listening viewer for one reverse connection the
+  listener has already accepted
+  (static method)
+*/
+void VncObject::createVNCReverseConnection (int nSock, const std::string& strPeer)
+{
+  HostItem * itm = svHostItemNew();
+  if (!itm)
+  {
+    close(nSock);
+    return;
+  }
+
+  itm->name = "Listening - " + strPeer;
+  itm->hostAddress = strPeer;
+  itm->scaling = 'f';
+  itm->showRemoteCursor = true;
+  itm->state().isListener = true;
+  itm->state().listenSock = nSock;
+
+  // set host list status icon
+  itm->state().icon = app->iconDisconnected;
+
+  app->hostList->add(itm->name.c_str(), itm);
+  app->hostList->icon(app->hostList->size(), itm->state().icon);
+
+  app->hostList->redraw();
+
+  svSearchIndexUpdate(itm);
+  svSearchFilterHostList(true);
+
   VncObject::createVNCObject(itm);
 }
 
@@ -77,22 +180,98 @@ void VncObject::cleanupVNCObject (HostItem * itm)
   if (!itm)
     return;
 
-  itm->vncNeedsCleanup = false;
+  itm->state().vncNeedsCleanup = false;
+
+  // an accepted reverse connection that never reached its viewer
+  if (itm->state().listenSock >= 0)
+  {
+    close(itm->state().listenSock);
+    itm->state().listenSock = -1;
+  }
 
   // clean up client structure
-  if (itm->vnc)
+  if (itm->state().vnc)
   {
+    // wait for the decode thread to finish with this object, if it's using it
+    pthread_mutex_lock(&m_decodeMutex);
+
     // do client cleanup first
-    if (itm->vnc->vncClient && itm->initOkay)
-      rfbClientCleanup(itm->vnc->vncClient);
+    // (the framebuffer belongs to itm, so libvncclient must not see it)
+    if (itm->state().vnc->vncClient && itm->state().initOkay)
+    {
+      itm->state().vnc->vncClient->frameBuffer = NULL;
+      rfbClientCleanup(itm->state().vnc->vncClient);
+    }
+
+    // listening items never reconnect and suspended items keep a compressed
+    // copy instead, so their framebuffer can go back to the pool; everyone
+    // else keeps theirs for a while in case they reconnect
+    if (itm->state().isListener || itm->state().isSuspended)
+      svFrameBufferRelease(itm);
+
+    // stop any paced key batch still being sent
+    Fl::remove_timeout(VncObject::handleKeyBatchTimer, itm->state().vnc);
 
     // delete and null VncObject
-    delete itm->vnc;
-    itm->vnc = NULL;
+    delete itm->state().vnc;
+    itm->state().vnc = NULL;
+
+    svFrameBufferKeep(itm);
+
+    svActiveRemove(itm);
+
+    pthread_mutex_unlock(&m_decodeMutex);
+  }
+}
+
+
+/*
+  convert low colour depth (8 / 16 bpp) pixels from the client's
+  framebuffer into packed 24-bit RGB for drawing
+  (instance method)
+*/
+void VncObject::convertToRGB (const uint8_t * src, uchar * dst, int nPixels) const
+{
+  const rfbPixelFormat * fmt = &this->vncClient->format;
+
+  for (int i = 0; i < nPixels; i ++)
+  {
+    uint16_t nPixel = src[0];
+
+    if (fmt->bitsPerPixel == 16)
+    {
+      nPixel |= (src[1] << 8);
+      src += 2;
+    }
+    else
+      src ++;
+
+    dst[0] = this->colorScale[0][(nPixel >> fmt->redShift) & fmt->redMax];
+    dst[1] = this->colorScale[1][(nPixel >> fmt->greenShift) & fmt->greenMax];
+    dst[2] = this->colorScale[2][(nPixel >> fmt->blueShift) & fmt->blueMax];
+    dst += 3;
   }
 }
 
 
+/*
+  add a key down / up event to this object's key batch
+  (call sendKeyBatch to send the batch to the host)
+  (instance method)
+*/
+void VncObject::addKeyToBatch (uint32_t nKey, bool downState)
+{
+  rfbKeyEventMsg ke;
+
+  memset(&ke, 0, sizeof(ke));
+  ke.type = rfbKeyEvent;
+  ke.down = downState ? 1 : 0;
+  ke.key = htonl(nKey);
+
+  this->keyBatch.push_back(ke);
+}
+
+
 /*
   initializes and attempts connection with
   libvnc client / VncObject object
@@ -101,7 +280,7 @@ void VncObject::cleanupVNCObject (HostItem * itm)
 void VncObject::createVNCObject (HostItem * itm)
 {
   // if itm is null or our viewer is already created, return
-  if (!itm || itm->isConnected || itm->isConnecting)
+  if (!itm || itm->state().isConnected || itm->state().isConnecting)
   {
     fl_beep(FL_BEEP_DEFAULT);
     svMessageWindow("Error: Could not create VNC connection", "SpiritVNC - FLTK");
@@ -112,23 +291,25 @@ void VncObject::createVNCObject (HostItem * itm)
   if (itm->hostType == 'v' || itm->hostType == 's')
   {
     // just in case it wasn't done already
-    if (itm->vncNeedsCleanup)
+    if (itm->state().vncNeedsCleanup)
       VncObject::cleanupVNCObject(itm);
 
     // create new vnc object
-    itm->vnc = new VncObject();
-    if (!itm->vnc || !itm->vnc->vncClient)
+    itm->state().vnc = new VncObject();
+    if (!itm->state().vnc || !itm->state().vnc->vncClient)
     {
       fl_beep(FL_BEEP_DEFAULT);
       return;
     }
 
     // no, this isn't confusing at all! :-P
-    VncObject * vnc = itm->vnc;
+    VncObject * vnc = itm->state().vnc;
     vnc->itm = itm;
 
+    svActiveAdd(itm);
+
     // address is missing on non-listening itm
-    if (!itm->isListener && itm->hostAddress.empty())
+    if (!itm->state().isListener && itm->hostAddress.empty())
     {
       fl_beep(FL_BEEP_DEFAULT);
       std::string strAddErr = itm->name + " - Error: Host address is missing";
@@ -137,15 +318,18 @@ void VncObject::createVNCObject (HostItem * itm)
     }
 
     // reset itm state flags
-    itm->isConnecting = true;
-    itm->isConnected = false;
-    itm->isWaitingForShow = false;
-    itm->hasCouldntConnect = false;
-    itm->hasError = false;
-    itm->hasDisconnectRequest = false;
-    itm->initOkay = false;
+    itm->state().isConnecting = true;
+    itm->state().isConnected = false;
+    itm->state().isWaitingForShow = false;
+    itm->state().hasCouldntConnect = false;
+    itm->state().hasError = false;
+    itm->state().hasDisconnectRequest = false;
+    itm->state().initOkay = false;
     itm->lastErrorMessage = "";
 
+    // a connect (manual or automatic) replaces any pending automatic reconnect
+    itm->state().reconnectTime = 0;
+
     // store this viewer pointer in libvnc client data
     rfbClientSetClientData(vnc->vncClient, m_vncObjPtr, vnc);
 
@@ -166,6 +350,9 @@ void VncObject::createVNCObject (HostItem * itm)
     vnc->vncClient->appData.qualityLevel = itm->qualityLevel;
     vnc->vncClient->appData.encodingsString = "tight copyrect hextile";
 
+    // set up pixel format for this host's colour depth
+    vnc->setColorDepth(itm->colorDepth);
+
     itm->vncAddressAndPort = itm->hostAddress + ":" + itm->vncPort;
 
     // add to viewers waiting ref count
@@ -174,8 +361,8 @@ void VncObject::createVNCObject (HostItem * itm)
     svLogToFile("Attempting to connect to '" + itm->name + "' - " + itm->hostAddress);
 
     // set host list item status icon
-    itm->icon = app->iconConnecting;
-    Fl::awake(svHandleListItemIconChange);
+    itm->state().icon = app->iconConnecting;
+    Fl::awake(svHandleListItemIconChange, itm);
 
     // ############  SSH CONNECTION ###############################################
 
@@ -188,9 +375,9 @@ void VncObject::createVNCObject (HostItem * itm)
       std::ifstream keyStream(itm->sshKeyPrivate);
       if (!keyStream.is_open())
       {
-        itm->isConnecting = false;
-        itm->hasCouldntConnect = true;
-        itm->hasError = true;
+        itm->state().isConnecting = false;
+        itm->state().hasCouldntConnect = true;
+        itm->state().hasError = true;
 
         svLogToFile("ERROR - Could not open the private SSH key file");
         svMessageWindow("Error: Could not open the private SSH key "
@@ -201,9 +388,27 @@ void VncObject::createVNCObject (HostItem * itm)
         return;
       }
 
-      itm->sshLocalPort = svFindFreeTcpPort();
+      // get a local port or socket file for ssh to forward vnc to
+      if (!svReserveSSHForward(itm))
+      {
+        itm->state().isConnecting = false;
+        itm->state().hasCouldntConnect = true;
+        itm->state().hasError = true;
+        itm->lastErrorMessage = "No free local port for SSH forwarding";
+
+        svMessageWindow("Error: No free local port for SSH forwarding of '" + itm->name +
+          "'\n\nTry raising the local SSH port range in the app options");
+
+        svHandleThreadConnection(itm);
+
+        return;
+      }
 
-      itm->vncAddressAndPort = "127.0.0.1:" + std::to_string(itm->sshLocalPort);
+      // libvncclient connects to a socket file when given its path
+      if (!itm->sshLocalSocket.empty())
+        itm->vncAddressAndPort = itm->sshLocalSocket;
+      else
+        itm->vncAddressAndPort = "127.0.0.1:" + std::to_string(itm->sshLocalPort);
 
       svDebugLog("svCreateVNCObject - Creating and running threadSSH");
 
@@ -212,23 +417,25 @@ void VncObject::createVNCObject (HostItem * itm)
 
       time_t sshDelay = time(NULL) + itm->sshWaitTime;
 
-      svDebugLog("svCreateVNCObject - About to enter itm->sshReady timer loop");
+      svDebugLog("svCreateVNCObject - About to enter itm->state().sshReady timer loop");
 
       // loop until the ssh connection is ready
       // or exit if ssh times out
       while (!app->shuttingDown)
       {
-        if (time(NULL) >= sshDelay || itm->hasError)
+        // ready once ssh is listening on the local end, or a shared master
+        // connection has taken the forward
+        if (time(NULL) >= sshDelay || itm->state().hasError || svSSHForwardIsReady(itm))
           break;
 
-        Fl::check();
+        Fl::wait(0.05);
       }
 
       // exit if sshReady is false
-      if (!itm->sshReady)
+      if (!itm->state().sshReady)
       {
-        itm->isConnecting = false;
-        itm->hasCouldntConnect = true;
+        itm->state().isConnecting = false;
+        itm->state().hasCouldntConnect = true;
 
         svHandleThreadConnection(itm);
 
@@ -237,17 +444,17 @@ void VncObject::createVNCObject (HostItem * itm)
     }
     // ############  SSH CONNECTION END ###########################################
 
-    svDebugLog("svCreateVNCObject - Creating and running itm->threadRFB");
+    svDebugLog("svCreateVNCObject - Creating and running itm->state().threadRFB");
 
     // create, launch and detach call to create our vnc connection
-    if (pthread_create(&itm->threadRFB, NULL, VncObject::initVNCConnection, itm) != 0)
+    if (pthread_create(&itm->state().threadRFB, NULL, VncObject::initVNCConnection, itm) != 0)
     {
-      itm->threadRFBRunning = false;
+      itm->state().threadRFBRunning = false;
 
       svLogToFile("ERROR - Couldn't create RFB thread for '" + itm->name + "' - " + itm->hostAddress);
-      itm->isConnecting = false;
-      itm->hasCouldntConnect = true;
-      itm->hasError = true;
+      itm->state().isConnecting = false;
+      itm->state().hasCouldntConnect = true;
+      itm->state().hasError = true;
 
       svHandleThreadConnection(itm);
 
@@ -265,25 +472,127 @@ void VncObject::createVNCObject (HostItem * itm)
 }
 
 
+/*
+  background thread that reads and decodes the displayed viewer's
+  messages so big updates don't stall the user interface
+  (libvncclient decodes each update's rectangles itself, one after the
+  other, so this moves that work off the ui thread as a whole)
+  (static method / thread)
+*/
+void * VncObject::decodeThreadProc (void *)
+{
+  // detach this thread
+  pthread_detach(pthread_self());
+
+  const VncObject * failedVnc = NULL;
+
+  while (!app->shuttingDown)
+  {
+    if (!app->decodeInThread || app->createdObjects == 0)
+    {
+      usleep(50000);
+      continue;
+    }
+
+    // get the displayed viewer's socket without holding the lock while waiting
+    pthread_mutex_lock(&m_decodeMutex);
+
+    VncObject * vnc = app->vncViewer ? app->vncViewer->vnc : NULL;
+    int nSock = -1;
+    bool hasBuffered = false;
+
+    // forget about a failed viewer once it's no longer displayed
+    if (vnc != failedVnc)
+      failedVnc = NULL;
+
+    if (vnc && vnc != failedVnc && vnc->allowDrawing && vnc->vncClient)
+    {
+      nSock = vnc->vncClient->sock;
+      hasBuffered = vnc->vncClient->buffered > 0;
+    }
+
+    pthread_mutex_unlock(&m_decodeMutex);
+
+    if (nSock < 0)
+    {
+      usleep(10000);
+      continue;
+    }
+
+    // wait a little while for something to read
+    if (!hasBuffered)
+    {
+      fd_set fds;
+      struct timeval tv;
+
+      FD_ZERO(&fds);
+      FD_SET(nSock, &fds);
+      tv.tv_sec = 0;
+      tv.tv_usec = 10000;
+
+      if (select(nSock + 1, &fds, NULL, NULL, &tv) <= 0)
+        continue;
+    }
+
+    pthread_mutex_lock(&m_decodeMutex);
+
+    // make sure the displayed viewer didn't change while we waited
+    if (app->vncViewer && app->vncViewer->vnc == vnc && vnc->vncClient && vnc->vncClient->sock == nSock)
+    {
+      if (!HandleRFBServerMessage(vnc->vncClient))
+      {
+        // let the main thread end the viewer
+        failedVnc = vnc;
+        Fl::awake(VncObject::handleThreadEndViewer, vnc->itm);
+      }
+    }
+
+    pthread_mutex_unlock(&m_decodeMutex);
+  }
+
+  m_decodeThreadRunning = false;
+
+  return SV_RET_VOID;
+}
+
+
+/*
+  fl_draw_image callback that converts one line of a
+  low colour depth framebuffer to RGB
+  (static method / callback)
+*/
+void VncObject::drawLowColorLine (void * data, int x, int y, int w, uchar * buf)
+{
+  const VncObject * vnc = static_cast<VncObject *>(data);
+  if (!vnc)
+    return;
+
+  const rfbClient * cl = vnc->vncClient;
+  const int nBytesPerPixel = cl->format.bitsPerPixel / 8;
+
+  vnc->convertToRGB(cl->frameBuffer + (y * cl->width + x) * nBytesPerPixel, buf, w);
+}
+
+
 /*
   ends all vnc objects (usually called right before program quits)
   (static method)
 */
 void VncObject::endAllViewers ()
 {
-  for (uint16_t i = 0; i <= app->hostList->size(); i ++)
+  // only items with a viewer need ending
+  std::vector<uint32_t> active = app->activeIds;
+
+  for (uint32_t nId : active)
   {
-    HostItem * itm = static_cast<HostItem *>(app->hostList->data(i));
-    if (itm)
-    {
-      VncObject * vnc = itm->vnc;
+    HostState & state = svHostState(nId);
+    VncObject * vnc = state.vnc;
 
-      if (vnc && (itm->isConnected || itm->isConnecting || itm->isWaitingForShow))
-      {
-        itm->hasDisconnectRequest = true;
+    if (vnc && (state.isConnected || state.isConnecting || state.isWaitingForShow))
+    {
+      state.hasDisconnectRequest = true;
 
-        vnc->endViewer();
-      }
+      vnc->endViewer();
     }
   }
 }
@@ -297,7 +606,7 @@ void VncObject::endViewer ()
 {
   //this->GONK!
 
-  if (this->itm && this->itm->vnc)
+  if (this->itm && this->itm->state().vnc)
   {
     // only hide main viewer if this is the currently-displayed itm
     if (app->vncViewer->vnc && this->itm == app->vncViewer->vnc->itm)
@@ -307,24 +616,34 @@ void VncObject::endViewer ()
     }
 
     // host disconnected unexpectedly / interrupted connection
-    if (this->itm->isConnected && !this->itm->hasDisconnectRequest)
+    if (this->itm->state().isConnected && !this->itm->state().hasDisconnectRequest)
     {
-      this->itm->icon = app->iconDisconnectedError;
-      Fl::awake(svHandleListItemIconChange);
+      this->itm->state().icon = app->iconDisconnectedError;
+      Fl::awake(svHandleListItemIconChange, this->itm);
 
       svLogToFile("Unexpectedly disconnected from '" + this->itm->name + "' - " + this->itm->hostAddress);
+
+      // try again later if this host reconnects automatically
+      svScheduleReconnect(this->itm);
     }
 
     // we disconnected purposely from host
-    if ((this->itm->isConnected || this->itm->isConnecting) && this->itm->hasDisconnectRequest)
+    if ((this->itm->state().isConnected || this->itm->state().isConnecting) && this->itm->state().hasDisconnectRequest)
     {
       // set host list item status icon
-      this->itm->icon = app->iconDisconnected;
-      Fl::awake(svHandleListItemIconChange);
+      this->itm->state().icon = app->iconDisconnected;
+      Fl::awake(svHandleListItemIconChange, this->itm);
+
+      // purposely disconnecting stops automatic reconnects
+      this->itm->state().isReconnecting = false;
+      this->itm->state().reconnectAttempts = 0;
+      this->itm->state().reconnectTime = 0;
 
       if (app->shuttingDown)
         svLogToFile("Automatically disconnecting.  Program is shutting down '" + this->itm->name +
           "' - " + itm->hostAddress);
+      else if (this->itm->state().isSuspended)
+        svLogToFile("Suspended idle connection to '" + this->itm->name + "' - " + this->itm->hostAddress);
       else
         svLogToFile("Manually disconnected from '" + this->itm->name + "' - " + this->itm->hostAddress);
     }
@@ -333,24 +652,53 @@ void VncObject::endViewer ()
     // can check and avoid 'expensive' stuff in masterMessageLoop
     app->createdObjects --;
 
-    this->itm->isConnected = false;
-    this->itm->hasDisconnectRequest = false;
+    this->itm->state().isConnected = false;
+    this->itm->state().hasDisconnectRequest = false;
 
     // tell ssh to clean up if a ssh/vnc connection
     if (this->itm->hostType == 's')
       svCloseSSHConnection(itm);
 
     // set this for cleanup later
-    if (this->vncClient && !this->itm->isConnecting)
-      this->itm->vncNeedsCleanup = true;
+    if (this->vncClient && !this->itm->state().isConnecting)
+      this->itm->state().vncNeedsCleanup = true;
 
-    this->itm->isConnecting = false;
+    this->itm->state().isConnecting = false;
 
     this->itm->clipboard.clear();
   }
 }
 
 
+/*
+  handle whatever the host has already sent, without drawing it
+  (used to decode a pre-requested frame before the viewer is shown)
+  (returns false if the connection ended)
+  (instance method)
+*/
+bool VncObject::handlePendingMessages ()
+{
+  if (!this->vncClient)
+    return false;
+
+  for (int i = 0; i < SV_SCAN_MAX_PREFETCH_MSGS; i ++)
+  {
+    int nMsg = WaitForMessage(this->vncClient, 0);
+
+    if (nMsg == 0)
+      break;
+
+    if (nMsg < 0 || !HandleRFBServerMessage(this->vncClient))
+    {
+      this->endViewer();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
 /*
   checks to see if vnc client will fit within scroller
   (instance method)
@@ -360,10 +708,10 @@ bool VncObject::fitsScroller ()
   if (app->vncViewer->fullscreen)
     return true;
 
-  if (!this->itm || !this->itm->vnc)
+  if (!this->itm || !this->itm->state().vnc)
     return false;
 
-  const rfbClient * cl = this->itm->vnc->vncClient;
+  const rfbClient * cl = this->itm->state().vnc->vncClient;
   if (!cl)
     return false;
 
@@ -376,58 +724,94 @@ bool VncObject::fitsScroller ()
 
 /*
   handle cursor change
+  (libvncclient may call this from the decode thread, so the shape is
+  copied and handed to the main thread)
   (static method / callback)
 */
 void VncObject::handleCursorShapeChange (rfbClient * cl, int xHot, int yHot, int nWidth, int nHeight,
   int nBytesPerPixel)
 {
+  if (!cl)
+    return;
+
   VncObject * vnc = static_cast<VncObject *>(rfbClientGetClientData(cl, m_vncObjPtr));
 
-  if (!vnc || !cl || !vnc->allowDrawing || Fl::belowmouse() != app->vncViewer)
+  if (!vnc || !vnc->allowDrawing || !cl->rcSource || !cl->rcMask)
     return;
 
-  const int nSSize = nWidth * nHeight * nBytesPerPixel;
+  const int nPixels = nWidth * nHeight;
 
-  // if image has alpha, apply mask
-  if (nBytesPerPixel == 2 || nBytesPerPixel == 4)
+  SVCursorShape * shape = new SVCursorShape();
+  shape->vnc = vnc;
+  shape->nWidth = nWidth;
+  shape->nHeight = nHeight;
+  shape->xHot = xHot;
+  shape->yHot = yHot;
+
+  // low colour depth cursors are converted to RGBA with the mask as alpha
+  if (nBytesPerPixel < 3)
   {
-    int nM = 0;
+    std::vector<uchar> cursorRGB(nPixels * 3);
 
-    for (int i = (nBytesPerPixel - 1); i < nSSize; i += nBytesPerPixel)
-    {
-      int nMV = cl->rcMask[nM];
+    vnc->convertToRGB(cl->rcSource, cursorRGB.data(), nPixels);
 
-      if (nMV > 0)
-        nMV = 255;
+    shape->nDepth = 4;
+    shape->pixels.resize(nPixels * 4);
 
-      cl->rcSource[i] = nMV;
+    for (int i = 0; i < nPixels; i ++)
+    {
+      shape->pixels[i * 4] = cursorRGB[i * 3];
+      shape->pixels[i * 4 + 1] = cursorRGB[i * 3 + 1];
+      shape->pixels[i * 4 + 2] = cursorRGB[i * 3 + 2];
+      shape->pixels[i * 4 + 3] = (cl->rcMask[i] > 0) ? 255 : 0;
+    }
+  }
+  // if image has alpha, apply mask
+  else
+  {
+    shape->nDepth = nBytesPerPixel;
+    shape->pixels.assign(cl->rcSource, cl->rcSource + nPixels * nBytesPerPixel);
 
-      nM ++;
+    if (nBytesPerPixel == 4)
+    {
+      for (int i = 0; i < nPixels; i ++)
+        shape->pixels[i * 4 + 3] = (cl->rcMask[i] > 0) ? 255 : 0;
     }
   }
 
-  // create rgb image from raw data
-  Fl_RGB_Image * img = new Fl_RGB_Image(cl->rcSource, nWidth, nHeight, nBytesPerPixel);
+  if (Fl::awake(VncObject::handleThreadCursorShape, shape) != 0)
+    delete shape;
+}
 
-  if (!img)
-    return;
 
-  // delete previous copy, if any
-  if (vnc->imgCursor)
-    delete vnc->imgCursor;
+/*
+  set a cursor shape copied by handleCursorShapeChange
+  (static method / Fl::awake callback)
+*/
+void VncObject::handleThreadCursorShape (void * data)
+{
+  SVCursorShape * shape = static_cast<SVCursorShape *>(data);
+  VncObject * vnc = shape->vnc;
 
-  // copy rgb image to vncViewer and set x+y hotspots
-  vnc->imgCursor = static_cast<Fl_RGB_Image *>(img->copy());
+  // the viewer may have ended since the shape was sent
+  if (svVncObjectIsLive(vnc) && vnc->allowDrawing)
+  {
+    Fl_RGB_Image img(shape->pixels.data(), shape->nWidth, shape->nHeight, shape->nDepth);
 
-  if (!vnc->imgCursor)
-    return;
+    // delete previous copy, if any
+    if (vnc->imgCursor)
+      delete vnc->imgCursor;
 
-  vnc->nCursorXHot = xHot;
-  vnc->nCursorYHot = yHot;
+    // copy rgb image to vncViewer and set x+y hotspots
+    vnc->imgCursor = static_cast<Fl_RGB_Image *>(img.copy());
+    vnc->nCursorXHot = shape->xHot;
+    vnc->nCursorYHot = shape->yHot;
 
-  Fl::awake(svHandleThreadCursorChange, reinterpret_cast<void *>(false));
+    if (vnc->imgCursor && app->vncViewer->vnc == vnc && Fl::belowmouse() == app->vncViewer)
+      svHandleThreadCursorChange(reinterpret_cast<void *>(false));
+  }
 
-  delete img;
+  delete shape;
 }
 
 
@@ -445,13 +829,32 @@ void VncObject::handleFrameBufferUpdate (rfbClient * cl)
   if (!vnc)
     return;
 
-  if (vnc->allowDrawing)
-    app->vncViewer->redraw();
+  if (!vnc->allowDrawing)
+    return;
+
+  // the decode thread can't touch widgets or host items, so the main thread redraws for it
+  if (m_decodeThreadRunning && pthread_equal(pthread_self(), m_decodeThread))
+  {
+    m_freshFrameVnc = vnc;
+
+    if (!m_redrawPending.exchange(true))
+      Fl::awake(VncObject::handleThreadRedraw);
+
+    return;
+  }
+
+  // a fresh frame replaces the one cached while suspended
+  if (vnc->itm && vnc->itm->state().isSuspended)
+    vnc->itm->state().isSuspended = false;
+
+  app->vncViewer->redraw();
 }
 
 
 /*
   handle copy/cut FROM vnc host
+  (libvncclient may call this from the decode thread, so the text is
+  copied and handed to the main thread)
   (static method)
 */
 void VncObject::handleRemoteClipboardProc (rfbClient * cl, const char * text, int textlen)
@@ -461,15 +864,31 @@ void VncObject::handleRemoteClipboardProc (rfbClient * cl, const char * text, in
   // copy/cut/paste operations.
 
   const VncObject * vnc = static_cast<VncObject *>(rfbClientGetClientData(cl, m_vncObjPtr));
-  if (!vnc)
+  if (!vnc || !text || textlen <= 0)
     return;
 
-  HostItem * itm = vnc->itm;
-  if (!itm)
-    return;
+  SVRemoteClipboard * clip = new SVRemoteClipboard();
+  clip->vnc = vnc;
+  clip->text.assign(text, textlen);
+
+  if (Fl::awake(VncObject::handleThreadClipboard, clip) != 0)
+    delete clip;
+}
+
+
+/*
+  store clipboard text copied by handleRemoteClipboardProc
+  (static method / Fl::awake callback)
+*/
+void VncObject::handleThreadClipboard (void * data)
+{
+  SVRemoteClipboard * clip = static_cast<SVRemoteClipboard *>(data);
 
-  if (textlen > 0)
-    itm->clipboard = text;
+  // the viewer may have ended since the text was sent
+  if (svVncObjectIsLive(clip->vnc) && clip->vnc->itm)
+    clip->vnc->itm->clipboard = clip->text;
+
+  delete clip;
 }
 
 
@@ -479,6 +898,8 @@ void VncObject::handleRemoteClipboardProc (rfbClient * cl, const char * text, in
 */
 void VncObject::hideMainViewer ()
 {
+  app->vncViewer->clearSuspendedFrame();
+
   VncObject * vnc = app->vncViewer->vnc;
   if (!vnc)
     return;
@@ -488,7 +909,9 @@ void VncObject::hideMainViewer ()
   app->mainWin->cursor(FL_CURSOR_DEFAULT);
 
   Fl::lock();
+  pthread_mutex_lock(&m_decodeMutex);
   app->vncViewer->vnc = NULL;
+  pthread_mutex_unlock(&m_decodeMutex);
   app->scroller->scroll_to(0, 0);
   app->scroller->type(0);
   app->scroller->redraw();
@@ -508,6 +931,7 @@ void * VncObject::initVNCConnection (void * data)
 
   char * strParams[2] = {NULL};
   int nNumOfParams = 2;
+  bool raceFailed = false;
 
   Fl::lock();
   HostItem * itm = static_cast<HostItem *>(data);
@@ -516,15 +940,15 @@ void * VncObject::initVNCConnection (void * data)
   if (!itm)
     return SV_RET_VOID;
 
-  itm->threadRFBRunning = true;
+  itm->state().threadRFBRunning = true;
 
-  VncObject * vnc = itm->vnc;
+  VncObject * vnc = itm->state().vnc;
   if (!vnc)
   {
-    itm->isConnected = false;
-    itm->isConnecting = false;
-    itm->hasError = true;
-    itm->threadRFBRunning = false;
+    itm->state().isConnected = false;
+    itm->state().isConnecting = false;
+    itm->state().hasError = true;
+    itm->state().threadRFBRunning = false;
 
     Fl::awake(svHandleThreadConnection, itm);
 
@@ -535,7 +959,7 @@ void * VncObject::initVNCConnection (void * data)
   strParams[0] = strdup("SpiritVNCFLTK");
 
   // set parameter 1
-  if (!itm->isListener)
+  if (!itm->state().isListener)
     // remote host address and port
     strParams[1] = strdup(itm->vncAddressAndPort.c_str());
   else
@@ -543,24 +967,86 @@ void * VncObject::initVNCConnection (void * data)
     // local listening address
     strParams[1] = strdup("-listennofork");
     vnc->vncClient->listenAddress = app->listenAddressStr;
+
+    // the listener already accepted this one, so libvncclient
+    // only has to do the handshake on it
+    if (itm->state().listenSock >= 0)
+    {
+      rfbClient * cl = vnc->vncClient;
+
+      cl->sock = itm->state().listenSock;
+      cl->listenSpecified = TRUE;
+
+      free(cl->serverHost);
+      cl->serverHost = strdup(itm->hostAddress.c_str());
+
+      itm->state().listenSock = -1;
+      nNumOfParams = 1;
+    }
   }
 
   // if the second parameter is invalid, get out
   if (!strParams[1] || strlen(strParams[1]) < 7)
   {
-    itm->isConnected = false;
-    itm->isConnecting = false;
-    itm->hasError = true;
-    itm->threadRFBRunning = false;
+    itm->state().isConnected = false;
+    itm->state().isConnecting = false;
+    itm->state().hasError = true;
+    itm->state().threadRFBRunning = false;
 
     Fl::awake(svHandleThreadConnection, itm);
 
     return SV_RET_VOID;
   }
 
+  // direct vnc hosts are resolved through the resolver cache and connected
+  // here, racing ipv6 and ipv4 so one dead address family can't stall us
+  if (!itm->state().isListener && itm->hostType == 'v')
+  {
+    std::vector<SVResolvedAddress> addrs;
+
+    if (svResolverLookup(itm->hostAddress, addrs))
+    {
+      int nPort = atoi(itm->vncPort.c_str());
+
+      // same display-number rule libvncclient uses
+      if (nPort < 100)
+        nPort += 5900;
+
+      int nSock = svConnectRacing(addrs, nPort, SV_CONNECTION_TIMEOUT_SECS, itm->tcpBufferSize * 1024);
+
+      if (nSock >= 0)
+      {
+        // hand the connected socket to libvncclient, which
+        // skips its own connect when listenSpecified is set
+        rfbClient * cl = vnc->vncClient;
+
+        cl->sock = nSock;
+        cl->listenSpecified = TRUE;
+
+        free(cl->serverHost);
+        cl->serverHost = strdup(itm->hostAddress.c_str());
+        cl->serverPort = nPort;
+
+        nNumOfParams = 1;
+      }
+      #ifndef _WIN32
+      else
+        raceFailed = true;
+      #endif
+    }
+  }
+
+  // every resolved address failed, so clean up the way rfbInitClient would have
+  if (raceFailed)
+  {
+    int errNum = errno;
+    rfbClientCleanup(vnc->vncClient);
+    errno = errNum;
+  }
+
   // libvnc - attempt to connect to host
   // this function blocks, that's why this function runs as a thread
-  if (!rfbInitClient(vnc->vncClient, &nNumOfParams, strParams))
+  if (raceFailed || !rfbInitClient(vnc->vncClient, &nNumOfParams, strParams))
   {
     // * connection failed *
 
@@ -570,20 +1056,32 @@ void * VncObject::initVNCConnection (void * data)
 
     VncObject::parseErrorMessages(itm, strerror(errNum));
 
-    itm->isConnected = false;
-    itm->hasCouldntConnect = true;
+    // the cached address may be stale, so look it up fresh next time
+    if (itm->hostType == 'v')
+      svResolverForget(itm->hostAddress);
+
+    itm->state().isConnected = false;
+    itm->state().hasCouldntConnect = true;
   }
   else
   {
     // * connection succeeded *
-    itm->isConnected = true;
-    itm->isWaitingForShow = true;
-    itm->initOkay = true;
+
+    // this is an outgoing connection, even if we handed libvncclient the socket
+    if (!itm->state().isListener)
+      vnc->vncClient->listenSpecified = FALSE;
+
+    // apply this host's tcp tuning to the new socket
+    svApplySocketOptions(itm);
+
+    itm->state().isConnected = true;
+    itm->state().isWaitingForShow = true;
+    itm->state().initOkay = true;
   }
 
   // set flags for either outcome
-  itm->isConnecting = false;
-  itm->threadRFBRunning = false;
+  itm->state().isConnecting = false;
+  itm->state().threadRFBRunning = false;
 
   // send message to main thread
   Fl::awake(svHandleThreadConnection, itm);
@@ -629,7 +1127,7 @@ void VncObject::parseErrorMessages (HostItem * itm, const char * strMessageIn)
   // fix dumb Operation now in progress error
   if (strMessage.find("Operation now in progress") != std::string::npos)
   {
-    if (itm->hostType == 's' && !itm->sshReady)
+    if (itm->hostType == 's' && !itm->state().sshReady)
       itm->lastErrorMessage = "Unable to connect to host's SSH server";
     else
       itm->lastErrorMessage = "Unable to connect to VNC server";
@@ -677,7 +1175,10 @@ void VncObject::masterMessageLoop ()
     {
       VncObject * vnc = app->vncViewer->vnc;
 
-      if (vnc && vnc->itm)
+      // the background decode thread handles messages when it's enabled
+      if (app->decodeInThread)
+        VncObject::startDecodeThread();
+      else if (vnc && vnc->itm)
         VncObject::checkVNCMessages(vnc);
 
       // keep from making too tight a loop
@@ -760,21 +1261,142 @@ rfbCredential * VncObject::handleCredential (rfbClient * cl, int credentialType)
 
 
 /*
-  libvnc send password to host callback
-  (static function)
+  send the next paced key press of a key batch to the host
+  (static method / timer callback)
 */
-char * VncObject::handlePassword (rfbClient * cl)
+void VncObject::handleKeyBatchTimer (void * data)
 {
-  // check if client is non-null
-  if (!cl)
+  VncObject * vnc = static_cast<VncObject *>(data);
+  if (!vnc)
+    return;
+
+  // connection went away while pacing, drop the rest
+  if (!vnc->itm || !vnc->itm->state().isConnected || !vnc->vncClient)
   {
-    svLogToFile("ERROR - handlePassword: vnc->vncClient is null");
-    return NULL;
+    vnc->keyBatch.clear();
+    vnc->nKeyBatchSent = 0;
+    vnc->keyBatchPacing = false;
+    return;
   }
 
-  // check if vncObj is non-null
-  const VncObject * vnc = static_cast<VncObject *>(rfbClientGetClientData(cl, m_vncObjPtr));
-  if (!vnc)
+  size_t nStart = vnc->nKeyBatchSent;
+  size_t nEnd = nStart;
+
+  // send everything up to and including the next key release in one write
+  while (nEnd < vnc->keyBatch.size())
+  {
+    if (!vnc->keyBatch[nEnd ++].down)
+      break;
+  }
+
+  if (nEnd > nStart)
+  {
+    pthread_mutex_lock(&m_decodeMutex);
+    WriteToRFBServer(vnc->vncClient, reinterpret_cast<char *>(&vnc->keyBatch[nStart]),
+      (nEnd - nStart) * sz_rfbKeyEventMsg);
+    pthread_mutex_unlock(&m_decodeMutex);
+  }
+
+  vnc->nKeyBatchSent = nEnd;
+
+  // all done
+  if (vnc->nKeyBatchSent >= vnc->keyBatch.size())
+  {
+    vnc->keyBatch.clear();
+    vnc->nKeyBatchSent = 0;
+    vnc->keyBatchPacing = false;
+    return;
+  }
+
+  Fl::repeat_timeout(static_cast<double>(vnc->itm->keyDelay) / 1000.0, VncObject::handleKeyBatchTimer, data);
+}
+
+
+/*
+  end a viewer whose messages failed in the decode thread
+  (static method / Fl::awake callback)
+*/
+void VncObject::handleThreadEndViewer (void * data)
+{
+  HostItem * itm = static_cast<HostItem *>(data);
+
+  if (itm && itm->state().vnc && (itm->state().isConnected || itm->state().isWaitingForShow))
+    itm->state().vnc->endViewer();
+}
+
+
+/*
+  redraw the displayed viewer for the decode thread
+  (static method / Fl::awake callback)
+*/
+void VncObject::handleThreadRedraw (void *)
+{
+  m_redrawPending = false;
+
+  if (!app->vncViewer || !app->vncViewer->vnc)
+    return;
+
+  VncObject * vnc = app->vncViewer->vnc;
+
+  // a fresh frame replaces the one cached while suspended
+  if (m_freshFrameVnc.exchange(NULL) == vnc && vnc->itm && vnc->itm->state().isSuspended)
+    vnc->itm->state().isSuspended = false;
+
+  app->vncViewer->redraw();
+}
+
+
+/*
+  libvnc framebuffer allocation callback, called on connect and
+  whenever the remote desktop size changes
+  (static method / callback)
+*/
+rfbBool VncObject::handleMallocFrameBuffer (rfbClient * cl)
+{
+  if (!cl)
+    return FALSE;
+
+  VncObject * vnc = static_cast<VncObject *>(rfbClientGetClientData(cl, m_vncObjPtr));
+  if (!vnc || !vnc->itm)
+    return FALSE;
+
+  uint64_t nSize = static_cast<uint64_t>(cl->width) * cl->height * (cl->format.bitsPerPixel / 8);
+
+  if (nSize == 0 || nSize >= SIZE_MAX)
+  {
+    svLogToFile("ERROR - Invalid framebuffer size for '" + vnc->itm->name + "' - " + vnc->itm->hostAddress);
+    return FALSE;
+  }
+
+  cl->frameBuffer = svFrameBufferAcquire(vnc->itm, static_cast<size_t>(nSize));
+
+  if (!cl->frameBuffer)
+  {
+    svLogToFile("ERROR - Could not allocate framebuffer for '" + vnc->itm->name + "' - " +
+      vnc->itm->hostAddress);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+/*
+  libvnc send password to host callback
+  (static function)
+*/
+char * VncObject::handlePassword (rfbClient * cl)
+{
+  // check if client is non-null
+  if (!cl)
+  {
+    svLogToFile("ERROR - handlePassword: vnc->vncClient is null");
+    return NULL;
+  }
+
+  // check if vncObj is non-null
+  const VncObject * vnc = static_cast<VncObject *>(rfbClientGetClientData(cl, m_vncObjPtr));
+  if (!vnc)
   {
     svLogToFile("ERROR - handlePassword: vnc is null");
     return NULL;
@@ -811,18 +1433,210 @@ char * VncObject::handlePassword (rfbClient * cl)
 }
 
 
+/*
+  send this object's key batch to the host
+  the whole batch goes out in a single write unless the host
+  has a key delay set, then each key press is paced by a timer
+  (instance method)
+*/
+bool VncObject::sendKeyBatch ()
+{
+  if (!this->vncClient || this->keyBatch.empty())
+    return true;
+
+  // server doesn't accept key events
+  if (!SupportsClient2Server(this->vncClient, rfbKeyEvent))
+  {
+    this->keyBatch.clear();
+    return true;
+  }
+
+  // paced sending (batch is cleared by the timer when done)
+  if (this->itm && this->itm->keyDelay > 0)
+  {
+    if (!this->keyBatchPacing)
+    {
+      this->keyBatchPacing = true;
+      Fl::add_timeout(0.0, VncObject::handleKeyBatchTimer, this);
+    }
+
+    return true;
+  }
+
+  pthread_mutex_lock(&m_decodeMutex);
+
+  bool sentOkay = WriteToRFBServer(this->vncClient, reinterpret_cast<char *>(this->keyBatch.data()),
+    this->keyBatch.size() * sz_rfbKeyEventMsg);
+
+  pthread_mutex_unlock(&m_decodeMutex);
+
+  this->keyBatch.clear();
+
+  return sentOkay;
+}
+
+
+/*
+  the send methods below hold the decode mutex so they don't write
+  to the client while the decode thread is handling its messages
+*/
+
+/*
+  send clipboard text to the host
+  (instance method)
+*/
+void VncObject::sendClipboard (const std::string& strText)
+{
+  if (!this->vncClient || strText.empty())
+    return;
+
+  pthread_mutex_lock(&m_decodeMutex);
+  SendClientCutText(this->vncClient, const_cast<char *>(strText.c_str()), static_cast<int>(strText.size()));
+  pthread_mutex_unlock(&m_decodeMutex);
+}
+
+
+/*
+  send the client's current pixel format and encodings to the host
+  (instance method)
+*/
+void VncObject::sendFormatAndEncodings ()
+{
+  if (!this->vncClient)
+    return;
+
+  pthread_mutex_lock(&m_decodeMutex);
+  SetFormatAndEncodings(this->vncClient);
+  pthread_mutex_unlock(&m_decodeMutex);
+}
+
+
+/*
+  ask the host for a full (non-incremental) screen update
+  (instance method)
+*/
+bool VncObject::sendFullUpdateRequest ()
+{
+  if (!this->vncClient)
+    return false;
+
+  pthread_mutex_lock(&m_decodeMutex);
+
+  bool sentOkay = SendFramebufferUpdateRequest(this->vncClient, 0, 0,
+    this->vncClient->width, this->vncClient->height, false);
+
+  pthread_mutex_unlock(&m_decodeMutex);
+
+  return sentOkay;
+}
+
+
+/*
+  send a single key event to the host
+  (instance method)
+*/
+void VncObject::sendKey (uint32_t nKey, bool downState)
+{
+  if (!this->vncClient)
+    return;
+
+  pthread_mutex_lock(&m_decodeMutex);
+  SendKeyEvent(this->vncClient, nKey, downState);
+  pthread_mutex_unlock(&m_decodeMutex);
+}
+
+
+/*
+  send a pointer event to the host, optionally followed
+  by a request for an incremental update
+  (instance method)
+*/
+void VncObject::sendPointer (int nX, int nY, int nButtonMask, bool requestUpdate)
+{
+  if (!this->vncClient)
+    return;
+
+  pthread_mutex_lock(&m_decodeMutex);
+
+  SendPointerEvent(this->vncClient, nX, nY, nButtonMask);
+
+  if (requestUpdate)
+    SendIncrementalFramebufferUpdateRequest(this->vncClient);
+
+  pthread_mutex_unlock(&m_decodeMutex);
+}
+
+
+/*
+  set the pixel format requested from the host
+  (8 = BGR233, 16 = RGB565, anything else keeps the default 32 bpp / depth 24)
+  (instance method)
+*/
+void VncObject::setColorDepth (uint8_t nDepth)
+{
+  rfbPixelFormat * fmt = &this->vncClient->format;
+
+  if (nDepth == 8)
+  {
+    fmt->bitsPerPixel = 8;
+    fmt->depth = 8;
+    fmt->redMax = 7;
+    fmt->greenMax = 7;
+    fmt->blueMax = 3;
+    fmt->redShift = 0;
+    fmt->greenShift = 3;
+    fmt->blueShift = 6;
+  }
+  else if (nDepth == 16)
+  {
+    fmt->bitsPerPixel = 16;
+    fmt->depth = 16;
+    fmt->redMax = 31;
+    fmt->greenMax = 63;
+    fmt->blueMax = 31;
+    fmt->redShift = 11;
+    fmt->greenShift = 5;
+    fmt->blueShift = 0;
+  }
+  else
+    return;
+
+  // low colour depths must be true colour so the server does the conversion
+  fmt->trueColour = TRUE;
+  fmt->bigEndian = FALSE;
+  this->vncClient->appData.forceTrueColour = TRUE;
+
+  // build channel scale tables so drawing doesn't divide per pixel
+  const uint16_t nMax[3] = {fmt->redMax, fmt->greenMax, fmt->blueMax};
+
+  for (int c = 0; c < 3; c ++)
+    for (int i = 0; i <= nMax[c]; i ++)
+      this->colorScale[c][i] = static_cast<uchar>((i * 255) / nMax[c]);
+}
+
+
 /*
   set vnc object to show itself
+  (requestFullUpdate can be false when a full update was already requested)
   (instance method)
 */
-void VncObject::setObjectVisible ()
+void VncObject::setObjectVisible (bool requestFullUpdate)
 {
   if (!this->itm || !this->vncClient)
       return;
 
+  // a resumed host shows its last frame until a fresh one arrives
+  if (this->itm->state().isSuspended && app->vncViewer->suspendedItm != this->itm)
+    app->vncViewer->showSuspendedFrame(this->itm);
+
+  pthread_mutex_lock(&m_decodeMutex);
   app->vncViewer->vnc = this;
+  pthread_mutex_unlock(&m_decodeMutex);
 
-  SendFramebufferUpdateRequest(this->vncClient, 0, 0, this->vncClient->width, this->vncClient->height, false);
+  this->itm->state().lastActivityTime = time(NULL);
+
+  if (requestFullUpdate)
+    this->sendFullUpdateRequest();
 
   //int leftMargin = app->flexLeftSide->w(); // + 3; //(app->hostList->x() + app->hostList->w() + 3);
 
@@ -866,6 +1680,80 @@ void VncObject::setObjectVisible ()
 }
 
 
+/*
+  keep a compressed copy of the last frame, then disconnect to free the
+  socket, framebuffer and server resources until the host is selected again
+  (instance method)
+*/
+void VncObject::suspendViewer ()
+{
+  HostItem * itm = this->itm;
+  rfbClient * cl = this->vncClient;
+
+  if (!itm || !cl || !itm->state().isConnected || !cl->frameBuffer || cl->width < 1 || cl->height < 1)
+    return;
+
+  const int nPixels = cl->width * cl->height;
+  const int nBytesPerPixel = cl->format.bitsPerPixel / 8;
+  std::vector<uchar> rgb(nPixels * 3);
+
+  // pack the framebuffer down to 24-bit RGB
+  if (nBytesPerPixel < 3)
+    this->convertToRGB(cl->frameBuffer, rgb.data(), nPixels);
+  else
+    for (int i = 0; i < nPixels; i ++)
+      memcpy(&rgb[i * 3], cl->frameBuffer + (i * nBytesPerPixel), 3);
+
+  uLongf nCompressedLen = compressBound(rgb.size());
+
+  itm->suspendedFrame.resize(nCompressedLen);
+
+  if (compress2(itm->suspendedFrame.data(), &nCompressedLen, rgb.data(), rgb.size(), Z_BEST_SPEED) == Z_OK)
+  {
+    itm->suspendedFrame.resize(nCompressedLen);
+    itm->suspendedFrame.shrink_to_fit();
+    itm->suspendedWidth = cl->width;
+    itm->suspendedHeight = cl->height;
+    itm->state().hasSuspendedFrame = true;
+  }
+  else
+  {
+    // suspend anyway, there just won't be a frame to show
+    svLogToFile("WARNING - Could not compress last frame of '" + itm->name + "' - " + itm->hostAddress);
+
+    itm->suspendedFrame.clear();
+    itm->suspendedFrame.shrink_to_fit();
+    itm->state().hasSuspendedFrame = false;
+  }
+
+  itm->state().isSuspended = true;
+  itm->state().hasDisconnectRequest = true;
+
+  this->endViewer();
+}
+
+
+/*
+  start the background decode thread, if it isn't already running
+  (static method)
+*/
+void VncObject::startDecodeThread ()
+{
+  if (m_decodeThreadRunning)
+    return;
+
+  m_decodeThreadRunning = true;
+
+  if (pthread_create(&m_decodeThread, NULL, VncObject::decodeThreadProc, NULL) != 0)
+  {
+    m_decodeThreadRunning = false;
+    app->decodeInThread = false;
+
+    svLogToFile("ERROR - Couldn't create the background decode thread.  Decoding on the main thread");
+  }
+}
+
+
 /*
   check and act on libvnc host messages
   (static method)
@@ -905,14 +1793,56 @@ void VncObject::checkVNCMessages (VncObject * vnc)
   ########################################################################################
 */
 
+/*
+  draw the viewer again after draw found the decode thread busy
+  (timer callback)
+*/
+static void svViewerRetryDraw (void *)
+{
+  if (app->vncViewer)
+    app->vncViewer->redraw();
+}
+
+
 /*
   draw event for vnc view widget
   (instance method)
 */
 void VncViewer::draw ()
+{
+  // the decode thread holds the lock for a whole message, socket reads
+  // included, so a slow host would stall the ui if we waited; the back
+  // buffer keeps the last frame, so draw again shortly instead
+  if (pthread_mutex_trylock(&m_decodeMutex) != 0)
+  {
+    if (!Fl::has_timeout(svViewerRetryDraw))
+      Fl::add_timeout(SV_DRAW_RETRY_SECS, svViewerRetryDraw);
+
+    return;
+  }
+
+  this->drawFrameBuffer();
+
+  pthread_mutex_unlock(&m_decodeMutex);
+}
+
+
+/*
+  draw the vnc host's framebuffer
+  (decode mutex must be held)
+  (instance method)
+*/
+void VncViewer::drawFrameBuffer ()
 {
   VncObject * v = this->vnc;
 
+  // a suspended host shows its last frame until it sends a fresh one
+  if (this->suspendedItm && this->suspendedItm->state().isSuspended && (!v || v->itm == this->suspendedItm))
+  {
+    this->drawSuspendedFrame();
+    return;
+  }
+
   if (!v || !v->allowDrawing || !v->vncClient)
     return;
 
@@ -936,6 +1866,21 @@ void VncViewer::draw ()
     v->nLastScrollX = app->scroller->xposition();
     v->nLastScrollY = app->scroller->yposition();
 
+    // low colour depths are converted line by line
+    if (nBytesPerPixel < 3)
+    {
+      fl_draw_image(
+        VncObject::drawLowColorLine,
+        v,
+        app->scroller->x() - v->nLastScrollX,
+        app->scroller->y() - v->nLastScrollY,
+        cl->width,
+        cl->height,
+        3);
+
+      return;
+    }
+
     // draw that v host!
     fl_draw_image(
       cl->frameBuffer,
@@ -953,14 +1898,29 @@ void VncViewer::draw ()
   if (itm->scaling == 'z' || (itm->scaling == 'f' && !v->fitsScroller()))
   {
     int isize = cl->width * cl->height * nBytesPerPixel;
+    Fl_RGB_Image * imgRGB = NULL;
 
-    // if there's an alpha byte, set it to 255
-    if (nBytesPerPixel == 2 || nBytesPerPixel == 4)
-      for (int i = (nBytesPerPixel - 1); i < isize; i+= nBytesPerPixel)
-          cl->frameBuffer[i] = 255;
+    if (nBytesPerPixel < 3)
+    {
+      // convert low colour depth framebuffer to RGB before scaling
+      const int nPixels = cl->width * cl->height;
+
+      v->rgbBuffer.resize(nPixels * 3);
+      v->convertToRGB(cl->frameBuffer, v->rgbBuffer.data(), nPixels);
+
+      imgRGB = new Fl_RGB_Image(v->rgbBuffer.data(), cl->width, cl->height, 3);
+    }
+    else
+    {
+      // if there's an alpha byte, set it to 255
+      if (nBytesPerPixel == 4)
+        for (int i = (nBytesPerPixel - 1); i < isize; i+= nBytesPerPixel)
+            cl->frameBuffer[i] = 255;
+
+      // create an RGB image from libvncclient's framebuffer
+      imgRGB = new Fl_RGB_Image(cl->frameBuffer, cl->width, cl->height, nBytesPerPixel);
+    }
 
-    // create an RGB image from libvncclient's framebuffer
-    Fl_RGB_Image * imgRGB = new Fl_RGB_Image(cl->frameBuffer, cl->width, cl->height, nBytesPerPixel);
     if (imgRGB)
     {
       // set appropriate scale quality
@@ -979,6 +1939,105 @@ void VncViewer::draw ()
 }
 
 
+/*
+  draw the cached frame of a suspended host, scaled to the viewer
+  (instance method)
+*/
+void VncViewer::drawSuspendedFrame ()
+{
+  const HostItem * itm = this->suspendedItm;
+
+  if (!itm || this->suspendedRGB.empty())
+    return;
+
+  Fl_RGB_Image imgRGB(this->suspendedRGB.data(), itm->suspendedWidth, itm->suspendedHeight, 3);
+
+  if (this->w() != itm->suspendedWidth || this->h() != itm->suspendedHeight)
+  {
+    // set appropriate scale quality
+    if (itm->scalingFast)
+      imgRGB.RGB_scaling(FL_RGB_SCALING_NEAREST);
+    else
+      imgRGB.RGB_scaling(FL_RGB_SCALING_BILINEAR);
+
+    imgRGB.scale(this->w(), this->h());
+  }
+
+  imgRGB.draw(this->x(), this->y());
+}
+
+
+/*
+  stop showing a suspended host's cached frame
+  (instance method)
+*/
+void VncViewer::clearSuspendedFrame ()
+{
+  if (!this->suspendedItm)
+    return;
+
+  this->suspendedItm = NULL;
+  this->suspendedRGB.clear();
+  this->suspendedRGB.shrink_to_fit();
+
+  this->redraw();
+}
+
+
+/*
+  unpack and show a suspended host's cached frame while it reconnects
+  (instance method)
+*/
+void VncViewer::showSuspendedFrame (HostItem * itm)
+{
+  if (!itm || itm->suspendedFrame.empty() || itm->suspendedWidth < 1 || itm->suspendedHeight < 1)
+    return;
+
+  const int nWidth = itm->suspendedWidth;
+  const int nHeight = itm->suspendedHeight;
+  uLongf nLen = nWidth * nHeight * 3;
+
+  this->suspendedRGB.resize(nLen);
+
+  if (uncompress(this->suspendedRGB.data(), &nLen, itm->suspendedFrame.data(),
+    itm->suspendedFrame.size()) != Z_OK || nLen != this->suspendedRGB.size())
+  {
+    this->suspendedItm = itm;
+    this->clearSuspendedFrame();
+
+    return;
+  }
+
+  this->suspendedItm = itm;
+
+  // same geometry rules as a live viewer
+  if (itm->scaling == 's' || (itm->scaling == 'f' &&
+    (this->fullscreen || (nWidth <= app->scroller->w() && nHeight <= app->scroller->h()))))
+  {
+    app->scroller->type(Fl_Scroll::BOTH);
+    this->size(nWidth, nHeight);
+  }
+  else
+  {
+    this->size(app->scroller->w(), app->scroller->h());
+
+    float dRatio = static_cast<float>(nWidth) / static_cast<float>(nHeight);
+
+    if (static_cast<float>(this->h()) * dRatio <= this->w())
+      this->size(static_cast<int>(static_cast<float>(this->h()) * dRatio), this->h());
+    else
+      this->size(this->w(), static_cast<int>(static_cast<float>(this->w()) / dRatio));
+  }
+
+  // only use when not in fullscreen
+  if (!this->fullscreen)
+    svResizeScroller();
+
+  app->scroller->scroll_to(0, 0);
+  app->scroller->redraw();
+}
+
+
 /* handle events for vnc view widget */
 /* (instance method) */
 int VncViewer::handle (int event)
@@ -990,6 +2049,10 @@ int VncViewer::handle (int event)
   if (!v)
     return 0;
 
+  // any input keeps this connection from being suspended as idle
+  if (v->itm)
+    v->itm->state().lastActivityTime = time(NULL);
+
   // bail out if this is not the active vnc object
   if (!v->allowDrawing)
     return 0;
@@ -1038,8 +2101,7 @@ int VncViewer::handle (int event)
       if (Fl::event_button() == FL_RIGHT_MOUSE)
         nButtonMask |= rfbButton3Mask;
 
-      SendPointerEvent(v->vncClient, nMouseX, nMouseY, nButtonMask);
-      SendIncrementalFramebufferUpdateRequest(v->vncClient);
+      v->sendPointer(nMouseX, nMouseY, nButtonMask, true);
 
       app->scanIsRunning = false;
       return 1;
@@ -1050,7 +2112,7 @@ int VncViewer::handle (int event)
         if (Fl::event_button() == FL_LEFT_MOUSE)
         {
           nButtonMask |= rfbButton1Mask;
-          SendPointerEvent(v->vncClient, nMouseX, nMouseY, nButtonMask);
+          v->sendPointer(nMouseX, nMouseY, nButtonMask);
           app->scanIsRunning = false;
           return 1;
         }
@@ -1058,7 +2120,7 @@ int VncViewer::handle (int event)
         if (Fl::event_button() == FL_RIGHT_MOUSE)
         {
           nButtonMask |= rfbButton3Mask;
-          SendPointerEvent(v->vncClient, nMouseX, nMouseY, nButtonMask);
+          v->sendPointer(nMouseX, nMouseY, nButtonMask);
           app->scanIsRunning = false;
           return 1;
         }
@@ -1070,8 +2132,7 @@ int VncViewer::handle (int event)
         {
           // left mouse click
           nButtonMask &= ~rfbButton1Mask;
-          SendPointerEvent(v->vncClient, nMouseX, nMouseY, nButtonMask);
-          SendIncrementalFramebufferUpdateRequest(v->vncClient);
+          v->sendPointer(nMouseX, nMouseY, nButtonMask, true);
           app->scanIsRunning = false;
           return 1;
         }
@@ -1080,8 +2141,7 @@ int VncViewer::handle (int event)
         if (Fl::event_button() == FL_RIGHT_MOUSE)
         {
           nButtonMask &= ~rfbButton3Mask;
-          SendPointerEvent(v->vncClient, nMouseX, nMouseY, nButtonMask);
-          SendIncrementalFramebufferUpdateRequest(v->vncClient);
+          v->sendPointer(nMouseX, nMouseY, nButtonMask, true);
           app->scanIsRunning = false;
           return 1;
         }
@@ -1104,19 +2164,17 @@ int VncViewer::handle (int event)
             nYDirection = rfbWheelUpMask;
 
           nButtonMask |= nYDirection;
-          SendPointerEvent(v->vncClient, nMouseX, nMouseY, nButtonMask);
+          v->sendPointer(nMouseX, nMouseY, nButtonMask);
 
           nButtonMask &= ~nYDirection;
-          SendPointerEvent(v->vncClient, nMouseX, nMouseY, nButtonMask);
-
-          SendIncrementalFramebufferUpdateRequest(v->vncClient);
+          v->sendPointer(nMouseX, nMouseY, nButtonMask, true);
           return 1;
         }
         break;
     }
 
     case FL_MOVE:
-      SendPointerEvent(v->vncClient, nMouseX, nMouseY, nButtonMask);
+      v->sendPointer(nMouseX, nMouseY, nButtonMask);
       return 1;
       break;
 
@@ -1165,11 +2223,10 @@ int VncViewer::handle (int event)
 
         if (intClipLen > 0)
         {
-          std::string strClipText = Fl::event_text();
+          std::string strClipText(Fl::event_text(), intClipLen);
 
           // send clipboard text to remote server
-          SendClientCutText(app->vncViewer->vnc->vncClient,
-            const_cast<char *>(strClipText.c_str()), intClipLen);
+          app->vncViewer->vnc->sendClipboard(strClipText);
       }
       return 1;
 
@@ -1198,8 +2255,7 @@ void VncViewer::sendCorrectedKeyEvent (const char * strIn, const int nK, bool do
   if (!itm)
     return;
 
-  rfbClient * cl = v->vncClient;
-  if (!cl)
+  if (!v->vncClient)
     return;
 
   // F8 window
@@ -1246,8 +2302,9 @@ void VncViewer::sendCorrectedKeyEvent (const char * strIn, const int nK, bool do
         svSendKeyStrokesToHost(itm->f12Macro, v);
       else
       {
-        SendKeyEvent(v->vncClient, XK_F12, true);
-        SendKeyEvent(v->vncClient, XK_F12, false);
+        v->addKeyToBatch(XK_F12, true);
+        v->addKeyToBatch(XK_F12, false);
+        v->sendKeyBatch();
       }
     }
 
@@ -1256,9 +2313,9 @@ void VncViewer::sendCorrectedKeyEvent (const char * strIn, const int nK, bool do
 
   // send key
   if ((nK >= 32 && nK <= 255) && Fl::event_ctrl() == 0)
-    SendKeyEvent(cl, strIn[0], downState);
+    v->sendKey(strIn[0], downState);
   else
-    SendKeyEvent(cl, nK, downState);
+    v->sendKey(nK, downState);
 }
 
 
@@ -39,6 +39,7 @@
 #include <FL/Fl_Pixmap.H>
 #include <rfb/rfbclient.h>
 #include <fstream>
+#include <vector>
 #include "hostitem.h"
 
 
@@ -61,7 +62,9 @@ public:
     nCursorYHot(0),
     //inactiveSeconds(0),
     nLastScrollX(0),
-    nLastScrollY(0)
+    nLastScrollY(0),
+    nKeyBatchSent(0),
+    keyBatchPacing(false)
     //centeredX(0),
     //centeredY(0)
   {
@@ -69,7 +72,7 @@ public:
     vncClient->canHandleNewFBSize = true;
     vncClient->appData.forceTrueColour = false;
     vncClient->appData.useRemoteCursor = false;
-    vncClient->listenPort = 5500;
+    vncClient->listenPort = SV_LISTEN_PORT;
 
     // callbacks
     vncClient->GetCredential = VncObject::handleCredential;
@@ -77,6 +80,7 @@ public:
     vncClient->GotCursorShape = VncObject::handleCursorShapeChange;
     vncClient->GotXCutText = VncObject::handleRemoteClipboardProc;
     vncClient->FinishedFrameBufferUpdate = VncObject::handleFrameBufferUpdate;
+    vncClient->MallocFrameBuffer = VncObject::handleMallocFrameBuffer;
 
     vncClient->connectTimeout = SV_CONNECTION_TIMEOUT_SECS;
 
@@ -99,11 +103,27 @@ public:
   int nLastScrollY;
   //int centeredX;
   //int centeredY;
+  std::vector<uchar> rgbBuffer;
+  uchar colorScale[3][256];
+  std::vector<rfbKeyEventMsg> keyBatch;
+  size_t nKeyBatchSent;
+  bool keyBatchPacing;
 
   // public methods
   //  instance
-  void setObjectVisible ();
+  void addKeyToBatch (uint32_t, bool);
+  void sendClipboard (const std::string&);
+  void sendFormatAndEncodings ();
+  bool sendFullUpdateRequest ();
+  void sendKey (uint32_t, bool);
+  bool sendKeyBatch ();
+  void sendPointer (int, int, int, bool requestUpdate = false);
+  void convertToRGB (const uint8_t *, uchar *, int) const;
+  void setColorDepth (uint8_t);
+  void setObjectVisible (bool requestFullUpdate = true);
+  void suspendViewer ();
   bool fitsScroller ();
+  bool handlePendingMessages ();
   void endViewer ();
   //void libVncLogging (const char *, ...);
 
@@ -112,11 +132,20 @@ public:
   static void cleanupVNCObject (HostItem *);
   static void createVNCObject (HostItem *);
   static void createVNCListener ();
+  static void createVNCReverseConnection (int, const std::string&);
+  static void * decodeThreadProc (void *);
+  static void drawLowColorLine (void *, int, int, int, uchar *);
   static void endAndDeleteViewer (VncObject **);
   static void endAllViewers ();
   static rfbCredential * handleCredential (rfbClient *, int);
   static void handleCursorShapeChange (rfbClient *, int, int, int, int, int);
   static void handleFrameBufferUpdate (rfbClient *);
+  static void handleKeyBatchTimer (void *);
+  static void handleThreadClipboard (void *);
+  static void handleThreadCursorShape (void *);
+  static void handleThreadEndViewer (void *);
+  static void handleThreadRedraw (void *);
+  static rfbBool handleMallocFrameBuffer (rfbClient *);
   static char * handlePassword (rfbClient *);
   static void handleRemoteClipboardProc (rfbClient *, const char *, int);
   static void hideMainViewer ();
@@ -124,6 +153,7 @@ public:
   static void libVncLogging (const char *, ...);
   static void masterMessageLoop ();
   static void parseErrorMessages(HostItem *, const char *);
+  static void startDecodeThread ();
 };
 
 /* vnc viewer widget class */
@@ -133,19 +163,26 @@ public:
   VncViewer (int x, int y, int w, int h, const char * label = 0) :
   Fl_Box(x, y, w, h, label),
   vnc(NULL),
-  fullscreen(false)
+  fullscreen(false),
+  suspendedItm(NULL)
   {}
 
   VncObject * vnc;
   bool fullscreen;
+  HostItem * suspendedItm;
+  std::vector<uchar> suspendedRGB;
 
   // public
+  void clearSuspendedFrame ();
   void setFullScreen ();
+  void showSuspendedFrame (HostItem *);
   void unsetFullScreen ();
 
 private:
   int handle (int) override;
   void draw () override;
+  void drawFrameBuffer ();
+  void drawSuspendedFrame ();
   void sendCorrectedKeyEvent (const char *, const int, bool);
 };
 